@@ -0,0 +1,552 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <sop/sop.h>
+#include "gen.h"
+
+/**
+ * Defaults of the command line options.
+ */
+
+#define BENCH_FACES "10000,100000,1000000"
+#define BENCH_RUNS 5
+#define BENCH_TOLERANCE 10.0
+
+/**
+ * Most shapes or sizes given on the command line.
+ */
+
+#define BENCH_LIST_MAX 32
+
+static const char *usage =
+  "usage: bench [options]\n"
+  "\n"
+  "  -s, --shapes <list>     comma separated shapes (default: all)\n"
+  "  -n, --faces <list>      comma separated face counts\n"
+  "                          (default: " BENCH_FACES ")\n"
+  "  -r, --runs <n>          timed runs per measurement (default: 5)\n"
+  "  -t, --threads <n>       parser worker threads (default: 0)\n"
+  "  -f, --file <path>       generate sources into <path> and parse it\n"
+  "                          with sop_parser_execute_file(), removed\n"
+  "                          once done\n"
+  "  -o, --output <path>     write the report to <path> (default: stdout)\n"
+  "  -c, --compare <path>    compare median MB/s with an earlier report,\n"
+  "                          exits with 1 when a case got slower\n"
+  "  -T, --tolerance <pct>   slowdown --compare allows (default: 10)\n"
+  "  -g, --generate          write the first shape and size to --file or\n"
+  "                          stdout and exit\n"
+  "  -h, --help              show this help\n"
+  "\n"
+  "shapes: tri, quad, tri-vn, quad-vn, comments, materials, mtl\n";
+
+typedef struct bench_options bench_options_t;
+struct bench_options {
+  const gen_shape_t *shapes[BENCH_LIST_MAX];
+  int shapecount;
+  size_t faces[BENCH_LIST_MAX];
+  int facecount;
+  int runs;
+  int threads;
+  const char *file;
+  const char *output;
+  const char *compare;
+  double tolerance;
+  int generate;
+};
+
+/**
+ * A source being measured.
+ */
+
+typedef struct bench_source bench_source_t;
+struct bench_source {
+  const gen_shape_t *shape;
+  size_t faces;
+  gen_counts_t counts;
+
+  // generated bytes when not parsed from `path`
+  const char *data;
+  const char *path;
+};
+
+/**
+ * Directives timed on their own. Each one is measured with only its
+ * callback set and costed against a run without callbacks, which only
+ * scans lines and resolves directives.
+ */
+
+typedef struct bench_directive bench_directive_t;
+struct bench_directive {
+  // report column
+  const char *name;
+  sop_enum_t type;
+};
+
+static const bench_directive_t directives[] = {
+  { "v_ns", SOP_DIRECTIVE_VERTEX },
+  { "vt_ns", SOP_DIRECTIVE_VERTEX_TEXTURE },
+  { "vn_ns", SOP_DIRECTIVE_VERTEX_NORMAL },
+  { "f_ns", SOP_DIRECTIVE_FACE },
+  { "comment_ns", SOP_COMMENT },
+  { "usemtl_ns", SOP_DIRECTIVE_USE_MTL },
+  { "newmtl_ns", SOP_DIRECTIVE_MATERIAL_NEW },
+  { "kd_ns", SOP_DIRECTIVE_MATERIAL_DIFFUSE_COLOR },
+};
+
+#define BENCH_DIRECTIVES (sizeof(directives) / sizeof(directives[0]))
+
+static int
+on_line(const sop_parser_state_t *state, const sop_parser_line_state_t line) {
+  (*(size_t *) state->data)++;
+  return SOP_EOK;
+}
+
+static void
+bench_set_callback(sop_parser_options_t *options, sop_enum_t type) {
+  switch (type) {
+    case SOP_DIRECTIVE_VERTEX:
+      options->callbacks.on_vertex = on_line; break;
+    case SOP_DIRECTIVE_VERTEX_TEXTURE:
+      options->callbacks.on_texture = on_line; break;
+    case SOP_DIRECTIVE_VERTEX_NORMAL:
+      options->callbacks.on_normal = on_line; break;
+    case SOP_DIRECTIVE_FACE:
+      options->callbacks.on_face = on_line; break;
+    case SOP_COMMENT:
+      options->callbacks.on_comment = on_line; break;
+    case SOP_DIRECTIVE_USE_MTL:
+      options->callbacks.on_material_use = on_line; break;
+    case SOP_DIRECTIVE_MATERIAL_NEW:
+      options->callbacks.on_material_new = on_line; break;
+    case SOP_DIRECTIVE_MATERIAL_DIFFUSE_COLOR:
+      options->callbacks.on_material_diffuse = on_line; break;
+    default: break;
+  }
+}
+
+/**
+ * Lines of a directive in a source.
+ */
+
+static size_t
+bench_directive_count(const bench_source_t *source, sop_enum_t type) {
+  switch (type) {
+    case SOP_DIRECTIVE_VERTEX: return source->counts.vertices;
+    case SOP_DIRECTIVE_VERTEX_TEXTURE: return source->counts.textures;
+    case SOP_DIRECTIVE_VERTEX_NORMAL: return source->counts.normals;
+    case SOP_DIRECTIVE_FACE: return source->counts.faces;
+    case SOP_COMMENT: return source->counts.comments;
+    case SOP_DIRECTIVE_USE_MTL: return source->counts.uses;
+    case SOP_DIRECTIVE_MATERIAL_NEW: return source->counts.materials;
+    case SOP_DIRECTIVE_MATERIAL_DIFFUSE_COLOR:
+      return source->counts.materials;
+    default: return 0;
+  }
+}
+
+static double
+bench_now(void) {
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return (double) now.tv_sec + (double) now.tv_nsec / 1e9;
+}
+
+static int
+bench_compare_doubles(const void *a, const void *b) {
+  const double x = *(const double *) a;
+  const double y = *(const double *) b;
+  return (x > y) - (x < y);
+}
+
+/**
+ * Parses `source` `runs` times with `options` and writes the best and
+ * the median run time in seconds. Materials are interned into a table
+ * when `materials` is set. Returns SOP_EOK or the parser error.
+ */
+
+static int
+bench_measure(const bench_source_t *source,
+              sop_parser_options_t *options,
+              int materials,
+              int runs,
+              double *best,
+              double *median) {
+  double *times = (double *) calloc((size_t) runs, sizeof(double));
+  size_t notified = 0;
+  int rc = SOP_EOK;
+
+  if (!times) {
+    return SOP_EMEM;
+  }
+
+  options->data = &notified;
+
+  for (int i = 0; i < runs && SOP_EOK == rc; ++i) {
+    sop_parser_t parser;
+    sop_materials_t table;
+    double start = 0;
+
+    memset(&table, 0, sizeof(table));
+    if (materials) {
+      options->materials = &table;
+    }
+
+    rc = sop_parser_init(&parser, options);
+    if (SOP_EOK != rc) {
+      break;
+    }
+
+    start = bench_now();
+    rc = source->path
+      ? sop_parser_execute_file(&parser, source->path)
+      : sop_parser_execute(&parser, source->data, source->counts.bytes);
+    times[i] = bench_now() - start;
+
+    sop_parser_destroy(&parser);
+    sop_materials_destroy(&table);
+    options->materials = 0;
+  }
+
+  qsort(times, (size_t) runs, sizeof(double), bench_compare_doubles);
+  *best = times[0];
+  *median = times[runs / 2];
+  free(times);
+  return rc;
+}
+
+static void
+bench_header(FILE *report) {
+  fprintf(report, "case\tbytes\tlines\truns\tbest_mbs\tmedian_mbs"
+                  "\tlines_per_s\tscan_ns");
+  for (size_t i = 0; i < BENCH_DIRECTIVES; ++i) {
+    fprintf(report, "\t%s", directives[i].name);
+  }
+  fprintf(report, "\n");
+}
+
+/**
+ * Measures a source and writes its report row. The case is named
+ * <shape>-<faces>. Returns the median MB/s or a negative value when
+ * the source failed to parse.
+ */
+
+static double
+bench_source(const bench_source_t *source,
+             const bench_options_t *options,
+             FILE *report) {
+  const double bytes = (double) source->counts.bytes;
+  const double lines = (double) source->counts.lines;
+  sop_parser_options_t parser = { .threads = options->threads };
+  double best = 0;
+  double median = 0;
+  double scan = 0;
+  double unused = 0;
+
+  for (size_t i = 0; i < BENCH_DIRECTIVES; ++i) {
+    bench_set_callback(&parser, directives[i].type);
+  }
+
+  // material shapes intern their materials like a loader would
+  if (SOP_EOK != bench_measure(source, &parser,
+                               source->shape->materials ||
+                               source->shape->library,
+                               options->runs, &best, &median)) {
+    return -1;
+  }
+
+  fprintf(report, "%s-%zu\t%zu\t%zu\t%d\t%.1f\t%.1f\t%.0f",
+          source->shape->name, source->faces,
+          source->counts.bytes, source->counts.lines, options->runs,
+          bytes / best / 1e6, bytes / median / 1e6, lines / median);
+
+  // the cost of scanning alone, every directive is skipped
+  memset(&parser, 0, sizeof(parser));
+  parser.threads = options->threads;
+  if (SOP_EOK != bench_measure(source, &parser, 0, options->runs,
+                               &unused, &scan)) {
+    return -1;
+  }
+  fprintf(report, "\t%.2f", lines ? scan / lines * 1e9 : 0);
+
+  for (size_t i = 0; i < BENCH_DIRECTIVES; ++i) {
+    const size_t count = bench_directive_count(source, directives[i].type);
+    double seconds = 0;
+
+    if (0 == count) {
+      fprintf(report, "\t-");
+      continue;
+    }
+
+    memset(&parser, 0, sizeof(parser));
+    parser.threads = options->threads;
+    bench_set_callback(&parser, directives[i].type);
+    if (SOP_EOK != bench_measure(source, &parser, 0, options->runs,
+                                 &unused, &seconds)) {
+      return -1;
+    }
+
+    // a directive can't cost less than nothing, noise aside
+    seconds = seconds > scan ? seconds - scan : 0;
+    fprintf(report, "\t%.2f", seconds / (double) count * 1e9);
+  }
+
+  fprintf(report, "\n");
+  fflush(report);
+  return bytes / median / 1e6;
+}
+
+/**
+ * Generates a source into memory or into `options->file`.
+ */
+
+static int
+bench_generate(bench_source_t *source,
+               const bench_options_t *options,
+               gen_output_t *output) {
+  int rc = 0;
+  memset(output, 0, sizeof(gen_output_t));
+
+  if (options->file) {
+    output->file = fopen(options->file, "wb");
+    if (!output->file) {
+      perror(options->file);
+      return -1;
+    }
+  }
+
+  rc = gen_source(output, source->shape, source->faces, 1, &source->counts);
+
+  if (output->file) {
+    rc |= fclose(output->file);
+    output->file = 0;
+    source->path = options->file;
+  } else {
+    source->data = output->data;
+  }
+
+  return rc;
+}
+
+/**
+ * Looks up the median MB/s of case `name` in a report written by an
+ * earlier run. Returns a negative value when the case isn't there.
+ */
+
+static double
+bench_baseline(FILE *baseline, const char *name) {
+  char line[1024];
+  rewind(baseline);
+  while (fgets(line, sizeof(line), baseline)) {
+    char casename[256];
+    double median = 0;
+    if (2 == sscanf(line, "%255s %*s %*s %*s %*s %lf", casename, &median) &&
+        0 == strcmp(casename, name)) {
+      return median;
+    }
+  }
+  return -1;
+}
+
+/**
+ * Parses a comma separated list into `items` with `parse`.
+ */
+
+static int
+bench_list(char *list, int (*parse)(const char *, bench_options_t *, int),
+           bench_options_t *options) {
+  int count = 0;
+  for (char *item = strtok(list, ","); item; item = strtok(0, ",")) {
+    if (count == BENCH_LIST_MAX || 0 != parse(item, options, count)) {
+      fprintf(stderr, "bench: bad list item '%s'\n", item);
+      return -1;
+    }
+    count++;
+  }
+  return count;
+}
+
+static int
+bench_parse_shape(const char *item, bench_options_t *options, int i) {
+  options->shapes[i] = gen_shape_find(item);
+  return options->shapes[i] ? 0 : -1;
+}
+
+static int
+bench_parse_faces(const char *item, bench_options_t *options, int i) {
+  char *end = 0;
+  options->faces[i] = (size_t) strtoull(item, &end, 10);
+  return *end || 0 == options->faces[i] ? -1 : 0;
+}
+
+static int
+bench_arguments(int argc, char **argv, bench_options_t *options) {
+  static char faces[] = BENCH_FACES;
+  char *shapes = 0;
+  char *sizes = faces;
+
+  for (int i = 1; i < argc; ++i) {
+    const char *arg = argv[i];
+    const char *value = i + 1 < argc ? argv[i + 1] : 0;
+
+#define OPTION(short, long) \
+  (0 == strcmp(arg, short) || 0 == strcmp(arg, long))
+
+    if (OPTION("-h", "--help")) {
+      printf("%s", usage);
+      exit(0);
+    } else if (OPTION("-g", "--generate")) {
+      options->generate = 1;
+      continue;
+    }
+
+    if (!value) {
+      fprintf(stderr, "bench: unknown or incomplete option '%s'\n%s",
+              arg, usage);
+      return -1;
+    }
+
+    if (OPTION("-s", "--shapes")) {
+      shapes = argv[i + 1];
+    } else if (OPTION("-n", "--faces")) {
+      sizes = argv[i + 1];
+    } else if (OPTION("-r", "--runs")) {
+      options->runs = atoi(value);
+    } else if (OPTION("-t", "--threads")) {
+      options->threads = atoi(value);
+    } else if (OPTION("-f", "--file")) {
+      options->file = value;
+    } else if (OPTION("-o", "--output")) {
+      options->output = value;
+    } else if (OPTION("-c", "--compare")) {
+      options->compare = value;
+    } else if (OPTION("-T", "--tolerance")) {
+      options->tolerance = atof(value);
+    } else {
+      fprintf(stderr, "bench: unknown option '%s'\n%s", arg, usage);
+      return -1;
+    }
+
+#undef OPTION
+
+    i++;
+  }
+
+  if (options->runs < 1) {
+    options->runs = 1;
+  }
+
+  if (shapes) {
+    options->shapecount = bench_list(shapes, bench_parse_shape, options);
+  } else {
+    for (const gen_shape_t *shape = gen_shapes; shape->name; ++shape) {
+      options->shapes[options->shapecount++] = shape;
+    }
+  }
+
+  options->facecount = bench_list(sizes, bench_parse_faces, options);
+  return options->shapecount > 0 && options->facecount > 0 ? 0 : -1;
+}
+
+int
+main(int argc, char **argv) {
+  bench_options_t options = {
+    .runs = BENCH_RUNS,
+    .tolerance = BENCH_TOLERANCE,
+  };
+  FILE *report = stdout;
+  FILE *baseline = 0;
+  int regressions = 0;
+  int rc = 0;
+
+  if (0 != bench_arguments(argc, argv, &options)) {
+    return 2;
+  }
+
+  if (options.generate) {
+    gen_output_t output = { .file = stdout };
+    gen_counts_t counts;
+    if (options.file) {
+      output.file = fopen(options.file, "wb");
+      if (!output.file) {
+        perror(options.file);
+        return 1;
+      }
+    }
+    rc = gen_source(&output, options.shapes[0], options.faces[0], 1, &counts);
+    if (output.file != stdout) {
+      rc |= fclose(output.file);
+    }
+    gen_output_destroy(&output);
+    return rc ? 1 : 0;
+  }
+
+  if (options.output) {
+    report = fopen(options.output, "w");
+    if (!report) {
+      perror(options.output);
+      return 1;
+    }
+  }
+
+  if (options.compare) {
+    baseline = fopen(options.compare, "r");
+    if (!baseline) {
+      perror(options.compare);
+      return 1;
+    }
+  }
+
+  bench_header(report);
+
+  for (int i = 0; i < options.shapecount && 0 == rc; ++i) {
+    for (int j = 0; j < options.facecount && 0 == rc; ++j) {
+      bench_source_t source = {
+        .shape = options.shapes[i],
+        .faces = options.faces[j],
+      };
+      gen_output_t output;
+      char name[256];
+      double median = 0;
+      double previous = 0;
+
+      if (0 != bench_generate(&source, &options, &output)) {
+        fprintf(stderr, "bench: could not generate %s-%zu\n",
+                source.shape->name, source.faces);
+        rc = 1;
+      } else if ((median = bench_source(&source, &options, report)) < 0) {
+        fprintf(stderr, "bench: could not parse %s-%zu\n",
+                source.shape->name, source.faces);
+        rc = 1;
+      }
+
+      gen_output_destroy(&output);
+
+      snprintf(name, sizeof(name), "%s-%zu", source.shape->name,
+               source.faces);
+      if (0 == rc && baseline &&
+          (previous = bench_baseline(baseline, name)) > 0 &&
+          median < previous * (1 - options.tolerance / 100)) {
+        fprintf(stderr, "bench: %s regressed from %.1f to %.1f MB/s\n",
+                name, previous, median);
+        regressions++;
+      }
+    }
+  }
+
+  if (options.file) {
+    remove(options.file);
+  }
+
+  if (report != stdout) {
+    fclose(report);
+  }
+
+  if (baseline) {
+    fclose(baseline);
+  }
+
+  return rc || regressions ? 1 : 0;
+}
@@ -0,0 +1,359 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include "gen.h"
+
+const gen_shape_t gen_shapes[] = {
+  { .name = "tri", .corners = 3, .textures = 1 },
+  { .name = "quad", .corners = 4, .textures = 1 },
+  { .name = "tri-vn", .corners = 3 },
+  { .name = "quad-vn", .corners = 4 },
+  { .name = "comments", .corners = 3, .textures = 1, .comments = 1 },
+  { .name = "materials", .corners = 3, .textures = 1, .materials = 1 },
+  { .name = "mtl", .library = 1 },
+  { 0 }
+};
+
+/**
+ * Cells per grid row.
+ */
+
+#define GEN_COLUMNS 1024
+
+const gen_shape_t *
+gen_shape_find(const char *name) {
+  for (const gen_shape_t *shape = gen_shapes; shape->name; ++shape) {
+    if (0 == strcmp(shape->name, name)) {
+      return shape;
+    }
+  }
+  return 0;
+}
+
+int
+gen_flush(gen_output_t *output) {
+  if (output->file && output->length) {
+    if (output->length != fwrite(output->data, 1, output->length,
+                                 output->file)) {
+      output->error = 1;
+    }
+    output->length = 0;
+  }
+  return output->error;
+}
+
+void
+gen_output_destroy(gen_output_t *output) {
+  free(output->data);
+  output->data = 0;
+  output->length = output->capacity = 0;
+}
+
+/**
+ * Returns room for `size` more bytes at the end of the output or 0.
+ */
+
+static char *
+gen_reserve(gen_output_t *output, size_t size) {
+  if (output->file && output->length >= GEN_FLUSH_SIZE) {
+    gen_flush(output);
+  }
+
+  if (output->length + size > output->capacity) {
+    size_t capacity = output->capacity ? output->capacity : GEN_FLUSH_SIZE;
+    char *data = 0;
+    while (capacity < output->length + size) {
+      capacity *= 2;
+    }
+    data = (char *) realloc(output->data, capacity);
+    if (!data) {
+      output->error = 1;
+      return 0;
+    }
+    output->data = data;
+    output->capacity = capacity;
+  }
+
+  return output->data + output->length;
+}
+
+static void
+gen_write(gen_output_t *output, const char *bytes, size_t size) {
+  char *p = gen_reserve(output, size);
+  if (p) {
+    memcpy(p, bytes, size);
+    output->length += size;
+  }
+}
+
+static void
+gen_string(gen_output_t *output, const char *string) {
+  gen_write(output, string, strlen(string));
+}
+
+static void
+gen_unsigned(gen_output_t *output, size_t value) {
+  char digits[24];
+  size_t n = sizeof(digits);
+  do {
+    digits[--n] = (char) ('0' + value % 10);
+    value /= 10;
+  } while (value);
+  gen_write(output, digits + n, sizeof(digits) - n);
+}
+
+/**
+ * Writes `micros` millionths with six decimals, the way most exporters
+ * print coordinates.
+ */
+
+static void
+gen_fixed(gen_output_t *output, int64_t micros) {
+  char digits[8];
+  uint64_t magnitude = micros < 0 ? (uint64_t) -micros : (uint64_t) micros;
+  if (micros < 0) {
+    gen_write(output, "-", 1);
+  }
+
+  gen_unsigned(output, (size_t) (magnitude / 1000000));
+  digits[0] = '.';
+  magnitude %= 1000000;
+  for (int i = 6; i > 0; --i) {
+    digits[i] = (char) ('0' + magnitude % 10);
+    magnitude /= 10;
+  }
+  gen_write(output, digits, 7);
+}
+
+/**
+ * xorshift64, deterministic across platforms.
+ */
+
+static uint64_t
+gen_random(uint64_t *state) {
+  uint64_t x = *state;
+  x ^= x << 13;
+  x ^= x >> 7;
+  x ^= x << 17;
+  return *state = x;
+}
+
+/**
+ * Random millionths in [-range, range].
+ */
+
+static int64_t
+gen_noise(uint64_t *state, int64_t range) {
+  return (int64_t) (gen_random(state) % (uint64_t) (2 * range + 1)) - range;
+}
+
+/**
+ * Ends a line, adding a comment line after every GEN_COMMENT_EVERY
+ * lines when the shape asks for comments.
+ */
+
+static void
+gen_line(gen_output_t *output,
+         const gen_shape_t *shape,
+         gen_counts_t *counts) {
+  gen_write(output, "\n", 1);
+  counts->lines++;
+
+  if (shape->comments && 0 == counts->lines % GEN_COMMENT_EVERY) {
+    char comment[GEN_COMMENT_SIZE];
+    memset(comment, 'x', sizeof(comment));
+    memcpy(comment, "# exported by a synthetic generator ", 36);
+    comment[sizeof(comment) - 1] = '\n';
+    gen_write(output, comment, sizeof(comment));
+    counts->lines++;
+    counts->comments++;
+  }
+}
+
+static size_t
+gen_material_count(size_t faces) {
+  size_t count = faces / GEN_MATERIAL_FACES;
+  if (0 == count) {
+    count = 1;
+  }
+  return count > GEN_MATERIAL_MAX ? GEN_MATERIAL_MAX : count;
+}
+
+static void
+gen_library(gen_output_t *output,
+            const gen_shape_t *shape,
+            size_t faces,
+            uint64_t *state,
+            gen_counts_t *counts) {
+  static const char *colors[] = { "Ka ", "Kd ", "Ks ", "Ke " };
+  const size_t count = gen_material_count(faces);
+
+  for (size_t i = 0; i < count; ++i) {
+    gen_string(output, "newmtl material_");
+    gen_unsigned(output, i);
+    gen_line(output, shape, counts);
+
+    for (size_t j = 0; j < sizeof(colors) / sizeof(colors[0]); ++j) {
+      gen_string(output, colors[j]);
+      for (int k = 0; k < 3; ++k) {
+        if (k) {
+          gen_write(output, " ", 1);
+        }
+        gen_fixed(output, (int64_t) (gen_random(state) % 1000001));
+      }
+      gen_line(output, shape, counts);
+    }
+
+    gen_string(output, "Ns ");
+    gen_fixed(output, (int64_t) (gen_random(state) % 1000000001));
+    gen_line(output, shape, counts);
+    gen_string(output, "d 1.000000");
+    gen_line(output, shape, counts);
+    gen_string(output, "Ni 1.450000");
+    gen_line(output, shape, counts);
+    gen_string(output, "illum 2");
+    gen_line(output, shape, counts);
+    gen_string(output, "map_Kd -s 1 1 1 textures/material_");
+    gen_unsigned(output, i);
+    gen_string(output, ".png");
+    gen_line(output, shape, counts);
+
+    counts->materials++;
+  }
+}
+
+static void
+gen_corner(gen_output_t *output, const gen_shape_t *shape, size_t index) {
+  gen_unsigned(output, index);
+  gen_write(output, "/", 1);
+  if (shape->textures) {
+    gen_unsigned(output, index);
+  }
+  gen_write(output, "/", 1);
+  gen_unsigned(output, index);
+}
+
+static void
+gen_mesh(gen_output_t *output,
+         const gen_shape_t *shape,
+         size_t faces,
+         uint64_t *state,
+         gen_counts_t *counts) {
+  const size_t cells = 4 == shape->corners ? faces : (faces + 1) / 2;
+  const size_t columns = cells < GEN_COLUMNS ? (cells ? cells : 1)
+                                             : GEN_COLUMNS;
+  const size_t rows = (cells + columns - 1) / columns;
+  const size_t materials = gen_material_count(faces);
+  size_t emitted = 0;
+
+  if (shape->materials) {
+    gen_string(output, "mtllib bench.mtl");
+    gen_line(output, shape, counts);
+  }
+
+  gen_string(output, "o bench");
+  gen_line(output, shape, counts);
+
+  // a (rows + 1) x (columns + 1) grid of slightly perturbed vertices
+  for (size_t r = 0; r <= rows; ++r) {
+    for (size_t c = 0; c <= columns; ++c) {
+      gen_string(output, "v ");
+      gen_fixed(output, (int64_t) c * 10000 + gen_noise(state, 2500));
+      gen_write(output, " ", 1);
+      gen_fixed(output, gen_noise(state, 50000));
+      gen_write(output, " ", 1);
+      gen_fixed(output, (int64_t) r * 10000 + gen_noise(state, 2500));
+      gen_line(output, shape, counts);
+      counts->vertices++;
+    }
+  }
+
+  if (shape->textures) {
+    for (size_t r = 0; r <= rows; ++r) {
+      for (size_t c = 0; c <= columns; ++c) {
+        gen_string(output, "vt ");
+        gen_fixed(output, (int64_t) (c * 1000000 / columns));
+        gen_write(output, " ", 1);
+        gen_fixed(output, (int64_t) (r * 1000000 / (rows ? rows : 1)));
+        gen_line(output, shape, counts);
+        counts->textures++;
+      }
+    }
+  }
+
+  for (size_t r = 0; r <= rows; ++r) {
+    for (size_t c = 0; c <= columns; ++c) {
+      gen_string(output, "vn ");
+      gen_fixed(output, gen_noise(state, 100000));
+      gen_string(output, " 0.990000 ");
+      gen_fixed(output, gen_noise(state, 100000));
+      gen_line(output, shape, counts);
+      counts->normals++;
+    }
+  }
+
+  for (size_t r = 0; r < rows && emitted < faces; ++r) {
+    for (size_t c = 0; c < columns && emitted < faces; ++c) {
+      const size_t a = r * (columns + 1) + c + 1;
+      const size_t b = a + 1;
+      const size_t d = a + columns + 1;
+      const size_t e = d + 1;
+      const size_t quad[4] = { a, b, e, d };
+      const size_t triangles[2][3] = { { a, b, e }, { a, e, d } };
+
+      for (int t = 0; t < (4 == shape->corners ? 1 : 2); ++t) {
+        const size_t *corners = 4 == shape->corners ? quad : triangles[t];
+
+        if (emitted >= faces) {
+          break;
+        }
+
+        if (shape->materials && 0 == emitted % GEN_MATERIAL_FACES) {
+          gen_string(output, "usemtl material_");
+          gen_unsigned(output, (emitted / GEN_MATERIAL_FACES) % materials);
+          gen_line(output, shape, counts);
+          counts->uses++;
+        }
+
+        gen_write(output, "f", 1);
+        for (int i = 0; i < shape->corners; ++i) {
+          gen_write(output, " ", 1);
+          gen_corner(output, shape, corners[i]);
+        }
+        gen_line(output, shape, counts);
+        counts->faces++;
+        emitted++;
+      }
+    }
+  }
+}
+
+int
+gen_source(gen_output_t *output,
+           const gen_shape_t *shape,
+           size_t faces,
+           unsigned long seed,
+           gen_counts_t *counts) {
+  uint64_t state = 0x9e3779b97f4a7c15ULL ^ (uint64_t) seed;
+  size_t start = output->length;
+  memset(counts, 0, sizeof(gen_counts_t));
+
+  if (shape->library) {
+    gen_library(output, shape, faces, &state, counts);
+  } else {
+    gen_mesh(output, shape, faces, &state, counts);
+  }
+
+  // bytes flushed to a file were counted out of `length` as they went
+  counts->bytes = output->length - start;
+  if (output->file) {
+    long position = 0;
+    gen_flush(output);
+    fflush(output->file);
+    position = ftell(output->file);
+    counts->bytes = position > 0 ? (size_t) position : 0;
+  }
+
+  return output->error ? -1 : 0;
+}
@@ -0,0 +1,128 @@
+#ifndef LIBSOP_BENCH_GEN_H
+#define LIBSOP_BENCH_GEN_H
+
+#include <stdio.h>
+#include <stddef.h>
+
+/**
+ * Shape of a synthetic OBJ source.
+ */
+
+typedef struct gen_shape gen_shape_t;
+struct gen_shape {
+  // name used on the command line and in reports
+  const char *name;
+
+  // corners per face, 3 or 4
+  int corners;
+
+  // when set vertices have texture coordinates and faces use v/vt/vn,
+  // otherwise faces use v//vn
+  int textures;
+
+  // when set a long comment line follows every GEN_COMMENT_EVERY lines
+  int comments;
+
+  // when set faces switch to a new material every GEN_MATERIAL_FACES
+  // faces (usemtl) and the source references a material library
+  int materials;
+
+  // when set the source is the material library itself
+  int library;
+};
+
+/**
+ * Lines between two comment lines of a `comments` shape.
+ */
+
+#define GEN_COMMENT_EVERY 4
+
+/**
+ * Bytes of a comment line of a `comments` shape.
+ */
+
+#define GEN_COMMENT_SIZE 160
+
+/**
+ * Faces between two usemtl lines of a `materials` shape.
+ */
+
+#define GEN_MATERIAL_FACES 64
+
+/**
+ * Most distinct materials of a source, usemtl cycles through them.
+ */
+
+#define GEN_MATERIAL_MAX 65536
+
+/**
+ * Lines of each kind in a generated source.
+ */
+
+typedef struct gen_counts gen_counts_t;
+struct gen_counts {
+  size_t bytes;
+  size_t lines;
+  size_t vertices;
+  size_t textures;
+  size_t normals;
+  size_t faces;
+  size_t comments;
+
+  // usemtl and newmtl lines
+  size_t uses;
+  size_t materials;
+};
+
+/**
+ * Where a generated source goes. Bytes collect in `data` and are
+ * written out to `file` once GEN_FLUSH_SIZE bytes are pending when
+ * `file` is set, so sources larger than memory can be generated.
+ */
+
+typedef struct gen_output gen_output_t;
+struct gen_output {
+  char *data;
+  size_t length;
+  size_t capacity;
+  FILE *file;
+
+  // set when memory or the file ran out
+  int error;
+};
+
+#define GEN_FLUSH_SIZE (1024 * 1024)
+
+/**
+ * Generates a source of `shape` with about `faces` faces. The same
+ * shape, size and seed always generate the same bytes. Returns 0 on
+ * success.
+ */
+
+int
+gen_source(gen_output_t *output,
+           const gen_shape_t *shape,
+           size_t faces,
+           unsigned long seed,
+           gen_counts_t *counts);
+
+/**
+ * Writes out pending bytes when `output->file` is set.
+ */
+
+int
+gen_flush(gen_output_t *output);
+
+void
+gen_output_destroy(gen_output_t *output);
+
+/**
+ * Built in shapes, terminated by an entry without a name.
+ */
+
+extern const gen_shape_t gen_shapes[];
+
+const gen_shape_t *
+gen_shape_find(const char *name);
+
+#endif
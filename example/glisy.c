@@ -12,9 +12,6 @@
 #define WINDOW_WIDTH 640
 #define WINDOW_HEIGHT 640
 
-#define INITIAL_VERTEX_LENGTH 66
-#define INITIAL_FACE_LENGTH 132
-
 #define dtor(d) d * (M_PI / 180)
 #define min(a, b) (a < b ? a : b < a ? b : a)
 #define max(a, b) (a > b ? a : b > a ? b : a)
@@ -123,48 +120,14 @@ InitializeCamera(Camera *camera, int width, int height) {
   UpdateCamera(camera);
 }
 
-/**
- * sop callbacks
- */
-
-static int
-on_texture(const sop_parser_state_t *state,
-           const sop_parser_line_state_t line);
-
-static int
-on_comment(const sop_parser_state_t *state,
-          const sop_parser_line_state_t line);
-
-static int
-on_vertex(const sop_parser_state_t *state,
-         const sop_parser_line_state_t line);
-
-static int
-on_normal(const sop_parser_state_t *state,
-          const sop_parser_line_state_t line);
-
-static int
-on_face(const sop_parser_state_t *state,
-        const sop_parser_line_state_t line);
-
 /**
  * simple model
  */
 
 typedef struct Model Model;
 struct Model {
-  // vao
-  float *vertices;
-  float *normals;
-  unsigned int *normalIndices;
-  unsigned int *textures;
-  unsigned int *faces;
-  unsigned int *uvs;
-
-  int verticesLength;
-  int normalsLength;
-  int facesLength;
-  int uvsLength;
+  // geometry loaded from the OBJ file
+  sop_mesh_t mesh;
 
   // glisy
   GlisyGeometry geometry;
@@ -243,126 +206,23 @@ main(int argc, const char **argv) {
   return 0;
 }
 
-static int
-on_comment(const sop_parser_state_t *state,
-          const sop_parser_line_state_t line) {
-  if (line.length && line.data) {
-    //printf("%s\n", (char *) line.data);
-  }
-  return SOP_EOK;
-}
-
-static int
-on_vertex(const sop_parser_state_t *state,
-         const sop_parser_line_state_t line) {
-  Model *model = (Model *) state->data;
-  float vertex[3];
-
-  if (line.data && line.length) {
-    memcpy(vertex, line.data, sizeof(vertex));
-  }
-
-  if (model && (!model->verticesLength || !model->vertices)) {
-    model->vertices = (float *) malloc(sizeof(float) * INITIAL_VERTEX_LENGTH);
-    model->verticesLength = 0;
-  } else if (model && model->vertices && model->verticesLength >= INITIAL_VERTEX_LENGTH) {
-    float *ptr = realloc(model->vertices, sizeof(float) * (model->verticesLength + 3));
-    if (ptr) {
-      model->vertices = ptr;
-    } else {
-      free(model->vertices);
-      model->vertices = 0;
-      return SOP_EMEM;
-    }
-  }
-
-  if (model && model->vertices) {
-    model->vertices[model->verticesLength++] = vertex[0];
-    model->vertices[model->verticesLength++] = vertex[1];
-    model->vertices[model->verticesLength++] = vertex[2];
-  }
-
-  return SOP_EOK;
-}
-
-static int
-on_face(const sop_parser_state_t *state,
-       const sop_parser_line_state_t line) {
-  Model *model = (Model *) state->data;
-  int face[3][3];
-  int vf[3];
-
-  if (line.data && line.length) {
-    memcpy(face, line.data, sizeof(face));
-    vf[0] = face[0][0];
-    vf[1] = face[0][1];
-    vf[2] = face[0][2];
-  }
-
-  if (model && (!model->facesLength || !model->faces)) {
-    model->faces = (unsigned int *) malloc(sizeof(unsigned int) * INITIAL_FACE_LENGTH);
-    model->facesLength = 0;
-  } else if (model && model->faces && model->facesLength >= INITIAL_FACE_LENGTH) {
-    unsigned int *ptr = realloc(model->faces, sizeof(unsigned int) * (model->facesLength + 3));
-    if (ptr) {
-      model->faces = ptr;
-    } else {
-      return SOP_EMEM;
-    }
-  }
-
-  if (model && model->faces) {
-    {
-      if (vf[0] > -1) {
-        model->faces[model->facesLength++] = vf[0];
-      }
-
-      if (vf[1] > -1) {
-        model->faces[model->facesLength++] = vf[1];
-      }
-
-      if (vf[2] > -1) {
-        model->faces[model->facesLength++] = vf[2];
-      }
-    }
-  }
-
-  return SOP_EOK;
-}
-
 static void
 InitializeModel(Model *model, const char *objfile) {
+  // indices are drawn as triangles
+  static sop_mesh_options_t options = { .triangulate = 1 };
   char *src = fs_read(objfile);
-  sop_parser_t parser;
-  sop_parser_options_t options = {
-    .callbacks = {
-      .on_comment = on_comment,
-      .on_vertex = on_vertex,
-      .on_face = on_face,
-    }
-  };
 
   if (!src) {
     printf("file %s not found\n", objfile);
     exit(0);
   }
 
-  model->verticesLength = 0;
-  model->normalsLength = 0;
-  model->facesLength = 0;
-  model->uvsLength = 0;
-
-  model->vertices = 0;
-  model->normals = 0;
-  model->faces = 0;
-  model->uvs = 0;
-
-  options.data = model;
-  assert(SOP_EOK == sop_parser_init(&parser, &options));
-  assert(SOP_EOK == sop_parser_execute(&parser, src, strlen(src)));
+  assert(SOP_EOK == sop_mesh_init(&model->mesh, &options));
+  assert(SOP_EOK == sop_mesh_load(src, strlen(src), &model->mesh));
+  free(src);
 
-  printf("*vertex count = %d\n", model->verticesLength / 3);
-  printf("*face count = %d\n", model->facesLength / 3);
+  printf("*vertex count = %zu\n", model->mesh.position_count);
+  printf("*face count = %zu\n", model->mesh.face_count);
 
   // init color
   GlisyColor color;
@@ -378,11 +238,11 @@ InitializeModel(Model *model, const char *objfile) {
   glisyUniformBind(&uColor, 0);
 
   model->position = vec3(0, 0, 0);
-  GLuint size = sizeof(float) * model->verticesLength;
+  GLuint size = sizeof(float) * 3 * model->mesh.position_count;
 
   GlisyVAOAttribute vPosition = {
     .buffer = {
-      .data = (void *) model->vertices,
+      .data = (void *) model->mesh.positions,
       .type = GL_FLOAT,
       .size = size,
       .usage = GL_STATIC_DRAW,
@@ -401,8 +261,8 @@ InitializeModel(Model *model, const char *objfile) {
   glisyGeometryAttr(&model->geometry, "vPosition", &vPosition);
   glisyGeometryFaces(&model->geometry,
                        GL_UNSIGNED_INT,
-                       model->facesLength,
-                       (void *) model->faces);
+                       model->mesh.index_count,
+                       (void *) model->mesh.position_indices);
 
   // update geometry with attributes and faces
   glisyGeometryUpdate(&model->geometry);
@@ -421,7 +281,8 @@ void
 DrawModel(Model *model) {
   UpdateModel(model);
   glisyGeometryBind(&model->geometry, 0);
-  glisyGeometryDraw(&model->geometry, GL_TRIANGLES, 0, model->facesLength);
+  glisyGeometryDraw(&model->geometry, GL_TRIANGLES, 0,
+                    model->mesh.index_count);
   glisyGeometryUnbind(&model->geometry);
 }
 
@@ -6,16 +6,31 @@ extern "C" {
 #endif
 
 #include <stddef.h>
+#include <stdint.h>
 
 /**
  * SOP types.
  */
 
-typedef enum sop_enum sop_enum_t;
 typedef struct sop_parser sop_parser_t;
 typedef struct sop_parser_state sop_parser_state_t;
 typedef struct sop_parser_options sop_parser_options_t;
 typedef struct sop_parser_line_state sop_parser_line_state_t;
+typedef struct sop_parser_batch sop_parser_batch_t;
+typedef struct sop_parser_counts sop_parser_counts_t;
+typedef struct sop_parser_stats sop_parser_stats_t;
+typedef struct sop_parser_range sop_parser_range_t;
+typedef struct sop_parser_group sop_parser_group_t;
+typedef struct sop_reader sop_reader_t;
+typedef struct sop_reader_options sop_reader_options_t;
+typedef struct sop_reader_event sop_reader_event_t;
+typedef struct sop_material sop_material_t;
+typedef struct sop_materials sop_materials_t;
+typedef struct sop_allocator sop_allocator_t;
+typedef struct sop_arena sop_arena_t;
+typedef struct sop_trace sop_trace_t;
+typedef struct sop_mesh sop_mesh_t;
+typedef struct sop_mesh_options sop_mesh_options_t;
 
 /**
  * This function pointer typedef defines the signature for a line callback
@@ -24,6 +39,100 @@ typedef struct sop_parser_line_state sop_parser_line_state_t;
 typedef int (* sop_parser_line_cb) (const sop_parser_state_t *state,
                                     const sop_parser_line_state_t);
 
+/**
+ * This function pointer typedef defines the signature for a batch
+ * callback receiving many decoded lines of the same directive at once.
+ */
+
+typedef int (* sop_parser_batch_cb) (const sop_parser_state_t *state,
+                                     const sop_parser_batch_t *batch);
+
+/**
+ * This function pointer typedef defines the signature for a callback
+ * notified once an object or group has been parsed completely.
+ */
+
+typedef int (* sop_parser_group_cb) (const sop_parser_state_t *state,
+                                     const sop_parser_group_t *group);
+
+/**
+ * Memory hooks for the memory owned by parsers, meshes and material
+ * tables. They behave like malloc(), realloc() and free(): reallocating
+ * 0 allocates and deallocating 0 does nothing. Hooks are called from
+ * worker threads too, at the same time when `threads` is set.
+ */
+
+struct sop_allocator {
+  void *(* allocate) (void *data, size_t size);
+  void *(* reallocate) (void *data, void *ptr, size_t size);
+  void (* deallocate) (void *data, void *ptr);
+
+  // user pointer given to the hooks
+  void *data;
+};
+
+/**
+ * A bump allocator handing out memory from large blocks. Freeing only
+ * reclaims the latest allocation, which can also grow in place, and
+ * everything is released at once by sop_arena_reset() or
+ * sop_arena_destroy(). Safe to use from several threads.
+ */
+
+struct sop_arena {
+  // hooks allocating from the arena, pass `&arena.allocator`
+  sop_allocator_t allocator;
+
+  // size of the blocks allocations are carved out of
+  size_t block_size;
+
+  // blocks in use, the one allocations are carved out of first
+  struct sop_arena_block *blocks;
+
+  // bytes handed out since the last reset
+  size_t used;
+
+  // spin lock serializing the hooks
+  int lock;
+};
+
+/**
+ * Default size of the blocks of an arena.
+ */
+
+#define SOP_ARENA_BLOCK_SIZE (1024 * 1024)
+
+/**
+ * Records parse phases (scanning, decoding, callbacks, groups, material
+ * libraries, mesh stages) of every thread for viewing on a timeline in
+ * chrome://tracing or Perfetto. Each thread appends to its own buffer,
+ * new buffers are published with a lock free push, so recording takes
+ * no locks. Share a trace between parsers and meshes through their
+ * options.
+ */
+
+struct sop_trace {
+  // per thread event buffers, newest first
+  struct sop_trace_buffer *buffers;
+
+  // threads seen so far, numbers the buffers
+  int threads;
+
+  // tells traces apart that reuse the same memory
+  uint64_t id;
+
+  // clock at sop_trace_init(), events are timed relative to it
+  uint64_t start;
+
+  // memory hooks of the buffers, 0 uses malloc() and free()
+  sop_allocator_t *allocator;
+};
+
+/**
+ * Default number of elements delivered to a batch callback at once.
+ */
+
+#define SOP_PARSER_BATCH_SIZE 1024
+
 /**
  * SOP enum values.
  */
@@ -93,8 +202,49 @@ enum sop_enum {
   SOP_DIRECTIVE_MATERIAL_ILLUM,
   SOP_DIRECTIVE_MATERIAL_SHININESS,
   SOP_DIRECTIVE_MATERIAL_TRANSPARENCY,
+
+  /**
+   * More OBJ directive types, appended to keep the values above.
+   *
+   *   - (vp) parameter space vertices (u v w)
+   *   - (l) line (v/vt v/vt ...)
+   *   - (p) point (v v ...)
+   *   - (o) object name (name)
+   *   - (g) group names (name ...)
+   */
+
+  SOP_DIRECTIVE_VERTEX_PARAMETER,
+  SOP_DIRECTIVE_LINE,
+  SOP_DIRECTIVE_POINT,
+  SOP_DIRECTIVE_OBJECT,
+  SOP_DIRECTIVE_GROUP,
+
+  /**
+   * More material lib types.
+   *
+   *   - (Ke) emissive color (r g b a)
+   *   - (Ni) optical density (density)
+   *   - (Tf) transmission filter (r g b a)
+   *   - (map_Ka, map_Kd, map_Ks, map_Ke, map_Ns, map_d, map_Tr,
+   *      map_bump, map_Bump, bump, disp, decal, refl, norm) texture
+   *      maps (options and file name), `directive` tells them apart
+   */
+
+  SOP_DIRECTIVE_MATERIAL_EMISSIVE_COLOR,
+  SOP_DIRECTIVE_MATERIAL_OPTICAL_DENSITY,
+  SOP_DIRECTIVE_MATERIAL_TRANSMISSION_FILTER,
+  SOP_DIRECTIVE_MATERIAL_MAP,
 };
 
+// C++ does not allow naming an enum before it is defined
+typedef enum sop_enum sop_enum_t;
+
+/**
+ * Bit of a directive type in a directive mask.
+ */
+
+#define SOP_DIRECTIVE_MASK(type) ((uint64_t) 1 << (type))
+
 /**
  * The associated callback fields defined in the SOP options
  * structure and the parser structure instance. We do this to avoid
@@ -117,6 +267,20 @@ enum sop_enum {
   sop_parser_line_cb on_normal;                \
   sop_parser_line_cb on_smooth;                \
   sop_parser_line_cb on_face;                  \
+  sop_parser_line_cb on_vertex_parameter;      \
+  sop_parser_line_cb on_line;                  \
+  sop_parser_line_cb on_point;                 \
+  sop_parser_line_cb on_object;                \
+  sop_parser_line_cb on_group;                 \
+  sop_parser_line_cb on_material_emissive;     \
+  sop_parser_line_cb on_material_density;      \
+  sop_parser_line_cb on_material_transmission; \
+  sop_parser_line_cb on_material_map;          \
+  sop_parser_batch_cb on_vertices;             \
+  sop_parser_batch_cb on_textures;             \
+  sop_parser_batch_cb on_normals;              \
+  sop_parser_batch_cb on_faces;                \
+  sop_parser_group_cb on_group_complete;       \
 
 /**
  * This structure represents the options available for initializing the
@@ -127,6 +291,56 @@ struct sop_parser_options {
   // user pointer given to sop_parser_state
   void *data;
 
+  // when set, string directives (comments, usemtl, mtllib, newmtl,
+  // o, g and texture maps) point directly into the parsed source
+  // instead of a NUL terminated copy. Use `length` to bound the string.
+  int zero_copy;
+
+  // number of worker threads used to decode large sources. Callbacks
+  // are still called on the calling thread in source order. 0 or 1
+  // parses everything on the calling thread.
+  int threads;
+
+  // maximum number of elements given to a batch callback at once,
+  // 0 uses SOP_PARSER_BATCH_SIZE
+  size_t batch_size;
+
+  // when set, faces of more than 3 corners reach on_face and on_faces
+  // as a fan of triangles (0, i, i + 1)
+  int triangulate;
+
+  // SOP_DIRECTIVE_MASK()s of the directives to decode, others are
+  // skipped without decoding. 0 decodes every directive that has a
+  // callback set.
+  uint64_t directives;
+
+  // when set, usemtl and newmtl names are interned into this table and
+  // material statements fill the newmtl entry they follow. Faces carry
+  // the id of the material in use. A table may be shared by the parsers
+  // of an OBJ source and its material libraries.
+  sop_materials_t *materials;
+
+  // when set together with `materials`, the libraries named by mtllib
+  // are parsed into `materials` on a worker thread while the source is
+  // parsed and are complete once execution returns. Libraries that
+  // can't be read are ignored.
+  int load_materials;
+
+  // directory relative mtllib paths are resolved against, 0 uses the
+  // directory of the file given to sop_parser_execute_file() or the
+  // working directory
+  const char *base;
+
+  // memory hooks, 0 uses malloc(), realloc() and free()
+  sop_allocator_t *allocator;
+
+  // when set and the library is built with SOP_STATS, every execution
+  // adds its line counts and timings to these statistics
+  sop_parser_stats_t *stats;
+
+  // when set, parse phases are recorded into this trace
+  sop_trace_t *trace;
+
   // user defined callbacks
   struct { SOP_PARSER_CALLBACK_FIELDS } callbacks;
 };
@@ -145,13 +359,102 @@ struct sop_parser_line_state {
   char *directive;
 
   // current line number of the source
-  int lineno;
+  size_t lineno;
 
-  // line data after directive
+  // line data after directive, a NUL terminated string or a slice
+  // of the source in zero copy mode for string directives, decoded
+  // values for numeric directives. Faces, lines and points are
+  // int[3][length] rows of vertex, texture and normal indices, -1 when
+  // missing.
   void *data;
 
-  // line data length after directive
+  // line data length after directive, the number of corners for
+  // faces (at least 3), lines and points
   size_t length;
+
+  // id in sop_parser_options.materials of the material in use, the
+  // interned material itself for usemtl and newmtl, -1 when none
+  int material;
+};
+
+/**
+ * This structure represents a batch of decoded lines of the same
+ * directive given to the on_vertices, on_textures, on_normals and
+ * on_faces callbacks. Batches are delivered in source order: pending
+ * batches are flushed before any line callback is called and vertex
+ * attribute batches are flushed before the face batch that follows
+ * them, a face batch is flushed before any attribute that follows it.
+ * When a batch callback is set the line callback of the same
+ * directive is not called.
+ */
+
+struct sop_parser_batch {
+  // the directive type of every element
+  sop_enum_t type;
+
+  // batch directive
+  char *directive;
+
+  // line number of the first element
+  size_t lineno;
+
+  // number of elements in the batch
+  size_t count;
+
+  // contiguous element data:
+  //   - vertices, textures and normals: float[count][4]
+  //   - faces: int[corners][3] holding (v, vt, vn) for every face
+  //     corner, indices are as written in the source and texture or
+  //     normal indices are 0 when absent
+  void *data;
+
+  // faces only: corners of face `i` are data[offsets[i]] up to
+  // data[offsets[i + 1]], `offsets` holds count + 1 entries
+  const size_t *offsets;
+
+  // faces only: id in sop_parser_options.materials of the material of
+  // every face in the batch, -1 when none. A material switch ends the
+  // face batch.
+  int material;
+};
+
+/**
+ * A range of elements counted from the start of the source.
+ */
+
+struct sop_parser_range {
+  size_t offset;
+  size_t count;
+};
+
+/**
+ * This structure describes a submesh given to on_group_complete. A
+ * group starts at an `o` or `g` statement (or the start of the source)
+ * and ends at the next one (or the end of the source). Groups without
+ * any vertex data or faces are not notified. Every pending batch is
+ * delivered before the group completes.
+ */
+
+struct sop_parser_group {
+  // name of the current `o` object and `g` group names, empty when
+  // not given. NUL terminated and valid during the callback only.
+  const char *object;
+  const char *name;
+
+  // line of the statement starting the group, 0 for the elements
+  // before the first one
+  size_t lineno;
+
+  // 0 based ranges of the v, vt and vn directives declared in the
+  // group, indices into the whole source's attribute arrays
+  sop_parser_range_t vertices;
+  sop_parser_range_t textures;
+  sop_parser_range_t normals;
+
+  // faces and face corners as delivered to on_face and on_faces, so
+  // triangles when `triangulate` is set
+  sop_parser_range_t faces;
+  sop_parser_range_t corners;
 };
 
 /**
@@ -182,6 +485,323 @@ struct sop_parser {
 
   // user defined callbacks given from sop_parser_options
   struct { SOP_PARSER_CALLBACK_FIELDS } callbacks;
+
+  // SOP_DIRECTIVE_MASK()s of the directives decoded
+  uint64_t directives;
+
+  // partial line and pending batches between sop_parser_feed() calls
+  struct sop_parser_stream *stream;
+
+  // file being executed by sop_parser_execute_file()
+  const char *path;
+};
+
+/**
+ * This structure holds the element counts of a source found by
+ * sop_parser_count() for sizing output buffers up front.
+ */
+
+struct sop_parser_counts {
+  // v, vt and vn directives
+  size_t vertices;
+  size_t textures;
+  size_t normals;
+
+  // f directives, their corners and the triangles they clip into
+  size_t faces;
+  size_t corners;
+  size_t triangles;
+
+  // g and o directives
+  size_t groups;
+
+  // usemtl directives
+  size_t materials;
+};
+
+/**
+ * Directive types sop_parser_stats has per directive counters for.
+ */
+
+#define SOP_PARSER_STATS_TYPES 64
+
+/**
+ * Where parsing went, filled when the library is built with SOP_STATS
+ * (make SOP_STATS=1). Without it the instrumentation compiles away and
+ * statistics stay zero. Counters add up over executions until reset by
+ * the caller.
+ */
+
+struct sop_parser_stats {
+  // set by executions of a SOP_STATS build
+  int enabled;
+
+  // lines scanned and the longest one (bytes without the newline)
+  size_t lines;
+  size_t longest;
+  size_t longest_lineno;
+
+  // lines and line bytes of each directive type, indexed by type
+  size_t directives[SOP_PARSER_STATS_TYPES];
+  size_t bytes[SOP_PARSER_STATS_TYPES];
+
+  // empty lines, lines of unknown directives and lines of known
+  // directives skipped without a callback or directive mask bit
+  size_t blank;
+  size_t unknown;
+  size_t skipped;
+
+  // nanoseconds spent finding lines, decoding them (directive lookup
+  // and numbers) and dispatching them to callbacks. Only every
+  // SOP_STATS_SAMPLE-th line is timed and scaled, decoding time is the
+  // sum over worker threads when parsing in parallel.
+  uint64_t scan_ns;
+  uint64_t decode_ns;
+  uint64_t callback_ns;
+};
+
+/**
+ * Lines between two timed lines.
+ */
+
+#ifndef SOP_STATS_SAMPLE
+#define SOP_STATS_SAMPLE 64
+#endif
+
+/**
+ * Texture maps of a material.
+ */
+
+enum sop_material_map {
+  SOP_MATERIAL_MAP_AMBIENT = 0,  // map_Ka
+  SOP_MATERIAL_MAP_DIFFUSE,      // map_Kd
+  SOP_MATERIAL_MAP_SPECULAR,     // map_Ks
+  SOP_MATERIAL_MAP_EMISSIVE,     // map_Ke
+  SOP_MATERIAL_MAP_SHININESS,    // map_Ns
+  SOP_MATERIAL_MAP_DISSOLVE,     // map_d, map_Tr
+  SOP_MATERIAL_MAP_BUMP,         // map_bump, map_Bump, bump
+  SOP_MATERIAL_MAP_DISPLACEMENT, // disp
+  SOP_MATERIAL_MAP_DECAL,        // decal
+  SOP_MATERIAL_MAP_REFLECTION,   // refl
+  SOP_MATERIAL_MAP_NORMAL,       // norm
+  SOP_MATERIAL_MAP_MAX
+};
+
+/**
+ * A material of a material table.
+ */
+
+struct sop_material {
+  // interned NUL terminated name
+  char *name;
+  size_t length;
+
+  // Ka, Kd, Ks, Ke and Tf colors (r g b a)
+  float ambient[4];
+  float diffuse[4];
+  float specular[4];
+  float emissive[4];
+  float transmission[4];
+
+  // Ns, d (1 - Tr) and Ni
+  float shininess;
+  float dissolve;
+  float density;
+
+  // illum
+  int illum;
+
+  // texture map statements (options and file name), 0 when absent
+  char *maps[SOP_MATERIAL_MAP_MAX];
+};
+
+/**
+ * Material table interning names to dense integer ids. Zero
+ * initialize before use.
+ */
+
+struct sop_materials {
+  // materials indexed by id
+  sop_material_t *materials;
+  size_t count;
+  size_t capacity;
+
+  // open addressing name table holding id + 1, 0 when empty
+  uint32_t *slots;
+  size_t slotcap;
+
+  // memory hooks of the table, 0 uses malloc(), realloc() and free()
+  sop_allocator_t *allocator;
+};
+
+/**
+ * This structure represents the options available for initializing a
+ * reader. Zero initialized options yield every directive a line at a
+ * time.
+ */
+
+struct sop_reader_options {
+  // SOP_DIRECTIVE_MASK()s of the directives to yield, others are
+  // skipped without decoding. 0 yields every directive and comments.
+  uint64_t directives;
+
+  // SOP_DIRECTIVE_MASK()s of v, vt, vn and f directives yielded as
+  // batches of consecutive lines rather than a line at a time
+  uint64_t batches;
+
+  // maximum number of elements of a batch, 0 uses
+  // SOP_PARSER_BATCH_SIZE
+  size_t batch_size;
+
+  // when set, string directives point directly into the source instead
+  // of a NUL terminated copy
+  int zero_copy;
+
+  // when set, faces of more than 3 corners are yielded as a fan of
+  // triangles (0, i, i + 1)
+  int triangulate;
+
+  // memory hooks of the reader, 0 uses malloc(), realloc() and free()
+  sop_allocator_t *allocator;
+};
+
+/**
+ * A pull reader yielding the directives of a source as events. All of
+ * its state lives in the reader, so readers can be suspended between
+ * events and several of them driven from a single thread.
+ */
+
+struct sop_reader {
+  // copy of the options given to sop_reader_init()
+  sop_reader_options_t options;
+
+  // source being read
+  const char *source;
+  size_t length;
+
+  // scanner position, decoded line and event buffers
+  struct sop_reader_state *state;
+};
+
+/**
+ * An event yielded by sop_reader_next(). Event data is owned by the
+ * reader and valid until the next call.
+ */
+
+struct sop_reader_event {
+  // directive type of the event, SOP_COMMENT for comments
+  sop_enum_t type;
+
+  // set when the event is a `batch` rather than a `line`
+  int batched;
+
+  // a single line laid out as sop_parser_line_state data, `material`
+  // is always -1
+  sop_parser_line_state_t line;
+
+  // consecutive lines of one directive laid out as sop_parser_batch
+  // data, `material` is always -1
+  sop_parser_batch_t batch;
+};
+
+/**
+ * This structure represents the options available for loading a mesh.
+ */
+
+struct sop_mesh_options {
+  // number of worker threads used to decode large sources
+  int threads;
+
+  // weld unique (v, vt, vn) corners into an indexed vertex buffer
+  int weld;
+
+  // ear clip faces of more than 3 corners into triangles
+  int triangulate;
+
+  // memory hooks of the mesh arrays and the parser loading them, 0
+  // uses malloc(), realloc() and free(). Must not change until the mesh
+  // is destroyed.
+  sop_allocator_t *allocator;
+
+  // when set, load phases are recorded into this trace
+  sop_trace_t *trace;
+};
+
+/**
+ * A mesh loaded from an OBJ source with structure of arrays storage.
+ * Face corner indices are resolved to 0 based offsets into the
+ * attribute arrays (relative indices included) and are -1 when the
+ * attribute is absent. Arrays grow geometrically while loading and are
+ * shrunk to fit once loading finishes.
+ */
+
+struct sop_mesh {
+  // geometric vertices (x y z)
+  float *positions;
+  size_t position_count;
+
+  // texture vertices (u v)
+  float *texcoords;
+  size_t texcoord_count;
+
+  // vertex normals (x y z)
+  float *normals;
+  size_t normal_count;
+
+  // face corner indices, faces of less than 3 corners are dropped
+  int *position_indices;
+  int *texcoord_indices;
+  int *normal_indices;
+  size_t index_count;
+
+  // corners of face `i` are indices[face_offsets[i]] up to
+  // indices[face_offsets[i + 1]], `face_offsets` holds face_count + 1
+  // entries once a face is loaded. Faces are triangles when
+  // `options->triangulate` is set.
+  size_t *face_offsets;
+  size_t face_count;
+
+  // pointer to mesh options
+  sop_mesh_options_t *options;
+
+  // when set, the attribute, index and face offset arrays and their
+  // `capacity` are provided by the caller (for example sized with
+  // sop_parser_count()). They are never grown, shrunk or freed and
+  // loading fails with SOP_OOB when they run out.
+  int external;
+
+  // binary cache mapping the arrays point into when the mesh was
+  // loaded from one by sop_mesh_load_file()
+  void *mapping;
+  size_t mapsize;
+
+  // indexed vertex buffer, filled when `options->weld` is set. Each
+  // unique (v, vt, vn) corner becomes one vertex of `stride` floats:
+  // position (x y z) followed by texcoord (u v) and normal (x y z)
+  // when any corner references them, their offsets are -1 otherwise.
+  // There are `index_count` indices of `index_size` bytes, 16 bit when
+  // fewer than 65535 vertices exist so 0xffff is never used.
+  struct {
+    float *vertices;
+    size_t vertex_count;
+    size_t stride;
+    int texcoord_offset;
+    int normal_offset;
+    void *indices;
+    size_t index_size;
+
+    // deduplication state kept across loads
+    struct sop_mesh_weld_table *table;
+  } weld;
+
+  // allocated element capacities
+  struct {
+    size_t positions;
+    size_t texcoords;
+    size_t normals;
+    size_t indices;
+    size_t faces;
+  } capacity;
 };
 
 /**
@@ -201,6 +821,221 @@ sop_parser_execute(sop_parser_t *,
                    const char *source,
                    size_t length);
 
+/**
+ * Execute SOP parser for the file at `path`. Regular files are mapped
+ * into memory and parsed in place, anything else is read and parsed a
+ * chunk at a time. Offsets and line numbers are 64 bit safe.
+ */
+
+int
+sop_parser_execute_file(sop_parser_t *parser, const char *path);
+
+/**
+ * Counts the elements of a source without decoding any numbers.
+ */
+
+int
+sop_parser_count(const char *source,
+                 size_t length,
+                 sop_parser_counts_t *counts);
+
+/**
+ * Feeds the next `length` bytes of a source to the parser. Chunks may
+ * split lines anywhere, complete lines are dispatched right away and a
+ * trailing partial line is kept until the next chunk. Memory use is
+ * bounded by the longest line and the batch size, not the source size.
+ * A failed callback makes every further call return its error.
+ */
+
+int
+sop_parser_feed(sop_parser_t *parser,
+                const char *chunk,
+                size_t length);
+
+/**
+ * Dispatches the final (unterminated) line and pending batches of a
+ * fed source and releases the stream state. The parser may be fed a
+ * new source afterwards.
+ */
+
+int
+sop_parser_finish(sop_parser_t *parser);
+
+/**
+ * Releases the stream state of a parser without dispatching anything
+ * left, for abandoning a fed source.
+ */
+
+void
+sop_parser_destroy(sop_parser_t *parser);
+
+/**
+ * Initializes a reader over `length` bytes of `source`, which must
+ * outlive it. `options` may be NULL.
+ */
+
+int
+sop_reader_init(sop_reader_t *reader,
+                const char *source,
+                size_t length,
+                const sop_reader_options_t *options);
+
+/**
+ * Initializes a reader over the file at `path`, which is mapped into
+ * memory like sop_parser_execute_file() does.
+ */
+
+int
+sop_reader_init_file(sop_reader_t *reader,
+                     const char *path,
+                     const sop_reader_options_t *options);
+
+/**
+ * Reads the next event of a source into `event`. Returns SOP_EOK when
+ * an event was read, SOP_NULL at the end of the source or an error,
+ * which every further call returns too.
+ */
+
+int
+sop_reader_next(sop_reader_t *reader, sop_reader_event_t *event);
+
+/**
+ * Releases the state of a reader and the file it mapped.
+ */
+
+void
+sop_reader_destroy(sop_reader_t *reader);
+
+/**
+ * Returns the id of the material named by `length` bytes of `name`,
+ * adding it to the table if it is new, or -1 when out of memory.
+ */
+
+int
+sop_materials_intern(sop_materials_t *materials,
+                     const char *name,
+                     size_t length);
+
+/**
+ * Returns the id of the material named by `length` bytes of `name` or
+ * -1 if the table does not hold it.
+ */
+
+int
+sop_materials_find(const sop_materials_t *materials,
+                   const char *name,
+                   size_t length);
+
+/**
+ * Frees a material table and empties it for reuse. The allocator is
+ * kept.
+ */
+
+void
+sop_materials_destroy(sop_materials_t *materials);
+
+/**
+ * Initializes an arena carving allocations out of blocks of
+ * `block_size` bytes, 0 uses SOP_ARENA_BLOCK_SIZE.
+ */
+
+int
+sop_arena_init(sop_arena_t *arena, size_t block_size);
+
+/**
+ * Releases every allocation of an arena at once. The first block is
+ * kept for the allocations that follow.
+ */
+
+void
+sop_arena_reset(sop_arena_t *arena);
+
+/**
+ * Releases every allocation and block of an arena.
+ */
+
+void
+sop_arena_destroy(sop_arena_t *arena);
+
+/**
+ * Initializes an empty trace. `allocator` may be NULL.
+ */
+
+int
+sop_trace_init(sop_trace_t *trace, sop_allocator_t *allocator);
+
+/**
+ * Writes the recorded events to `path` as Chrome trace event JSON.
+ * Must not run while a parser or mesh is recording into the trace.
+ */
+
+int
+sop_trace_write(const sop_trace_t *trace, const char *path);
+
+/**
+ * Releases the events of a trace. Must not run while a parser or mesh
+ * is recording into the trace.
+ */
+
+void
+sop_trace_destroy(sop_trace_t *trace);
+
+/**
+ * Parses a single floating point value from `source` without
+ * consulting the current locale. The result is rounded exactly like
+ * strtof(). Returns the number of bytes consumed or 0 if `source`
+ * does not start with a number.
+ */
+
+size_t
+sop_strtof(const char *source, size_t length, float *out);
+
+/**
+ * Parses up to `count` white space separated floating point values
+ * from `source` into `out`. Fixed format values such as "-0.123456"
+ * are decoded with SIMD when the CPU allows it, the result is the same
+ * as sop_strtof(). Returns the number of values parsed.
+ */
+
+size_t
+sop_parse_floats(const char *source,
+                 size_t length,
+                 float *out,
+                 size_t count);
+
+/**
+ * Initializes an empty mesh with options. `options` may be NULL.
+ */
+
+int
+sop_mesh_init(sop_mesh_t *mesh, sop_mesh_options_t *options);
+
+/**
+ * Parses an OBJ source and appends its geometry to an initialized mesh.
+ */
+
+int
+sop_mesh_load(const char *source, size_t length, sop_mesh_t *mesh);
+
+/**
+ * Loads the OBJ file at `path` into an initialized, empty mesh through
+ * a binary cache at `cache` (`path` with ".sopb" appended when NULL).
+ * A cache written from the same source content with the same mesh
+ * options is mapped into memory with no parsing at all. Otherwise the
+ * source is parsed and the cache is rewritten. Failing to write the
+ * cache does not fail loading. Mapped meshes are external.
+ */
+
+int
+sop_mesh_load_file(const char *path, const char *cache, sop_mesh_t *mesh);
+
+/**
+ * Frees memory owned by a mesh and resets it to an empty mesh.
+ */
+
+void
+sop_mesh_destroy(sop_mesh_t *mesh);
+
 #ifdef __cplusplus
 }
 #endif
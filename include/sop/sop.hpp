@@ -0,0 +1,504 @@
+#ifndef LIBSOP_HPP
+#define LIBSOP_HPP
+
+#include <climits>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include <sop/sop.h>
+
+/**
+ * C++17 front end to the parser. sop::parse() is a template over a
+ * handler type: every directive the handler has a member for is decoded
+ * and handed straight to that member, which the compiler can inline
+ * into the parse loop. Directives without a member are compiled out and
+ * their lines are skipped without being decoded. There are no function
+ * pointers involved, numbers are parsed by sop_parse_floats().
+ *
+ * Handler members mirror the C callbacks (see README) and may return
+ * void or an int, anything other than SOP_EOK stops the parse and is
+ * returned by sop::parse(). Strings are views into the source.
+ */
+
+namespace sop {
+
+/**
+ * A face, line or point corner. `v` is the vertex index as written in
+ * the source, `vt` and `vn` are -1 when absent.
+ */
+
+struct corner {
+  int v;
+  int vt;
+  int vn;
+};
+
+/**
+ * The corners of a face, line or point statement. Only valid during the
+ * handler call.
+ */
+
+struct corners {
+  const corner *data;
+  size_t count;
+
+  size_t size() const { return count; }
+  const corner *begin() const { return data; }
+  const corner *end() const { return data + count; }
+  const corner &operator[](size_t i) const { return data[i]; }
+};
+
+namespace detail {
+
+/**
+ * Defines has_<member><H, A...>(0), true when `H` can be called with
+ * arguments of types `A`.
+ */
+
+#define SOP_HPP_MEMBER(member)                                       \
+  template <typename H, typename... A>                               \
+  constexpr auto                                                     \
+  has_##member(int)                                                  \
+    -> decltype(std::declval<H &>().member(std::declval<A>()...),    \
+                true) {                                              \
+    return true;                                                     \
+  }                                                                  \
+                                                                     \
+  template <typename H, typename... A>                               \
+  constexpr bool                                                     \
+  has_##member(...) {                                                \
+    return false;                                                    \
+  }
+
+SOP_HPP_MEMBER(on_vertex)
+SOP_HPP_MEMBER(on_texture)
+SOP_HPP_MEMBER(on_normal)
+SOP_HPP_MEMBER(on_vertex_parameter)
+SOP_HPP_MEMBER(on_face)
+SOP_HPP_MEMBER(on_line)
+SOP_HPP_MEMBER(on_point)
+SOP_HPP_MEMBER(on_smooth)
+SOP_HPP_MEMBER(on_comment)
+SOP_HPP_MEMBER(on_object)
+SOP_HPP_MEMBER(on_group)
+SOP_HPP_MEMBER(on_material_use)
+SOP_HPP_MEMBER(on_material_lib)
+SOP_HPP_MEMBER(on_material_new)
+SOP_HPP_MEMBER(on_material_ambient)
+SOP_HPP_MEMBER(on_material_diffuse)
+SOP_HPP_MEMBER(on_material_specular)
+SOP_HPP_MEMBER(on_material_emissive)
+SOP_HPP_MEMBER(on_material_transmission)
+SOP_HPP_MEMBER(on_material_density)
+SOP_HPP_MEMBER(on_material_shininess)
+SOP_HPP_MEMBER(on_material_transparency)
+SOP_HPP_MEMBER(on_material_illum)
+SOP_HPP_MEMBER(on_material_map)
+
+#undef SOP_HPP_MEMBER
+
+using sv = std::string_view;
+
+template <typename H>
+constexpr bool handles_vertex =
+  has_on_vertex<H, float, float, float, float>(0) ||
+  has_on_vertex<H, float, float, float>(0);
+
+template <typename H>
+constexpr bool handles_texture =
+  has_on_texture<H, float, float, float>(0) ||
+  has_on_texture<H, float, float>(0);
+
+template <typename H>
+constexpr bool handles_parameter =
+  has_on_vertex_parameter<H, float, float, float>(0) ||
+  has_on_vertex_parameter<H, float, float>(0);
+
+template <typename H>
+constexpr bool handles_map =
+  has_on_material_map<H, sv, sv>(0) || has_on_material_map<H, sv>(0);
+
+/**
+ * Calls `f` and maps a void result to SOP_EOK.
+ */
+
+template <typename F>
+inline int
+notify(F &&f) {
+  if constexpr (std::is_void_v<decltype(f())>) {
+    f();
+    return SOP_EOK;
+  } else {
+    return (int) f();
+  }
+}
+
+constexpr uint64_t
+key(const char *name) {
+  uint64_t word = 0;
+  for (int i = 0; i < 8 && name[i]; ++i) {
+    word |= (uint64_t) (unsigned char) name[i] << (8 * i);
+  }
+  return word;
+}
+
+inline bool
+is_space(char c) {
+  return ' ' == c || '\t' == c || '\r' == c;
+}
+
+inline bool
+is_face_space(char c) {
+  return (unsigned char) c <= ' ';
+}
+
+/**
+ * Parses a decimal integer in place. Returns the number of bytes
+ * consumed or 0 if `p` does not start with an integer. Values past
+ * INT_MAX are clamped to +/-INT_MAX like the C parser does.
+ */
+
+inline size_t
+integer(const char *p, const char *end, int *out) {
+  const char *start = p;
+  uint64_t value = 0;
+  bool negative = false;
+
+  if (p < end && ('-' == *p || '+' == *p)) {
+    negative = '-' == *p;
+    p++;
+  }
+
+  if (p == end || (unsigned char) (*p - '0') > 9) {
+    return 0;
+  }
+
+  for (; p < end && (unsigned char) (*p - '0') <= 9; ++p) {
+    if (value <= INT_MAX) {
+      value = value * 10 + (uint64_t) (*p - '0');
+    }
+  }
+
+  if (value > INT_MAX) {
+    value = INT_MAX;
+  }
+
+  *out = negative ? -(int) value : (int) value;
+  return (size_t) (p - start);
+}
+
+/**
+ * Decodes the corners of a face, line or point statement into `out`.
+ */
+
+inline corners
+decode_corners(const char *p, const char *end, std::vector<corner> &out) {
+  // every corner but the last takes at least two bytes
+  const size_t most = (size_t) (end - p) / 2 + 1;
+  corner *c = 0;
+
+  if (out.size() < most) {
+    out.resize(most);
+  }
+
+  c = out.data();
+  for (;;) {
+    while (p < end && is_face_space(*p)) { p++; }
+    if (p == end) {
+      break;
+    }
+
+    c->v = 0;
+    c->vt = c->vn = -1;
+    p += integer(p, end, &c->v);
+    if (p < end && '/' == *p) {
+      p++;
+      p += integer(p, end, &c->vt);
+      if (p < end && '/' == *p) {
+        p++;
+        p += integer(p, end, &c->vn);
+      }
+    }
+
+    // a written 0 is as good as absent
+    if (0 == c->vt) { c->vt = -1; }
+    if (0 == c->vn) { c->vn = -1; }
+
+    // ignore anything else up to the next corner
+    while (p < end && !is_face_space(*p)) { p++; }
+    c++;
+  }
+
+  return corners { out.data(), (size_t) (c - out.data()) };
+}
+
+/**
+ * Decodes and notifies a single trimmed, non empty line.
+ */
+
+template <typename H>
+inline int
+line(H &h, const char *p, const char *end, std::vector<corner> &buffer) {
+  [[maybe_unused]] const char *keyword = p;
+  [[maybe_unused]] float f[4];
+  [[maybe_unused]] int n = 0;
+  uint64_t word = 0;
+  size_t keysize = 0;
+
+  // comments need no separating white space
+  if ('#' == *p) {
+    if constexpr (has_on_comment<H, sv>(0)) {
+      for (p++; p < end && is_space(*p); ++p) { }
+      if (p < end) {
+        return notify([&] { return h.on_comment(sv(p, end - p)); });
+      }
+    }
+    return SOP_EOK;
+  }
+
+  for (; p < end && !is_face_space(*p); ++p, ++keysize) {
+    if (8 == keysize) {
+      // too long to be known
+      return SOP_EOK;
+    }
+    word |= (uint64_t) (unsigned char) *p << (8 * keysize);
+  }
+
+  while (p < end && is_space(*p)) { p++; }
+
+  [[maybe_unused]] const sv rest(p, (size_t) (end - p));
+
+  // a bare `o` or `g` still names an (unnamed) object or group
+  if (p == end && key("o") != word && key("g") != word) {
+    return SOP_EOK;
+  }
+
+#define SOP_HPP_FLOATS(count, a, b, c, d)                            \
+  f[0] = a; f[1] = b; f[2] = c; f[3] = d;                            \
+  (void) sop_parse_floats(p, (size_t) (end - p), f, count)
+
+  switch (word) {
+    case key("v"):
+      if constexpr (handles_vertex<H>) {
+        SOP_HPP_FLOATS(4, 0, 0, 0, 1);
+        if constexpr (has_on_vertex<H, float, float, float, float>(0)) {
+          return notify([&] { return h.on_vertex(f[0], f[1], f[2], f[3]); });
+        } else {
+          return notify([&] { return h.on_vertex(f[0], f[1], f[2]); });
+        }
+      }
+      break;
+
+    case key("vt"):
+      if constexpr (handles_texture<H>) {
+        SOP_HPP_FLOATS(3, 0, 0, 0, 0);
+        if constexpr (has_on_texture<H, float, float, float>(0)) {
+          return notify([&] { return h.on_texture(f[0], f[1], f[2]); });
+        } else {
+          return notify([&] { return h.on_texture(f[0], f[1]); });
+        }
+      }
+      break;
+
+    case key("vn"):
+      if constexpr (has_on_normal<H, float, float, float>(0)) {
+        SOP_HPP_FLOATS(3, 0, 0, 0, 0);
+        return notify([&] { return h.on_normal(f[0], f[1], f[2]); });
+      }
+      break;
+
+    case key("vp"):
+      if constexpr (handles_parameter<H>) {
+        // w defaults to 1 for rational curves and surfaces
+        SOP_HPP_FLOATS(3, 0, 0, 1, 0);
+        if constexpr (has_on_vertex_parameter<H, float, float, float>(0)) {
+          return notify([&] {
+            return h.on_vertex_parameter(f[0], f[1], f[2]);
+          });
+        } else {
+          return notify([&] { return h.on_vertex_parameter(f[0], f[1]); });
+        }
+      }
+      break;
+
+    case key("f"):
+      if constexpr (has_on_face<H, corners>(0)) {
+        const corners c = decode_corners(p, end, buffer);
+        return notify([&] { return h.on_face(c); });
+      }
+      break;
+
+    case key("l"):
+      if constexpr (has_on_line<H, corners>(0)) {
+        const corners c = decode_corners(p, end, buffer);
+        return notify([&] { return h.on_line(c); });
+      }
+      break;
+
+    case key("p"):
+      if constexpr (has_on_point<H, corners>(0)) {
+        const corners c = decode_corners(p, end, buffer);
+        return notify([&] { return h.on_point(c); });
+      }
+      break;
+
+    case key("s"):
+      if constexpr (has_on_smooth<H, bool>(0)) {
+        // "off" and "0" disable smoothing, "on" or a smoothing
+        // group number enable it
+        const bool on = !("off" == rest || "0" == rest);
+        return notify([&] { return h.on_smooth(on); });
+      }
+      break;
+
+    case key("o"):
+      if constexpr (has_on_object<H, sv>(0)) {
+        return notify([&] { return h.on_object(rest); });
+      }
+      break;
+
+    case key("g"):
+      if constexpr (has_on_group<H, sv>(0)) {
+        return notify([&] { return h.on_group(rest); });
+      }
+      break;
+
+    case key("usemtl"):
+      if constexpr (has_on_material_use<H, sv>(0)) {
+        return notify([&] { return h.on_material_use(rest); });
+      }
+      break;
+
+    case key("mtllib"):
+      if constexpr (has_on_material_lib<H, sv>(0)) {
+        return notify([&] { return h.on_material_lib(rest); });
+      }
+      break;
+
+    case key("newmtl"):
+      if constexpr (has_on_material_new<H, sv>(0)) {
+        return notify([&] { return h.on_material_new(rest); });
+      }
+      break;
+
+#define SOP_HPP_COLOR(name, member)                                  \
+    case key(name):                                                  \
+      if constexpr (has_##member<H, float, float, float>(0)) {       \
+        SOP_HPP_FLOATS(3, 0, 0, 0, 0);                               \
+        return notify([&] { return h.member(f[0], f[1], f[2]); });   \
+      }                                                              \
+      break;
+
+    SOP_HPP_COLOR("Ka", on_material_ambient)
+    SOP_HPP_COLOR("Kd", on_material_diffuse)
+    SOP_HPP_COLOR("Ks", on_material_specular)
+    SOP_HPP_COLOR("Ke", on_material_emissive)
+    SOP_HPP_COLOR("Tf", on_material_transmission)
+
+#undef SOP_HPP_COLOR
+
+    case key("Ni"):
+      if constexpr (has_on_material_density<H, float>(0)) {
+        SOP_HPP_FLOATS(1, 1, 0, 0, 0);
+        return notify([&] { return h.on_material_density(f[0]); });
+      }
+      break;
+
+    // integers, as the C callbacks get them
+    case key("Ns"):
+      if constexpr (has_on_material_shininess<H, int>(0)) {
+        (void) integer(p, end, &n);
+        return notify([&] { return h.on_material_shininess(n); });
+      }
+      break;
+
+    case key("d"):
+    case key("Tr"):
+      if constexpr (has_on_material_transparency<H, int>(0)) {
+        (void) integer(p, end, &n);
+        return notify([&] { return h.on_material_transparency(n); });
+      }
+      break;
+
+    case key("illum"):
+      if constexpr (has_on_material_illum<H, int>(0)) {
+        (void) integer(p, end, &n);
+        return notify([&] { return h.on_material_illum(n); });
+      }
+      break;
+
+    case key("map_Ka"): case key("map_Kd"): case key("map_Ks"):
+    case key("map_Ke"): case key("map_Ns"): case key("map_d"):
+    case key("map_Tr"): case key("map_bump"): case key("map_Bump"):
+    case key("bump"): case key("disp"): case key("decal"):
+    case key("refl"): case key("norm"):
+      if constexpr (has_on_material_map<H, sv, sv>(0)) {
+        const sv name(keyword, keysize);
+        return notify([&] { return h.on_material_map(name, rest); });
+      } else if constexpr (handles_map<H>) {
+        return notify([&] { return h.on_material_map(rest); });
+      }
+      break;
+
+    // unknown directives are skipped
+    default:
+      break;
+  }
+
+#undef SOP_HPP_FLOATS
+
+  return SOP_EOK;
+}
+
+} // namespace detail
+
+/**
+ * Parses `length` bytes of `source` into `handler`. Returns SOP_EOK,
+ * SOP_EINVALID_SOURCE for an empty source or the first value other
+ * than SOP_EOK a handler member returned.
+ */
+
+template <typename Handler>
+inline int
+parse(const char *source, size_t length, Handler &handler) {
+  const char *p = source;
+  const char *end = source + length;
+  std::vector<corner> buffer;
+  int rc = SOP_EOK;
+
+  if (!source || 0 == length) {
+    return SOP_EINVALID_SOURCE;
+  }
+
+  while (p < end && SOP_EOK == rc) {
+    const char *nl = (const char *) memchr(p, '\n', (size_t) (end - p));
+    const char *next = nl ? nl + 1 : end;
+    const char *last = nl ? nl : end;
+
+    while (p < last && detail::is_space(*p)) { p++; }
+    while (last > p && detail::is_space(last[-1])) { last--; }
+
+    if (p < last) {
+      rc = detail::line(handler, p, last, buffer);
+    }
+
+    p = next;
+  }
+
+  return rc;
+}
+
+template <typename Handler>
+inline int
+parse(std::string_view source, Handler &handler) {
+  return parse(source.data(), source.size(), handler);
+}
+
+} // namespace sop
+
+#endif
@@ -0,0 +1,251 @@
+#include <stdlib.h>
+#include <string.h>
+#include <sop/sop.h>
+#include "internal.h"
+
+/**
+ * Alignment of every arena allocation.
+ */
+
+#define SOP_ARENA_ALIGN 16
+
+#define SOP_ARENA_ROUND(size) \
+  (((size) + SOP_ARENA_ALIGN - 1) & ~(size_t) (SOP_ARENA_ALIGN - 1))
+
+/**
+ * A block of an arena. Each allocation is preceded by a header holding
+ * its size so it can be copied when it moves.
+ */
+
+struct sop_arena_block {
+  struct sop_arena_block *next;
+
+  // usable bytes after the block header and bytes carved out so far
+  size_t size;
+  size_t offset;
+
+  // latest allocation of the block, the one that can grow or be freed
+  char *last;
+};
+
+typedef struct sop_arena_header sop_arena_header_t;
+struct sop_arena_header {
+  size_t size;
+  size_t padding;
+};
+
+#define SOP_ARENA_BLOCK_HEADER SOP_ARENA_ROUND(sizeof(struct sop_arena_block))
+
+static inline char *
+sop_arena_data(struct sop_arena_block *block) {
+  return (char *) block + SOP_ARENA_BLOCK_HEADER;
+}
+
+static inline sop_arena_header_t *
+sop_arena_header(void *ptr) {
+  return (sop_arena_header_t *) ptr - 1;
+}
+
+static void
+sop_arena_lock(sop_arena_t *arena) {
+  while (__atomic_exchange_n(&arena->lock, 1, __ATOMIC_ACQUIRE)) {
+    while (__atomic_load_n(&arena->lock, __ATOMIC_RELAXED)) { }
+  }
+}
+
+static void
+sop_arena_unlock(sop_arena_t *arena) {
+  __atomic_store_n(&arena->lock, 0, __ATOMIC_RELEASE);
+}
+
+/**
+ * Adds a block of at least `size` usable bytes. Blocks larger than the
+ * arena's block size hold a single allocation and go behind the
+ * current block so it keeps serving small allocations.
+ */
+
+static struct sop_arena_block *
+sop_arena_block(sop_arena_t *arena, size_t size) {
+  const size_t usable = size > arena->block_size ? size : arena->block_size;
+  struct sop_arena_block *block = (struct sop_arena_block *)
+    malloc(SOP_ARENA_BLOCK_HEADER + usable);
+
+  if (!block) {
+    return 0;
+  }
+
+  block->size = usable;
+  block->offset = 0;
+  block->last = 0;
+
+  if (usable > arena->block_size && arena->blocks) {
+    block->next = arena->blocks->next;
+    arena->blocks->next = block;
+  } else {
+    block->next = arena->blocks;
+    arena->blocks = block;
+  }
+
+  return block;
+}
+
+static void *
+sop_arena_carve(sop_arena_t *arena, size_t size) {
+  const size_t total = sizeof(sop_arena_header_t) + SOP_ARENA_ROUND(size);
+  struct sop_arena_block *block = arena->blocks;
+  sop_arena_header_t *header = 0;
+
+  if (!block || block->size - block->offset < total) {
+    block = sop_arena_block(arena, total);
+    if (!block) {
+      return 0;
+    }
+  }
+
+  header = (sop_arena_header_t *) (sop_arena_data(block) + block->offset);
+  header->size = size;
+  block->offset += total;
+  block->last = (char *) (header + 1);
+  arena->used += total;
+  return block->last;
+}
+
+/**
+ * Returns the block whose latest allocation is `ptr`, if any.
+ */
+
+static struct sop_arena_block *
+sop_arena_owner(sop_arena_t *arena, void *ptr) {
+  struct sop_arena_block *block = arena->blocks;
+  // only the current block and the single allocation block behind it
+  // can hold a growable allocation worth looking for
+  for (int i = 0; block && i < 2; ++i, block = block->next) {
+    if (block->last == ptr) {
+      return block;
+    }
+  }
+  return 0;
+}
+
+static void *
+sop_arena_allocate(void *data, size_t size) {
+  sop_arena_t *arena = (sop_arena_t *) data;
+  void *ptr = 0;
+
+  sop_arena_lock(arena);
+  ptr = sop_arena_carve(arena, size);
+  sop_arena_unlock(arena);
+  return ptr;
+}
+
+static void *
+sop_arena_reallocate(void *data, void *ptr, size_t size) {
+  sop_arena_t *arena = (sop_arena_t *) data;
+  struct sop_arena_block *block = 0;
+  sop_arena_header_t *header = 0;
+  void *next = 0;
+
+  if (!ptr) {
+    return sop_arena_allocate(data, size);
+  }
+
+  sop_arena_lock(arena);
+  header = sop_arena_header(ptr);
+
+  // the latest allocation of a block grows in place when it fits
+  block = sop_arena_owner(arena, ptr);
+  if (block) {
+    const size_t start = (size_t) ((char *) header - sop_arena_data(block));
+    const size_t total = sizeof(sop_arena_header_t) + SOP_ARENA_ROUND(size);
+    if (block->size - start >= total) {
+      arena->used = arena->used + total - (block->offset - start);
+      block->offset = start + total;
+      header->size = size;
+      sop_arena_unlock(arena);
+      return ptr;
+    }
+  }
+
+  next = sop_arena_carve(arena, size);
+  if (next) {
+    memcpy(next, ptr, header->size < size ? header->size : size);
+  }
+
+  sop_arena_unlock(arena);
+  return next;
+}
+
+static void
+sop_arena_deallocate(void *data, void *ptr) {
+  sop_arena_t *arena = (sop_arena_t *) data;
+  struct sop_arena_block *block = 0;
+
+  if (!ptr) {
+    return;
+  }
+
+  // only the latest allocation of a block is reclaimed
+  sop_arena_lock(arena);
+  block = sop_arena_owner(arena, ptr);
+  if (block) {
+    const size_t start =
+      (size_t) ((char *) sop_arena_header(ptr) - sop_arena_data(block));
+    arena->used -= block->offset - start;
+    block->offset = start;
+    block->last = 0;
+  }
+  sop_arena_unlock(arena);
+}
+
+int
+sop_arena_init(sop_arena_t *arena, size_t block_size) {
+  if (!arena) {
+    return SOP_EMEM;
+  }
+
+  memset(arena, 0, sizeof(sop_arena_t));
+  arena->block_size = block_size ? block_size : SOP_ARENA_BLOCK_SIZE;
+  arena->allocator.allocate = sop_arena_allocate;
+  arena->allocator.reallocate = sop_arena_reallocate;
+  arena->allocator.deallocate = sop_arena_deallocate;
+  arena->allocator.data = arena;
+  return SOP_EOK;
+}
+
+void
+sop_arena_reset(sop_arena_t *arena) {
+  struct sop_arena_block *keep = 0;
+  struct sop_arena_block *block = 0;
+
+  if (!arena) {
+    return;
+  }
+
+  block = arena->blocks;
+  while (block) {
+    struct sop_arena_block *next = block->next;
+    if (!keep && block->size == arena->block_size) {
+      keep = block;
+      keep->next = 0;
+      keep->offset = 0;
+      keep->last = 0;
+    } else {
+      free(block);
+    }
+    block = next;
+  }
+
+  arena->blocks = keep;
+  arena->used = 0;
+}
+
+void
+sop_arena_destroy(sop_arena_t *arena) {
+  if (!arena) {
+    return;
+  }
+
+  sop_arena_reset(arena);
+  free(arena->blocks);
+  arena->blocks = 0;
+}
@@ -0,0 +1,271 @@
+#include <stdlib.h>
+#include <string.h>
+#include <sop/sop.h>
+#include "internal.h"
+
+void
+sop_context_init(sop_context_t *ctx, sop_parser_t *parser) {
+  memset(ctx, 0, sizeof(sop_context_t));
+  ctx->parser = parser;
+  ctx->allocator = parser->options->allocator;
+  ctx->decoded.allocator = ctx->allocator;
+  ctx->state.line = &ctx->line;
+  ctx->state.data = parser->options->data;
+  ctx->batchsize = parser->options->batch_size
+    ? parser->options->batch_size
+    : SOP_PARSER_BATCH_SIZE;
+  ctx->material = -1;
+  ctx->defining = -1;
+  ctx->trace = parser->options->trace;
+
+  if (SOP_STATS_ENABLED && parser->options->stats) {
+    ctx->stats = parser->options->stats;
+    ctx->stats->enabled = 1;
+  }
+}
+
+void
+sop_context_destroy(sop_context_t *ctx) {
+  for (int i = 0; i < SOP_BATCH_MAX; ++i) {
+    sop_free(ctx->allocator, ctx->batches[i].batch.data);
+    sop_free(ctx->allocator, ctx->batches[i].offsets);
+  }
+  memset(ctx->batches, 0, sizeof(ctx->batches));
+  ctx->pending = 0;
+
+  sop_free(ctx->allocator, ctx->decoded.data);
+  ctx->decoded.data = 0;
+  ctx->decoded.count = ctx->decoded.capacity = 0;
+  sop_free(ctx->allocator, ctx->faces);
+  ctx->faces = 0;
+  ctx->facecap = 0;
+
+  sop_context_mtllib_destroy(ctx);
+
+  sop_free(ctx->allocator, ctx->object);
+  sop_free(ctx->allocator, ctx->groupname);
+  ctx->object = ctx->groupname = 0;
+  ctx->objectcap = ctx->groupcap = 0;
+}
+
+static int
+sop_context_flush_slot(sop_context_t *ctx, int slot) {
+  sop_batch_buffer_t *buffer = &ctx->batches[slot];
+  sop_parser_batch_cb cb = 0;
+  const char *name = 0;
+  int rc = SOP_EOK;
+
+  if (!(ctx->pending & (1 << slot))) {
+    return SOP_EOK;
+  }
+
+  switch (slot) {
+    case SOP_BATCH_VERTEX:
+      cb = ctx->parser->callbacks.on_vertices;
+      name = "on_vertices";
+      break;
+    case SOP_BATCH_TEXTURE:
+      cb = ctx->parser->callbacks.on_textures;
+      name = "on_textures";
+      break;
+    case SOP_BATCH_NORMAL:
+      cb = ctx->parser->callbacks.on_normals;
+      name = "on_normals";
+      break;
+    case SOP_BATCH_FACE:
+      cb = ctx->parser->callbacks.on_faces;
+      name = "on_faces";
+      break;
+  }
+
+  ctx->line.type = buffer->batch.type;
+  ctx->line.directive = buffer->batch.directive;
+  ctx->line.lineno = buffer->batch.lineno;
+  ctx->line.length = buffer->batch.count;
+  ctx->line.data = buffer->batch.data;
+  ctx->line.material = buffer->batch.material;
+
+  if (cb) {
+    uint64_t begin = sop_trace_begin(ctx->trace);
+    rc = cb(&ctx->state, &buffer->batch);
+    sop_trace_end(ctx->trace, "callback", name, begin);
+  }
+
+  buffer->batch.count = 0;
+  buffer->corners = 0;
+  ctx->pending &= ~(1 << slot);
+  return rc;
+}
+
+int
+sop_context_flush(sop_context_t *ctx) {
+  for (int slot = 0; slot < SOP_BATCH_MAX && ctx->pending; ++slot) {
+    int rc = sop_context_flush_slot(ctx, slot);
+    if (SOP_EOK != rc) {
+      return rc;
+    }
+  }
+  return SOP_EOK;
+}
+
+/**
+ * Makes room for one more face with `corners` corners.
+ */
+
+static int
+sop_context_reserve_face(const sop_allocator_t *allocator,
+                         sop_batch_buffer_t *buffer,
+                         size_t capacity,
+                         size_t corners) {
+  if (!buffer->offsets) {
+    buffer->offsets = (size_t *)
+      sop_alloc(allocator, (capacity + 1) * sizeof(size_t));
+    if (!buffer->offsets) {
+      return SOP_EMEM;
+    }
+    buffer->offsets[0] = 0;
+    buffer->batch.offsets = buffer->offsets;
+  }
+
+  if (buffer->corners + corners > buffer->cornercap) {
+    size_t cornercap = buffer->cornercap ? buffer->cornercap : 3 * capacity;
+    void *data = 0;
+    while (cornercap < buffer->corners + corners) {
+      cornercap *= 2;
+    }
+
+    data = sop_realloc(allocator, buffer->batch.data,
+                       cornercap * 3 * sizeof(int));
+    if (!data) {
+      return SOP_EMEM;
+    }
+
+    buffer->batch.data = data;
+    buffer->cornercap = cornercap;
+  }
+
+  return SOP_EOK;
+}
+
+/**
+ * Starts a batch with the header of its first record if it is empty.
+ */
+
+static sop_batch_buffer_t *
+sop_context_batch(sop_context_t *ctx, int slot, const sop_record_t *record) {
+  sop_batch_buffer_t *buffer = &ctx->batches[slot];
+  if (0 == buffer->batch.count) {
+    buffer->batch.type = record->type;
+    buffer->batch.directive = record->directive;
+    buffer->batch.lineno = record->lineno;
+    buffer->batch.material = ctx->material;
+  }
+  return buffer;
+}
+
+/**
+ * Marks a slot pending and flushes it once full. Faces must not arrive
+ * before the vertex attributes they use so a full face batch flushes
+ * every pending batch. Attribute batches never hold lines that follow
+ * a pending face (see sop_context_push()), so flushing one alone keeps
+ * source order.
+ */
+
+static int
+sop_context_pushed(sop_context_t *ctx, int slot) {
+  ctx->pending |= 1 << slot;
+
+  if (ctx->batches[slot].batch.count == ctx->batchsize) {
+    if (SOP_BATCH_FACE == slot) {
+      return sop_context_flush(ctx);
+    }
+    return sop_context_flush_slot(ctx, slot);
+  }
+
+  return SOP_EOK;
+}
+
+/**
+ * Appends a single face of `count` corners to the face batch.
+ */
+
+static int
+sop_context_push_face(sop_context_t *ctx,
+                      const sop_record_t *record,
+                      const int (*corners)[3],
+                      size_t count) {
+  sop_batch_buffer_t *buffer = sop_context_batch(ctx, SOP_BATCH_FACE, record);
+  int (*data)[3] = 0;
+
+  if (SOP_EOK != sop_context_reserve_face(ctx->allocator, buffer,
+                                          ctx->batchsize, count)) {
+    return SOP_EMEM;
+  }
+
+  data = (int (*)[3]) buffer->batch.data;
+  memcpy(data + buffer->corners, corners, count * sizeof(data[0]));
+  buffer->corners += count;
+  buffer->offsets[++buffer->batch.count] = buffer->corners;
+  return sop_context_pushed(ctx, SOP_BATCH_FACE);
+}
+
+int
+sop_context_push(sop_context_t *ctx, const sop_record_t *record) {
+  sop_batch_buffer_t *buffer = 0;
+  float (*data)[4] = 0;
+  int slot = 0;
+
+  switch (record->type) {
+    case SOP_DIRECTIVE_VERTEX: slot = SOP_BATCH_VERTEX; break;
+    case SOP_DIRECTIVE_VERTEX_TEXTURE: slot = SOP_BATCH_TEXTURE; break;
+    case SOP_DIRECTIVE_VERTEX_NORMAL: slot = SOP_BATCH_NORMAL; break;
+    case SOP_DIRECTIVE_FACE: slot = SOP_BATCH_FACE; break;
+    default: return SOP_OOB;
+  }
+
+  if (SOP_BATCH_FACE == slot) {
+    const int (*corners)[3] = ctx->corners->data + record->value.face.offset;
+    const size_t count = record->value.face.count;
+    int rc = SOP_EOK;
+
+    if (!ctx->parser->options->triangulate || count <= 3) {
+      return sop_context_push_face(ctx, record, corners, count);
+    }
+
+    // fan (0, i, i + 1)
+    for (size_t i = 1; i + 1 < count && SOP_EOK == rc; ++i) {
+      int triangle[3][3];
+      memcpy(triangle[0], corners[0], sizeof(triangle[0]));
+      memcpy(triangle[1], corners[i], sizeof(triangle[1]));
+      memcpy(triangle[2], corners[i + 1], sizeof(triangle[2]));
+      rc = sop_context_push_face(ctx, record,
+                                 (const int (*)[3]) triangle, 3);
+    }
+
+    return rc;
+  }
+
+  // attributes after pending faces must not reach the consumer first,
+  // so everything pending (all of it ahead of the faces) goes out now
+  if (ctx->pending & (1 << SOP_BATCH_FACE)) {
+    int rc = sop_context_flush(ctx);
+    if (SOP_EOK != rc) {
+      return rc;
+    }
+  }
+
+  buffer = sop_context_batch(ctx, slot, record);
+  if (!buffer->batch.data) {
+    buffer->batch.data = sop_alloc(ctx->allocator,
+                                   ctx->batchsize * 4 * sizeof(float));
+    if (!buffer->batch.data) {
+      return SOP_EMEM;
+    }
+  }
+
+  data = (float (*)[4]) buffer->batch.data;
+  memcpy(data[buffer->batch.count++],
+         record->value.floats,
+         sizeof(data[0]));
+  return sop_context_pushed(ctx, slot);
+}
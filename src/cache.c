@@ -0,0 +1,534 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sop/sop.h>
+#include "internal.h"
+
+/**
+ * Binary mesh cache (.sopb) layout, all values in native byte order:
+ *
+ *   header             sop_cache_header_t
+ *   block directory    sop_cache_block_t[header.blocks]
+ *   blocks             each aligned to SOP_CACHE_ALIGN bytes
+ *
+ * Readers skip block types they don't know so blocks can be added
+ * without a version bump. Anything else changing the layout bumps
+ * SOP_CACHE_VERSION and makes older caches regenerate.
+ */
+
+#define SOP_CACHE_MAGIC "SOPB"
+#define SOP_CACHE_VERSION 1
+#define SOP_CACHE_ENDIAN 0x01020304
+#define SOP_CACHE_ALIGN 64
+
+/**
+ * Cache block types.
+ */
+
+enum {
+  SOP_CACHE_POSITIONS = 1,
+  SOP_CACHE_TEXCOORDS,
+  SOP_CACHE_NORMALS,
+  SOP_CACHE_POSITION_INDICES,
+  SOP_CACHE_TEXCOORD_INDICES,
+  SOP_CACHE_NORMAL_INDICES,
+  SOP_CACHE_FACE_OFFSETS,
+  SOP_CACHE_WELD_VERTICES,
+  SOP_CACHE_WELD_INDICES,
+};
+
+/**
+ * Mesh options a cache was written with, a cache only serves loads
+ * with the same options.
+ */
+
+enum {
+  SOP_CACHE_WELD = 1 << 0,
+  SOP_CACHE_TRIANGULATE = 1 << 1,
+};
+
+typedef struct sop_cache_header sop_cache_header_t;
+struct sop_cache_header {
+  char magic[4];
+  uint32_t version;
+  uint32_t endian;
+  uint32_t flags;
+
+  // content hash and length of the OBJ source
+  uint64_t hash;
+  uint64_t length;
+
+  // welded vertex layout
+  int32_t texcoord_offset;
+  int32_t normal_offset;
+
+  // number of entries in the block directory
+  uint32_t blocks;
+  uint32_t reserved;
+};
+
+typedef struct sop_cache_block sop_cache_block_t;
+struct sop_cache_block {
+  uint32_t type;
+
+  // bytes per element
+  uint32_t size;
+
+  // element count and file offset
+  uint64_t count;
+  uint64_t offset;
+};
+
+/**
+ * Hashes a source 8 bytes at a time. Not cryptographic, it only tells
+ * edited sources apart.
+ */
+
+static uint64_t
+sop_cache_hash(const char *source, size_t length) {
+  uint64_t hash = 0x9e3779b97f4a7c15ULL ^ length;
+  size_t i = 0;
+
+  for (; i + 8 <= length; i += 8) {
+    uint64_t word = 0;
+    memcpy(&word, source + i, sizeof(word));
+    hash = (hash ^ word) * 0xff51afd7ed558ccdULL;
+    hash ^= hash >> 32;
+  }
+
+  if (i < length) {
+    uint64_t word = 0;
+    memcpy(&word, source + i, length - i);
+    hash = (hash ^ word) * 0xff51afd7ed558ccdULL;
+    hash ^= hash >> 32;
+  }
+
+  return hash ^ (hash >> 29);
+}
+
+static uint32_t
+sop_cache_flags(const sop_mesh_t *mesh) {
+  uint32_t flags = 0;
+  if (mesh->options && mesh->options->weld) {
+    flags |= SOP_CACHE_WELD;
+  }
+  if (mesh->options && mesh->options->triangulate) {
+    flags |= SOP_CACHE_TRIANGULATE;
+  }
+  return flags;
+}
+
+/**
+ * Checks that an index array of `count` entries only refers to elements
+ * in [`lower`, `upper`).
+ */
+
+static int
+sop_cache_check_indices(const int *indices,
+                        size_t count,
+                        int lower,
+                        size_t upper) {
+  for (size_t i = 0; i < count; ++i) {
+    if (indices[i] < lower ||
+        (indices[i] >= 0 && (size_t) indices[i] >= upper)) {
+      return 0;
+    }
+  }
+  return 1;
+}
+
+/**
+ * Checks that the blocks a cache was mapped from agree with each other
+ * so a truncated or corrupt cache can't send readers out of bounds.
+ * `counts` holds the element count of each block type seen.
+ */
+
+static int
+sop_cache_check(const sop_mesh_t *mesh, const uint64_t *counts) {
+  const size_t indices = mesh->index_count;
+  const int weld = 0 != counts[SOP_CACHE_WELD_VERTICES] ||
+                   0 != counts[SOP_CACHE_WELD_INDICES];
+
+  if (counts[SOP_CACHE_TEXCOORD_INDICES] != indices ||
+      counts[SOP_CACHE_NORMAL_INDICES] != indices ||
+      (weld && counts[SOP_CACHE_WELD_INDICES] != indices)) {
+    return 0;
+  }
+
+  if (!sop_cache_check_indices(mesh->position_indices, indices,
+                               0, mesh->position_count) ||
+      !sop_cache_check_indices(mesh->texcoord_indices, indices,
+                               -1, mesh->texcoord_count) ||
+      !sop_cache_check_indices(mesh->normal_indices, indices,
+                               -1, mesh->normal_count)) {
+    return 0;
+  }
+
+  if (counts[SOP_CACHE_FACE_OFFSETS]) {
+    if (0 != mesh->face_offsets[0]) {
+      return 0;
+    }
+    for (size_t i = 1; i <= mesh->face_count; ++i) {
+      if (mesh->face_offsets[i] < mesh->face_offsets[i - 1] ||
+          mesh->face_offsets[i] > indices) {
+        return 0;
+      }
+    }
+  }
+
+  if (weld) {
+    const size_t stride = mesh->weld.stride;
+    if ((2 != mesh->weld.index_size && 4 != mesh->weld.index_size) ||
+        stride < 3 ||
+        (mesh->weld.texcoord_offset >= 0 &&
+         (size_t) mesh->weld.texcoord_offset + 2 > stride) ||
+        (mesh->weld.normal_offset >= 0 &&
+         (size_t) mesh->weld.normal_offset + 3 > stride)) {
+      return 0;
+    }
+
+    for (size_t i = 0; i < indices; ++i) {
+      const uint32_t index = 2 == mesh->weld.index_size
+        ? ((const uint16_t *) mesh->weld.indices)[i]
+        : ((const uint32_t *) mesh->weld.indices)[i];
+      if (index >= mesh->weld.vertex_count) {
+        return 0;
+      }
+    }
+  }
+
+  return 1;
+}
+
+/**
+ * Maps a cache and points the mesh arrays into it. Returns SOP_EOK only
+ * for a cache of the current version written from the same source with
+ * the same options.
+ */
+
+static int
+sop_cache_map(const char *path,
+              uint64_t hash,
+              uint64_t length,
+              sop_mesh_t *mesh) {
+  const sop_cache_header_t *header = 0;
+  const sop_cache_block_t *blocks = 0;
+  uint64_t counts[SOP_CACHE_WELD_INDICES + 1] = { 0 };
+  struct stat st;
+  char *mapping = 0;
+  size_t size = 0;
+  int fd = -1;
+
+  fd = open(path, O_RDONLY);
+  if (fd < 0) {
+    return SOP_EINVALID_SOURCE;
+  }
+
+  if (0 != fstat(fd, &st) ||
+      (uint64_t) st.st_size < sizeof(sop_cache_header_t) ||
+      (uint64_t) st.st_size > SIZE_MAX) {
+    close(fd);
+    return SOP_EINVALID_SOURCE;
+  }
+
+  // private writable pages let callers edit the arrays in place
+  size = (size_t) st.st_size;
+  mapping = (char *) mmap(0, size, PROT_READ | PROT_WRITE,
+                          MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (MAP_FAILED == (void *) mapping) {
+    return SOP_EINVALID_SOURCE;
+  }
+
+  header = (const sop_cache_header_t *) mapping;
+  blocks = (const sop_cache_block_t *) (header + 1);
+
+  if (0 != memcmp(header->magic, SOP_CACHE_MAGIC, 4) ||
+      SOP_CACHE_VERSION != header->version ||
+      SOP_CACHE_ENDIAN != header->endian ||
+      sop_cache_flags(mesh) != header->flags ||
+      hash != header->hash ||
+      length != header->length ||
+      header->blocks > (size - sizeof(*header)) / sizeof(*blocks)) {
+    munmap(mapping, size);
+    return SOP_EINVALID_SOURCE;
+  }
+
+  mesh->external = 1;
+  mesh->mapping = mapping;
+  mesh->mapsize = size;
+
+  for (uint32_t i = 0; i < header->blocks; ++i) {
+    const sop_cache_block_t *block = &blocks[i];
+    void *data = mapping + block->offset;
+    uint32_t expected = 0;
+
+    switch (block->type) {
+      case SOP_CACHE_POSITIONS:
+      case SOP_CACHE_NORMALS:
+        expected = 3 * sizeof(float);
+        break;
+      case SOP_CACHE_TEXCOORDS:
+        expected = 2 * sizeof(float);
+        break;
+      case SOP_CACHE_POSITION_INDICES:
+      case SOP_CACHE_TEXCOORD_INDICES:
+      case SOP_CACHE_NORMAL_INDICES:
+        expected = sizeof(int);
+        break;
+      case SOP_CACHE_FACE_OFFSETS:
+        expected = sizeof(size_t);
+        break;
+      case SOP_CACHE_WELD_VERTICES:
+      case SOP_CACHE_WELD_INDICES:
+        expected = block->size;
+        break;
+      default:
+        continue;
+    }
+
+    if (0 == block->size ||
+        expected != block->size ||
+        0 != block->offset % SOP_CACHE_ALIGN ||
+        block->offset > size ||
+        block->count > (size - block->offset) / block->size) {
+      sop_cache_unmap(mesh);
+      return SOP_EINVALID_SOURCE;
+    }
+
+    counts[block->type] = block->count;
+    switch (block->type) {
+      case SOP_CACHE_POSITIONS:
+        mesh->positions = (float *) data;
+        mesh->position_count = mesh->capacity.positions = block->count;
+        break;
+      case SOP_CACHE_TEXCOORDS:
+        mesh->texcoords = (float *) data;
+        mesh->texcoord_count = mesh->capacity.texcoords = block->count;
+        break;
+      case SOP_CACHE_NORMALS:
+        mesh->normals = (float *) data;
+        mesh->normal_count = mesh->capacity.normals = block->count;
+        break;
+      case SOP_CACHE_POSITION_INDICES:
+        mesh->position_indices = (int *) data;
+        mesh->index_count = mesh->capacity.indices = block->count;
+        break;
+      case SOP_CACHE_TEXCOORD_INDICES:
+        mesh->texcoord_indices = (int *) data;
+        break;
+      case SOP_CACHE_NORMAL_INDICES:
+        mesh->normal_indices = (int *) data;
+        break;
+      case SOP_CACHE_FACE_OFFSETS:
+        mesh->face_offsets = (size_t *) data;
+        mesh->capacity.faces = block->count;
+        mesh->face_count = block->count ? block->count - 1 : 0;
+        break;
+      case SOP_CACHE_WELD_VERTICES:
+        mesh->weld.vertices = (float *) data;
+        mesh->weld.vertex_count = block->count;
+        mesh->weld.stride = block->size / sizeof(float);
+        mesh->weld.texcoord_offset = header->texcoord_offset;
+        mesh->weld.normal_offset = header->normal_offset;
+        break;
+      case SOP_CACHE_WELD_INDICES:
+        mesh->weld.indices = data;
+        mesh->weld.index_size = block->size;
+        break;
+    }
+  }
+
+  if (!sop_cache_check(mesh, counts)) {
+    sop_cache_unmap(mesh);
+    return SOP_EINVALID_SOURCE;
+  }
+
+  return SOP_EOK;
+}
+
+/**
+ * Writes `size` zero bytes.
+ */
+
+static int
+sop_cache_pad(FILE *file, size_t size) {
+  static const char zeros[SOP_CACHE_ALIGN];
+  return size == fwrite(zeros, 1, size, file);
+}
+
+/**
+ * Writes a cache of a loaded mesh next to `path` and moves it in place
+ * once complete so readers never see a partial cache.
+ */
+
+static int
+sop_cache_write(const char *path,
+                uint64_t hash,
+                uint64_t length,
+                const sop_mesh_t *mesh) {
+  sop_cache_header_t header;
+  sop_cache_block_t blocks[9];
+  const void *data[9];
+  size_t pathsize = strlen(path);
+  char *temporary = 0;
+  FILE *file = 0;
+  uint64_t offset = 0;
+  uint32_t count = 0;
+  int ok = 1;
+
+#define BLOCK(t, d, n, s) {              \
+  blocks[count].type = t;                \
+  blocks[count].size = (uint32_t) (s);   \
+  blocks[count].count = n;               \
+  blocks[count].offset = 0;              \
+  data[count++] = d;                     \
+}
+  BLOCK(SOP_CACHE_POSITIONS, mesh->positions,
+        mesh->position_count, 3 * sizeof(float));
+  BLOCK(SOP_CACHE_TEXCOORDS, mesh->texcoords,
+        mesh->texcoord_count, 2 * sizeof(float));
+  BLOCK(SOP_CACHE_NORMALS, mesh->normals,
+        mesh->normal_count, 3 * sizeof(float));
+  BLOCK(SOP_CACHE_POSITION_INDICES, mesh->position_indices,
+        mesh->index_count, sizeof(int));
+  BLOCK(SOP_CACHE_TEXCOORD_INDICES, mesh->texcoord_indices,
+        mesh->index_count, sizeof(int));
+  BLOCK(SOP_CACHE_NORMAL_INDICES, mesh->normal_indices,
+        mesh->index_count, sizeof(int));
+  BLOCK(SOP_CACHE_FACE_OFFSETS, mesh->face_offsets,
+        mesh->face_offsets ? mesh->face_count + 1 : 0, sizeof(size_t));
+  if (mesh->weld.stride) {
+    BLOCK(SOP_CACHE_WELD_VERTICES, mesh->weld.vertices,
+          mesh->weld.vertex_count, mesh->weld.stride * sizeof(float));
+    BLOCK(SOP_CACHE_WELD_INDICES, mesh->weld.indices,
+          mesh->index_count, mesh->weld.index_size);
+  }
+#undef BLOCK
+
+  memset(&header, 0, sizeof(header));
+  memcpy(header.magic, SOP_CACHE_MAGIC, 4);
+  header.version = SOP_CACHE_VERSION;
+  header.endian = SOP_CACHE_ENDIAN;
+  header.flags = sop_cache_flags(mesh);
+  header.hash = hash;
+  header.length = length;
+  header.texcoord_offset = mesh->weld.texcoord_offset;
+  header.normal_offset = mesh->weld.normal_offset;
+  header.blocks = count;
+
+  offset = sizeof(header) + count * sizeof(blocks[0]);
+  for (uint32_t i = 0; i < count; ++i) {
+    offset = (offset + SOP_CACHE_ALIGN - 1) & ~(uint64_t) (SOP_CACHE_ALIGN - 1);
+    blocks[i].offset = offset;
+    offset += blocks[i].count * blocks[i].size;
+  }
+
+  temporary = (char *) malloc(pathsize + sizeof(".tmp"));
+  if (!temporary) {
+    return SOP_EMEM;
+  }
+
+  memcpy(temporary, path, pathsize);
+  memcpy(temporary + pathsize, ".tmp", sizeof(".tmp"));
+
+  file = fopen(temporary, "wb");
+  if (!file) {
+    free(temporary);
+    return SOP_EINVALID_SOURCE;
+  }
+
+  offset = sizeof(header) + count * sizeof(blocks[0]);
+  ok = 1 == fwrite(&header, sizeof(header), 1, file) &&
+       count == fwrite(blocks, sizeof(blocks[0]), count, file);
+
+  for (uint32_t i = 0; i < count && ok; ++i) {
+    size_t size = (size_t) (blocks[i].count * blocks[i].size);
+    ok = sop_cache_pad(file, (size_t) (blocks[i].offset - offset)) &&
+         (0 == size || size == fwrite(data[i], 1, size, file));
+    offset = blocks[i].offset + size;
+  }
+
+  ok = 0 == fclose(file) && ok;
+  if (!ok || 0 != rename(temporary, path)) {
+    (void) remove(temporary);
+    ok = 0;
+  }
+
+  free(temporary);
+  return ok ? SOP_EOK : SOP_EINVALID_SOURCE;
+}
+
+void
+sop_cache_unmap(sop_mesh_t *mesh) {
+  sop_mesh_options_t *options = mesh->options;
+  munmap(mesh->mapping, mesh->mapsize);
+  memset(mesh, 0, sizeof(sop_mesh_t));
+  mesh->options = options;
+}
+
+int
+sop_mesh_load_file(const char *path, const char *cache, sop_mesh_t *mesh) {
+  const sop_allocator_t *allocator = 0;
+  sop_file_t source;
+  char *defaultcache = 0;
+  sop_trace_t *trace = 0;
+  uint64_t hash = 0;
+  uint64_t begin = 0;
+  int rc = SOP_EOK;
+
+  if (!mesh) {
+    return SOP_EMEM;
+  } else if (!path) {
+    return SOP_EINVALID_SOURCE;
+  } else if (mesh->position_count || mesh->index_count || mesh->mapping) {
+    return SOP_EINVALID_OPTIONS;
+  }
+
+  if (!cache) {
+    size_t pathsize = strlen(path);
+    defaultcache = (char *) malloc(pathsize + sizeof(".sopb"));
+    if (!defaultcache) {
+      return SOP_EMEM;
+    }
+    memcpy(defaultcache, path, pathsize);
+    memcpy(defaultcache + pathsize, ".sopb", sizeof(".sopb"));
+    cache = defaultcache;
+  }
+
+  trace = mesh->options ? mesh->options->trace : 0;
+  allocator = mesh->options ? mesh->options->allocator : 0;
+  rc = sop_file_map(path, allocator, &source);
+  if (SOP_EOK != rc) {
+    free(defaultcache);
+    return rc;
+  }
+
+  begin = sop_trace_begin(trace);
+  hash = sop_cache_hash(source.data, source.length);
+  sop_trace_end(trace, "cache", "hash", begin);
+
+  begin = sop_trace_begin(trace);
+  rc = sop_cache_map(cache, hash, source.length, mesh);
+  sop_trace_end(trace, "cache", "map", begin);
+
+  if (SOP_EOK != rc) {
+    rc = sop_mesh_load(source.data, source.length, mesh);
+    if (SOP_EOK == rc) {
+      begin = sop_trace_begin(trace);
+      (void) sop_cache_write(cache, hash, source.length, mesh);
+      sop_trace_end(trace, "cache", "write", begin);
+    }
+  }
+
+  sop_file_unmap(&source, allocator);
+  free(defaultcache);
+  return rc;
+}
@@ -0,0 +1,78 @@
+#include <string.h>
+#include <sop/sop.h>
+#include "internal.h"
+
+#define IS_SPACE(c) (' ' == (c) || '\t' == (c) || '\r' == (c))
+
+/**
+ * Counts the white space separated corners of a face line.
+ */
+
+static size_t
+sop_count_corners(const char *span, size_t length) {
+  size_t corners = 0;
+  int token = 0;
+
+  for (size_t i = 0; i < length; ++i) {
+    int space = (unsigned char) span[i] <= ' ';
+    corners += !space && !token;
+    token = !space;
+  }
+
+  return corners;
+}
+
+int
+sop_parser_count(const char *source,
+                 size_t length,
+                 sop_parser_counts_t *counts) {
+  sop_scanner_t scanner;
+  const char *span = 0;
+  size_t spansize = 0;
+
+  if (!counts) {
+    return SOP_EMEM;
+  } else if (!source || 0 == length) {
+    return SOP_EINVALID_SOURCE;
+  }
+
+  memset(counts, 0, sizeof(sop_parser_counts_t));
+  sop_scanner_init(&scanner, source, length);
+
+  while (sop_scanner_next(&scanner, &span, &spansize)) {
+    const char *end = span + spansize;
+    char *directive = 0;
+    size_t skip = 0;
+    size_t corners = 0;
+
+    while (span < end && IS_SPACE(*span)) { span++; }
+    if (span == end) {
+      continue;
+    }
+
+    switch (sop_parser_directive(span, (size_t) (end - span),
+                                 &directive, &skip)) {
+      case SOP_DIRECTIVE_VERTEX: counts->vertices++; break;
+      case SOP_DIRECTIVE_VERTEX_TEXTURE: counts->textures++; break;
+      case SOP_DIRECTIVE_VERTEX_NORMAL: counts->normals++; break;
+      case SOP_DIRECTIVE_USE_MTL: counts->materials++; break;
+
+      case SOP_DIRECTIVE_FACE:
+        corners = sop_count_corners(span + skip, (size_t) (end - span) - skip);
+        counts->faces++;
+        counts->corners += corners;
+        counts->triangles += corners > 2 ? corners - 2 : 0;
+        break;
+
+      case SOP_DIRECTIVE_GROUP:
+      case SOP_DIRECTIVE_OBJECT:
+        counts->groups++;
+        break;
+
+      default:
+        break;
+    }
+  }
+
+  return SOP_EOK;
+}
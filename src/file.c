@@ -0,0 +1,170 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sop/sop.h>
+#include "internal.h"
+
+/**
+ * Size of the buffer sources are read into when they can't be mapped.
+ */
+
+#define SOP_FILE_READ_SIZE (64 * 1024)
+
+/**
+ * Parses a file that can't be mapped (pipes, character devices or
+ * files larger than the address space) by streaming fixed size reads
+ * through the parser.
+ */
+
+static int
+sop_file_read(sop_parser_t *parser, int fd) {
+  char buffer[SOP_FILE_READ_SIZE];
+  int rc = SOP_EOK;
+
+  for (;;) {
+    ssize_t size = read(fd, buffer, sizeof(buffer));
+    if (size < 0) {
+      sop_parser_destroy(parser);
+      return SOP_EINVALID_SOURCE;
+    } else if (0 == size) {
+      break;
+    }
+
+    rc = sop_parser_feed(parser, buffer, (size_t) size);
+    if (SOP_EOK != rc) {
+      sop_parser_destroy(parser);
+      return rc;
+    }
+  }
+
+  // an empty source is rejected like sop_parser_execute() does
+  if (!parser->stream) {
+    return SOP_EINVALID_SOURCE;
+  }
+
+  return sop_parser_finish(parser);
+}
+
+int
+sop_file_map(const char *path,
+             const sop_allocator_t *allocator,
+             sop_file_t *file) {
+  struct stat st;
+  char *data = 0;
+  size_t capacity = 0;
+  int fd = -1;
+
+  memset(file, 0, sizeof(sop_file_t));
+
+  fd = open(path, O_RDONLY);
+  if (fd < 0) {
+    return SOP_EINVALID_SOURCE;
+  }
+
+  if (0 == fstat(fd, &st) &&
+      S_ISREG(st.st_mode) &&
+      st.st_size > 0 &&
+      (uint64_t) st.st_size <= SIZE_MAX) {
+    void *source = mmap(0, (size_t) st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (MAP_FAILED != source) {
+      (void) posix_madvise(source, (size_t) st.st_size, POSIX_MADV_SEQUENTIAL);
+      close(fd);
+      file->data = (const char *) source;
+      file->length = (size_t) st.st_size;
+      file->mapped = 1;
+      return SOP_EOK;
+    }
+  }
+
+  // read what can't be mapped into memory from `allocator`
+  for (;;) {
+    ssize_t size = 0;
+    if (file->length == capacity) {
+      char *next = 0;
+      capacity = capacity ? 2 * capacity : SOP_FILE_READ_SIZE;
+      next = (char *) sop_realloc(allocator, data, capacity);
+      if (!next) {
+        sop_free(allocator, data);
+        close(fd);
+        return SOP_EMEM;
+      }
+      data = next;
+    }
+
+    size = read(fd, data + file->length, capacity - file->length);
+    if (size < 0) {
+      sop_free(allocator, data);
+      close(fd);
+      return SOP_EINVALID_SOURCE;
+    } else if (0 == size) {
+      break;
+    }
+
+    file->length += (size_t) size;
+  }
+
+  close(fd);
+  file->data = data;
+  return SOP_EOK;
+}
+
+void
+sop_file_unmap(sop_file_t *file, const sop_allocator_t *allocator) {
+  if (file->mapped) {
+    munmap((void *) file->data, file->length);
+  } else {
+    sop_free(allocator, (void *) file->data);
+  }
+  memset(file, 0, sizeof(sop_file_t));
+}
+
+int
+sop_parser_execute_file(sop_parser_t *parser, const char *path) {
+  struct stat st;
+  void *source = MAP_FAILED;
+  size_t length = 0;
+  int rc = SOP_EOK;
+  int fd = -1;
+
+  if (!parser) {
+    return SOP_EMEM;
+  } else if (!path) {
+    return SOP_EINVALID_SOURCE;
+  }
+
+  fd = open(path, O_RDONLY);
+  if (fd < 0) {
+    return SOP_EINVALID_SOURCE;
+  }
+
+  if (0 == fstat(fd, &st) &&
+      S_ISREG(st.st_mode) &&
+      st.st_size > 0 &&
+      (uint64_t) st.st_size <= SIZE_MAX) {
+    length = (size_t) st.st_size;
+    source = mmap(0, length, PROT_READ, MAP_PRIVATE, fd, 0);
+  }
+
+  // material libraries are relative to the file
+  parser->path = path;
+
+  if (MAP_FAILED == source) {
+    rc = sop_file_read(parser, fd);
+  } else {
+    // lines are visited front to back exactly once
+    (void) posix_madvise(source, length, POSIX_MADV_SEQUENTIAL);
+    rc = sop_parser_execute(parser, (const char *) source, length);
+    munmap(source, length);
+  }
+
+  parser->path = 0;
+  close(fd);
+  return rc;
+}
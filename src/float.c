@@ -0,0 +1,402 @@
+#include <stdlib.h>
+#include <string.h>
+#include <locale.h>
+#include <stdint.h>
+#include <float.h>
+#include <sop/sop.h>
+
+#if (defined(__x86_64__) || defined(_M_X64)) && \
+    (defined(__GNUC__) || defined(__clang__))
+#define SOP_FLOAT_SSSE3 1
+#include <immintrin.h>
+#endif
+
+/**
+ * Largest mantissa that converts to a double exactly (2^53).
+ */
+
+#define SOP_FLOAT_MAX_EXACT_MANTISSA (((uint64_t) 1) << 53)
+
+/**
+ * Largest power of ten that is exactly representable as a double.
+ */
+
+#define SOP_FLOAT_MAX_EXACT_POW10 22
+
+/**
+ * Maximum number of significant decimal digits accumulated into
+ * the 64 bit mantissa before we give up on the fast path.
+ */
+
+#define SOP_FLOAT_MAX_DIGITS 19
+
+/**
+ * Size of the scratch buffer used by the slow path.
+ */
+
+#define SOP_FLOAT_SCRATCH_SIZE 128
+
+static const double pow10_table[SOP_FLOAT_MAX_EXACT_POW10 + 1] = {
+  1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+  1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22,
+};
+
+#define IS_DIGIT(c) ((unsigned char) ((c) - '0') < 10)
+
+/**
+ * Returns nonzero if the double `d` sits exactly halfway between two
+ * adjacent normal floats. A correctly rounded double can only round to
+ * the wrong float when it lands exactly on such a midpoint, so these
+ * values are handed to the slow path.
+ */
+
+static int
+is_float_midpoint(double d) {
+  uint64_t bits = 0;
+  memcpy(&bits, &d, sizeof(bits));
+  // 53 - 24 = 29 bits of the double mantissa are dropped when
+  // rounding to float, the midpoint is the pattern 100...0
+  return (bits & 0x1fffffff) == 0x10000000;
+}
+
+/**
+ * Converts the token in [source, source + length) with strtof(). The
+ * radix is rewritten to the radix of the current locale so the result
+ * is the same regardless of LC_NUMERIC.
+ */
+
+static float
+slow_strtof(const char *source, size_t length) {
+  char scratch[SOP_FLOAT_SCRATCH_SIZE];
+  const char *radix = localeconv()->decimal_point;
+  size_t radixlen = radix ? strlen(radix) : 0;
+  size_t size = length * (radixlen ? radixlen : 1) + 1;
+  char *buf = scratch;
+  size_t n = 0;
+  float value = 0;
+
+  if (size > sizeof(scratch)) {
+    buf = (char *) malloc(size);
+    if (!buf) { return 0; }
+  }
+
+  for (size_t i = 0; i < length; ++i) {
+    if ('.' == source[i] && radixlen) {
+      memcpy(buf + n, radix, radixlen);
+      n += radixlen;
+    } else {
+      buf[n++] = source[i];
+    }
+  }
+
+  buf[n] = 0;
+  value = strtof(buf, 0);
+
+  if (buf != scratch) {
+    free(buf);
+  }
+
+  return value;
+}
+
+size_t
+sop_strtof(const char *source, size_t length, float *out) {
+  const char *end = source + length;
+  const char *p = source;
+  uint64_t mantissa = 0;
+  int64_t exponent = 0;
+  int negative = 0;
+  int truncated = 0;
+  int digits = 0;
+  int seen = 0;
+
+  if (!source || !out) { return 0; }
+
+  if (p < end && ('-' == *p || '+' == *p)) {
+    negative = '-' == *p;
+    p++;
+  }
+
+  // integer part
+  for (; p < end && IS_DIGIT(*p); ++p) {
+    seen = 1;
+    if (digits < SOP_FLOAT_MAX_DIGITS) {
+      mantissa = mantissa * 10 + (uint64_t) (*p - '0');
+      digits += mantissa > 0;
+    } else {
+      truncated |= '0' != *p;
+      exponent++;
+    }
+  }
+
+  // fractional part
+  if (p < end && '.' == *p) {
+    for (++p; p < end && IS_DIGIT(*p); ++p) {
+      seen = 1;
+      if (digits < SOP_FLOAT_MAX_DIGITS) {
+        mantissa = mantissa * 10 + (uint64_t) (*p - '0');
+        digits += mantissa > 0;
+        exponent--;
+      } else {
+        truncated |= '0' != *p;
+      }
+    }
+  }
+
+  if (!seen) {
+    // let strtof() deal with "inf" and "nan" spellings
+    const char *q = p;
+    while (q < end && ((*q | 0x20) >= 'a' && (*q | 0x20) <= 'z')) { q++; }
+    if (q > p && ('i' == (*p | 0x20) || 'n' == (*p | 0x20))) {
+      char *stop = 0;
+      char word[16] = {0};
+      size_t size = (size_t) (q - source);
+      if (size >= sizeof(word)) { return 0; }
+      memcpy(word, source, size);
+      *out = strtof(word, &stop);
+      return stop > word ? (size_t) (stop - word) : 0;
+    }
+    return 0;
+  }
+
+  // exponent part, only consumed when followed by at least one digit
+  if (p < end && ('e' == *p || 'E' == *p)) {
+    const char *q = p + 1;
+    int64_t value = 0;
+    int sign = 1;
+    if (q < end && ('-' == *q || '+' == *q)) {
+      sign = '-' == *q ? -1 : 1;
+      q++;
+    }
+
+    if (q < end && IS_DIGIT(*q)) {
+      for (; q < end && IS_DIGIT(*q); ++q) {
+        if (value < 100000) {
+          value = value * 10 + (*q - '0');
+        }
+      }
+      exponent += sign * value;
+      p = q;
+    }
+  }
+
+#if defined(FLT_EVAL_METHOD) && 0 == FLT_EVAL_METHOD
+  if (0 == mantissa) {
+    *out = negative ? -0.0f : 0.0f;
+    return (size_t) (p - source);
+  }
+
+  // Clinger's fast path: both the mantissa and the power of ten are
+  // exact doubles, so a single multiply or divide is correctly rounded
+  if (!truncated &&
+      mantissa <= SOP_FLOAT_MAX_EXACT_MANTISSA &&
+      exponent >= -SOP_FLOAT_MAX_EXACT_POW10 &&
+      exponent <= SOP_FLOAT_MAX_EXACT_POW10) {
+    double d = (double) mantissa;
+    if (exponent < 0) {
+      d /= pow10_table[-exponent];
+    } else {
+      d *= pow10_table[exponent];
+    }
+
+    if (d >= FLT_MIN && d <= FLT_MAX && !is_float_midpoint(d)) {
+      float f = (float) d;
+      *out = negative ? -f : f;
+      return (size_t) (p - source);
+    }
+  }
+#endif
+
+  *out = slow_strtof(source, (size_t) (p - source));
+  return (size_t) (p - source);
+}
+
+/**
+ * Bytes examined at once by the fixed format kernel. Tokens of the form
+ * [-+]d+.d+ that fit in a block are decoded without a digit loop.
+ */
+
+#define SOP_FLOAT_FIXED_BLOCK 16
+
+/**
+ * Decodes the unsigned fixed format token (digits, a single '.' and
+ * digits) at the start of a SOP_FLOAT_FIXED_BLOCK byte `block` of which
+ * `length` bytes belong to the source. The digits are written to
+ * `mantissa` and the number of fractional digits to `scale`. Returns
+ * the token size or 0 if the token has any other shape.
+ */
+
+typedef size_t (* sop_float_fixed_fn) (const char *block,
+                                        size_t length,
+                                        uint64_t *mantissa,
+                                        int *scale);
+
+#if SOP_FLOAT_SSSE3
+__attribute__((target("ssse3")))
+static size_t
+fixed_ssse3(const char *block,
+            size_t length,
+            uint64_t *mantissa,
+            int *scale) {
+  const __m128i chunk = _mm_loadu_si128((const __m128i *) block);
+  const __m128i digits = _mm_sub_epi8(chunk, _mm_set1_epi8('0'));
+  // unsigned (digits <= 9) is (min(digits, 9) == digits)
+  const __m128i isdigit =
+    _mm_cmpeq_epi8(_mm_min_epu8(digits, _mm_set1_epi8(9)), digits);
+  uint32_t dots = (uint32_t)
+    _mm_movemask_epi8(_mm_cmpeq_epi8(chunk, _mm_set1_epi8('.')));
+  uint32_t token = (uint32_t) _mm_movemask_epi8(isdigit) | dots;
+  uint32_t size = (uint32_t) __builtin_ctz(~token);
+  uint32_t dot = 0;
+  __m128i index;
+  __m128i value;
+  uint32_t high = 0;
+  uint32_t low = 0;
+
+  // longer than a block, past the source or followed by an exponent
+  if (size >= SOP_FLOAT_FIXED_BLOCK || size > length) { return 0; }
+  if (size < length && 'e' == (block[size] | 0x20)) { return 0; }
+
+  // exactly one '.' with a digit on either side
+  dots &= (1u << size) - 1;
+  if (0 == dots || (dots & (dots - 1))) { return 0; }
+  dot = (uint32_t) __builtin_ctz(dots);
+  if (0 == dot || dot + 1 == size) { return 0; }
+
+  // right align the size - 1 digits, skipping the '.'; lanes left of
+  // the digits get a negative index which pshufb turns into zero
+  index = _mm_sub_epi8(
+    _mm_setr_epi8(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15),
+    _mm_set1_epi8((char) (SOP_FLOAT_FIXED_BLOCK + 1 - size)));
+  index = _mm_sub_epi8(index,
+                       _mm_cmpgt_epi8(index, _mm_set1_epi8((char) dot - 1)));
+  value = _mm_shuffle_epi8(digits, index);
+
+  // 16 digits -> 8 x 2 -> 4 x 4 -> 2 x 8 digit integers
+  value = _mm_maddubs_epi16(value, _mm_setr_epi8(10, 1, 10, 1, 10, 1, 10, 1,
+                                                 10, 1, 10, 1, 10, 1, 10, 1));
+  value = _mm_madd_epi16(value, _mm_setr_epi16(100, 1, 100, 1,
+                                               100, 1, 100, 1));
+  value = _mm_packs_epi32(value, value);
+  value = _mm_madd_epi16(value, _mm_setr_epi16(10000, 1, 10000, 1,
+                                               10000, 1, 10000, 1));
+  high = (uint32_t) _mm_cvtsi128_si32(value);
+  low = (uint32_t) _mm_cvtsi128_si32(_mm_srli_si128(value, 4));
+
+  *mantissa = (uint64_t) high * 100000000 + low;
+  *scale = (int) (size - dot - 1);
+  return size;
+}
+#endif
+
+static size_t
+fixed_dispatch(const char *block,
+               size_t length,
+               uint64_t *mantissa,
+               int *scale);
+
+static sop_float_fixed_fn fixed_kernel = fixed_dispatch;
+
+/**
+ * Resolves the fixed format kernel for the running CPU, none when SSSE3
+ * is missing. Threads may resolve it at the same time so `fixed_kernel`
+ * is only accessed atomically.
+ */
+
+static size_t
+fixed_dispatch(const char *block,
+               size_t length,
+               uint64_t *mantissa,
+               int *scale) {
+  sop_float_fixed_fn kernel = 0;
+#if SOP_FLOAT_SSSE3
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("ssse3")) {
+    kernel = fixed_ssse3;
+  }
+#endif
+  __atomic_store_n(&fixed_kernel, kernel, __ATOMIC_RELAXED);
+  return kernel ? kernel(block, length, mantissa, scale) : 0;
+}
+
+/**
+ * Parses a fixed format value such as "-0.123456" with the fixed format
+ * kernel. Returns 0 for anything else, including values the Clinger
+ * fast path cannot round, so the caller falls back to sop_strtof().
+ */
+
+static size_t
+parse_fixed(const char *source, size_t length, float *out) {
+#if defined(FLT_EVAL_METHOD) && 0 == FLT_EVAL_METHOD
+  sop_float_fixed_fn kernel = __atomic_load_n(&fixed_kernel, __ATOMIC_RELAXED);
+  char padded[SOP_FLOAT_FIXED_BLOCK] = {0};
+  const char *block = source;
+  uint64_t mantissa = 0;
+  size_t sign = 0;
+  size_t size = 0;
+  int scale = 0;
+  double d = 0;
+  float f = 0;
+
+  if (!kernel) { return 0; }
+
+  if ('-' == *source || '+' == *source) {
+    sign = 1;
+    block++;
+  }
+
+  // never read past the source, a short tail is copied and zero padded
+  if (length - sign < SOP_FLOAT_FIXED_BLOCK) {
+    memcpy(padded, block, length - sign);
+    block = padded;
+  }
+
+  size = kernel(block, length - sign, &mantissa, &scale);
+  if (0 == size) { return 0; }
+
+  if (0 == mantissa) {
+    *out = '-' == *source ? -0.0f : 0.0f;
+    return sign + size;
+  }
+
+  // at most 15 digits and 14 decimals keep Clinger's fast path exact
+  d = (double) mantissa / pow10_table[scale];
+  if (d < FLT_MIN || is_float_midpoint(d)) { return 0; }
+
+  f = (float) d;
+  *out = '-' == *source ? -f : f;
+  return sign + size;
+#else
+  (void) source;
+  (void) length;
+  (void) out;
+  return 0;
+#endif
+}
+
+size_t
+sop_parse_floats(const char *source,
+                 size_t length,
+                 float *out,
+                 size_t count) {
+  const char *end = source + length;
+  const char *p = source;
+  size_t parsed = 0;
+
+  if (!source || !out) { return 0; }
+
+  while (parsed < count) {
+    size_t size = 0;
+    while (p < end && (' ' == *p || '\t' == *p)) { p++; }
+    if (p == end) { break; }
+    size = parse_fixed(p, (size_t) (end - p), &out[parsed]);
+    if (0 == size) {
+      size = sop_strtof(p, (size_t) (end - p), &out[parsed]);
+    }
+    if (0 == size) { break; }
+    p += size;
+    parsed++;
+  }
+
+  return parsed;
+}
@@ -0,0 +1,141 @@
+#include <stdlib.h>
+#include <string.h>
+#include <sop/sop.h>
+#include "internal.h"
+
+/**
+ * Copies a name into a growable NUL terminated buffer.
+ */
+
+static int
+sop_group_name(const sop_allocator_t *allocator,
+               char **buffer,
+               size_t *capacity,
+               const char *name,
+               size_t length) {
+  if (!*buffer || length + 1 > *capacity) {
+    size_t size = *capacity ? *capacity : 64;
+    char *data = 0;
+    while (size < length + 1) {
+      size *= 2;
+    }
+
+    data = (char *) sop_realloc(allocator, *buffer, size);
+    if (!data) {
+      return SOP_EMEM;
+    }
+
+    *buffer = data;
+    *capacity = size;
+  }
+
+  memcpy(*buffer, name, length);
+  (*buffer)[length] = 0;
+  return SOP_EOK;
+}
+
+/**
+ * Notifies on_group_complete of the current group unless it is empty
+ * and starts the next group after it.
+ */
+
+static int
+sop_group_complete(sop_context_t *ctx) {
+  sop_parser_group_t *group = &ctx->group;
+  int rc = SOP_EOK;
+
+  if (!group->object) {
+    group->object = group->name = "";
+  }
+
+  if (group->vertices.count || group->textures.count ||
+      group->normals.count || group->faces.count) {
+    // the consumer may use everything in the group right away
+    rc = sop_context_flush(ctx);
+    if (SOP_EOK == rc) {
+      uint64_t begin = sop_trace_begin(ctx->trace);
+      rc = ctx->parser->callbacks.on_group_complete(&ctx->state, group);
+      sop_trace_end(ctx->trace, "callback", "on_group_complete", begin);
+    }
+  }
+
+#define NEXT(range) \
+  group->range.offset += group->range.count; \
+  group->range.count = 0;
+  NEXT(vertices);
+  NEXT(textures);
+  NEXT(normals);
+  NEXT(faces);
+  NEXT(corners);
+#undef NEXT
+
+  return rc;
+}
+
+int
+sop_context_group(sop_context_t *ctx, const sop_record_t *record) {
+  sop_parser_group_t *group = &ctx->group;
+  size_t count = 0;
+  int rc = SOP_EOK;
+
+  switch (record->type) {
+    case SOP_DIRECTIVE_VERTEX: group->vertices.count++; break;
+    case SOP_DIRECTIVE_VERTEX_TEXTURE: group->textures.count++; break;
+    case SOP_DIRECTIVE_VERTEX_NORMAL: group->normals.count++; break;
+
+    case SOP_DIRECTIVE_FACE:
+      count = record->value.face.count;
+      if (ctx->parser->options->triangulate && count > 3) {
+        group->faces.count += count - 2;
+        group->corners.count += 3 * (count - 2);
+      } else {
+        group->faces.count++;
+        group->corners.count += count;
+      }
+      break;
+
+    case SOP_DIRECTIVE_OBJECT:
+      rc = sop_group_complete(ctx);
+      if (SOP_EOK == rc) {
+        rc = sop_group_name(ctx->allocator, &ctx->object, &ctx->objectcap,
+                            record->span, record->length);
+      }
+      if (SOP_EOK == rc) {
+        // an object starts without a group
+        rc = sop_group_name(ctx->allocator,
+                            &ctx->groupname, &ctx->groupcap, "", 0);
+      }
+      group->object = ctx->object;
+      group->name = ctx->groupname;
+      group->lineno = record->lineno;
+      break;
+
+    case SOP_DIRECTIVE_GROUP:
+      rc = sop_group_complete(ctx);
+      if (SOP_EOK == rc) {
+        rc = sop_group_name(ctx->allocator,
+                            &ctx->groupname, &ctx->groupcap,
+                            record->span, record->length);
+      }
+      group->name = ctx->groupname;
+      group->lineno = record->lineno;
+      break;
+
+    default:
+      break;
+  }
+
+  return rc;
+}
+
+int
+sop_context_finish(sop_context_t *ctx) {
+  int rc = sop_context_flush(ctx);
+  if (SOP_EOK == rc && ctx->parser->callbacks.on_group_complete) {
+    rc = sop_group_complete(ctx);
+  }
+  if (SOP_EOK == rc) {
+    rc = sop_context_mtllib_finish(ctx);
+  }
+  return rc;
+}
@@ -0,0 +1,549 @@
+#ifndef LIBSOP_INTERNAL_H
+#define LIBSOP_INTERNAL_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sop/sop.h>
+
+/**
+ * Memory owned by the library goes through these, `allocator` may be 0
+ * for malloc(), realloc() and free().
+ */
+
+static inline void *
+sop_alloc(const sop_allocator_t *allocator, size_t size) {
+  return allocator
+    ? allocator->allocate(allocator->data, size)
+    : malloc(size);
+}
+
+static inline void *
+sop_realloc(const sop_allocator_t *allocator, void *ptr, size_t size) {
+  return allocator
+    ? allocator->reallocate(allocator->data, ptr, size)
+    : realloc(ptr, size);
+}
+
+static inline void *
+sop_calloc(const sop_allocator_t *allocator, size_t count, size_t size) {
+  void *ptr = 0;
+  if (!allocator) {
+    return calloc(count, size);
+  }
+
+  ptr = allocator->allocate(allocator->data, count * size);
+  if (ptr) {
+    memset(ptr, 0, count * size);
+  }
+  return ptr;
+}
+
+static inline void
+sop_free(const sop_allocator_t *allocator, void *ptr) {
+  if (allocator) {
+    allocator->deallocate(allocator->data, ptr);
+  } else {
+    free(ptr);
+  }
+}
+
+/**
+ * Parse statistics are collected only by SOP_STATS builds, elsewhere
+ * every use of them is constant folded away.
+ */
+
+#ifdef SOP_STATS
+#define SOP_STATS_ENABLED 1
+#else
+#define SOP_STATS_ENABLED 0
+#endif
+
+/**
+ * Number of bytes classified by a single block scan.
+ */
+
+#define SOP_SCAN_BLOCK 64
+
+/**
+ * Classifies SOP_SCAN_BLOCK bytes at `source` and returns a bit mask
+ * with bit `i` set when `source[i]` belongs to the scanned class.
+ */
+
+typedef uint64_t (* sop_scan_block_fn) (const char *source);
+
+/**
+ * Newline block scanner resolved at runtime for the running CPU (AVX2,
+ * SSE2 or a portable SWAR fallback). Threads may resolve it at the same
+ * time so it is only accessed atomically.
+ */
+
+extern sop_scan_block_fn sop_scan_newlines_fn;
+
+static inline uint64_t
+sop_scan_newlines(const char *source) {
+  return __atomic_load_n(&sop_scan_newlines_fn, __ATOMIC_RELAXED)(source);
+}
+
+/**
+ * Scalar newline scan of the final (less than SOP_SCAN_BLOCK) bytes of
+ * a source. Never reads past `length`.
+ */
+
+uint64_t
+sop_scan_newlines_tail(const char *source, size_t length);
+
+/**
+ * Line iterator over a source buffer. Newlines are located a block at
+ * a time and kept as a bit mask so that consecutive short lines cost a
+ * single bit scan each.
+ */
+
+typedef struct sop_scanner sop_scanner_t;
+struct sop_scanner {
+  // source being scanned
+  const char *source;
+
+  // source length
+  size_t length;
+
+  // start of the next line
+  size_t offset;
+
+  // offset of the block `mask` describes
+  size_t block;
+
+  // unconsumed newline bits of the current block
+  uint64_t mask;
+};
+
+static inline void
+sop_scanner_init(sop_scanner_t *scanner,
+                 const char *source,
+                 size_t length) {
+  scanner->source = source;
+  scanner->length = length;
+  scanner->offset = 0;
+  scanner->block = 0;
+  scanner->mask = length >= SOP_SCAN_BLOCK
+    ? sop_scan_newlines(source)
+    : sop_scan_newlines_tail(source, length);
+}
+
+/**
+ * Yields the next line (without its newline) in `line` and `size`.
+ * Returns 0 when the source is exhausted. The final line does not
+ * need to be newline terminated.
+ */
+
+static inline int
+sop_scanner_next(sop_scanner_t *scanner,
+                 const char **line,
+                 size_t *size) {
+  size_t start = scanner->offset;
+  if (start >= scanner->length) {
+    return 0;
+  }
+
+  while (0 == scanner->mask) {
+    size_t block = scanner->block + SOP_SCAN_BLOCK;
+    size_t remaining = 0;
+    if (block >= scanner->length) {
+      // unterminated final line
+      *line = scanner->source + start;
+      *size = scanner->length - start;
+      scanner->offset = scanner->length;
+      return 1;
+    }
+
+    remaining = scanner->length - block;
+    scanner->block = block;
+    scanner->mask = remaining >= SOP_SCAN_BLOCK
+      ? sop_scan_newlines(scanner->source + block)
+      : sop_scan_newlines_tail(scanner->source + block, remaining);
+  }
+
+  {
+    size_t end = scanner->block + (size_t) __builtin_ctzll(scanner->mask);
+    scanner->mask &= scanner->mask - 1;
+    *line = scanner->source + start;
+    *size = end - start;
+    scanner->offset = end + 1;
+  }
+
+  return 1;
+}
+
+/**
+ * Size of the source chunk decoded by a single worker thread at a time
+ * when parsing in parallel.
+ */
+
+#ifndef SOP_PARSER_CHUNK_SIZE
+#define SOP_PARSER_CHUNK_SIZE (256 * 1024)
+#endif
+
+/**
+ * Growable storage for the (v, vt, vn) face corners of decoded records.
+ */
+
+typedef struct sop_corners sop_corners_t;
+struct sop_corners {
+  int (*data)[3];
+  size_t count;
+  size_t capacity;
+
+  // memory hooks of `data`
+  const sop_allocator_t *allocator;
+};
+
+/**
+ * A decoded line. Decoding does not touch parser state so records can
+ * be produced on any thread and dispatched to callbacks later.
+ */
+
+typedef struct sop_record sop_record_t;
+struct sop_record {
+  // the directive type
+  sop_enum_t type;
+
+  // line directive
+  char *directive;
+
+  // line number of the source
+  size_t lineno;
+
+  // line data after directive in the source
+  const char *span;
+
+  // line data length after directive
+  size_t length;
+
+  // decoded line data
+  union {
+    float floats[4];
+    struct {
+      // corners live in the sop_corners_t the record was decoded with
+      size_t offset;
+      size_t count;
+    } face;
+    int integer;
+  } value;
+};
+
+/**
+ * Resolves the directive at the start of a (left trimmed) line. The
+ * directive type is returned and its name and length are written to
+ * `directive` and `size`.
+ */
+
+sop_enum_t
+sop_parser_directive(const char *line,
+                     size_t length,
+                     char **directive,
+                     size_t *size);
+
+/**
+ * Decodes a line (without its newline) into `record`, appending face
+ * corners to `corners`. Returns 1 for a decoded line, 0 if the line
+ * holds nothing to notify the consumer about (including directives
+ * missing from `directives`) and SOP_OOB when face corners could not
+ * be stored. `record->lineno` is left to the caller.
+ */
+
+int
+sop_parser_decode(const char *span,
+                  size_t size,
+                  uint64_t directives,
+                  sop_record_t *record,
+                  sop_corners_t *corners);
+
+/**
+ * A pending batch for one of the batch callbacks.
+ */
+
+typedef struct sop_batch_buffer sop_batch_buffer_t;
+struct sop_batch_buffer {
+  // batch handed to the consumer
+  sop_parser_batch_t batch;
+
+  // element capacity of `batch.data`
+  size_t capacity;
+
+  // faces only: corners used in and capacity of `batch.data`
+  size_t corners;
+  size_t cornercap;
+
+  // faces only: storage for `batch.offsets`
+  size_t *offsets;
+};
+
+/**
+ * Batch slots in sop_context.batches. Vertex attributes come first so
+ * flushing in slot order delivers them before the faces using them.
+ */
+
+enum {
+  SOP_BATCH_VERTEX = 0,
+  SOP_BATCH_TEXTURE,
+  SOP_BATCH_NORMAL,
+  SOP_BATCH_FACE,
+  SOP_BATCH_MAX
+};
+
+/**
+ * Dispatch state of a single parser execution. It owns the state and
+ * line state handed to callbacks and the pending batches.
+ */
+
+typedef struct sop_context sop_context_t;
+struct sop_context {
+  // parser being executed
+  sop_parser_t *parser;
+
+  // memory hooks of the parser
+  const sop_allocator_t *allocator;
+
+  // callback state, `state.line` points to `line`
+  sop_parser_state_t state;
+  sop_parser_line_state_t line;
+
+  // pending batches and a bit mask of the non empty ones
+  sop_batch_buffer_t batches[SOP_BATCH_MAX];
+  int pending;
+
+  // maximum elements per batch
+  size_t batchsize;
+
+  // corners of the records being dispatched and the storage records
+  // decoded on the calling thread use
+  sop_corners_t *corners;
+  sop_corners_t decoded;
+
+  // [3][n] index rows handed to on_face
+  int *faces;
+  size_t facecap;
+
+  // group being built for on_group_complete and storage for the
+  // object and group names it points to
+  sop_parser_group_t group;
+  char *object;
+  size_t objectcap;
+  char *groupname;
+  size_t groupcap;
+
+  // ids of the material in use (usemtl) and of the material being
+  // defined (newmtl), -1 when none
+  int material;
+  int defining;
+
+  // material libraries loading on a worker thread
+  struct sop_mtllib *mtllib;
+
+  // statistics being filled, 0 unless SOP_STATS_ENABLED
+  sop_parser_stats_t *stats;
+
+  // trace phases are recorded into, 0 for none
+  sop_trace_t *trace;
+};
+
+void
+sop_context_init(sop_context_t *ctx, sop_parser_t *parser);
+
+/**
+ * Appends a record to its batch, flushing the batch when full.
+ */
+
+int
+sop_context_push(sop_context_t *ctx, const sop_record_t *record);
+
+/**
+ * Delivers all pending batches.
+ */
+
+int
+sop_context_flush(sop_context_t *ctx);
+
+void
+sop_context_destroy(sop_context_t *ctx);
+
+/**
+ * Counts a dispatched record into the current group. An `o` or `g`
+ * record first completes the current group and then starts a new one.
+ */
+
+int
+sop_context_group(sop_context_t *ctx, const sop_record_t *record);
+
+/**
+ * Directives applied to the parser's material table.
+ */
+
+#define SOP_MATERIAL_DIRECTIVES                                     \
+  (SOP_DIRECTIVE_MASK(SOP_DIRECTIVE_USE_MTL) |                      \
+   SOP_DIRECTIVE_MASK(SOP_DIRECTIVE_MATERIAL_NEW) |                 \
+   SOP_DIRECTIVE_MASK(SOP_DIRECTIVE_MATERIAL_AMBIENT_COLOR) |       \
+   SOP_DIRECTIVE_MASK(SOP_DIRECTIVE_MATERIAL_DIFFUSE_COLOR) |       \
+   SOP_DIRECTIVE_MASK(SOP_DIRECTIVE_MATERIAL_SPECULAR_COLOR) |      \
+   SOP_DIRECTIVE_MASK(SOP_DIRECTIVE_MATERIAL_EMISSIVE_COLOR) |      \
+   SOP_DIRECTIVE_MASK(SOP_DIRECTIVE_MATERIAL_TRANSMISSION_FILTER) | \
+   SOP_DIRECTIVE_MASK(SOP_DIRECTIVE_MATERIAL_OPTICAL_DENSITY) |     \
+   SOP_DIRECTIVE_MASK(SOP_DIRECTIVE_MATERIAL_ILLUM) |               \
+   SOP_DIRECTIVE_MASK(SOP_DIRECTIVE_MATERIAL_SHININESS) |           \
+   SOP_DIRECTIVE_MASK(SOP_DIRECTIVE_MATERIAL_TRANSPARENCY) |        \
+   SOP_DIRECTIVE_MASK(SOP_DIRECTIVE_MATERIAL_MAP))
+
+/**
+ * Applies a usemtl, newmtl or material statement record to the
+ * parser's material table.
+ */
+
+int
+sop_context_material(sop_context_t *ctx, const sop_record_t *record);
+
+/**
+ * Queues the libraries of an mtllib record for loading on the material
+ * library worker, starting it if needed.
+ */
+
+int
+sop_context_mtllib(sop_context_t *ctx, const sop_record_t *record);
+
+/**
+ * Waits for the queued material libraries and merges their materials
+ * into the parser's material table.
+ */
+
+int
+sop_context_mtllib_finish(sop_context_t *ctx);
+
+/**
+ * Stops the material library worker, dropping libraries not loaded.
+ */
+
+void
+sop_context_mtllib_destroy(sop_context_t *ctx);
+
+/**
+ * Delivers all pending batches, completes the last group and resolves
+ * the loaded material libraries at the end of a source.
+ */
+
+int
+sop_context_finish(sop_context_t *ctx);
+
+/**
+ * Notifies the parser callbacks of a decoded record.
+ */
+
+int
+sop_parser_dispatch(sop_context_t *ctx, const sop_record_t *record);
+
+/**
+ * Decodes and dispatches every line of `source` on the calling thread.
+ * `lineno` holds the number of lines before `source` and is advanced
+ * past every line scanned.
+ */
+
+int
+sop_parser_scan(sop_context_t *ctx,
+                const char *source,
+                size_t length,
+                size_t *lineno);
+
+/**
+ * Decodes a source on worker threads and dispatches the records on the
+ * calling thread in source order.
+ */
+
+int
+sop_parser_execute_parallel(sop_parser_t *parser,
+                            const char *source,
+                            size_t length);
+
+/**
+ * Monotonic clock in nanoseconds for stats and traces.
+ */
+
+uint64_t
+sop_clock_now(void);
+
+/**
+ * Counts a scanned line into `stats`. `decoded` and `record` are what
+ * sop_parser_decode() made of the line.
+ */
+
+void
+sop_stats_line(sop_parser_stats_t *stats,
+               const char *span,
+               size_t size,
+               size_t lineno,
+               const sop_record_t *record,
+               int decoded);
+
+/**
+ * Adds the statistics of lines decoded elsewhere to `stats`. Line
+ * numbers in `from` are offset by `lineno`.
+ */
+
+void
+sop_stats_merge(sop_parser_stats_t *stats,
+                const sop_parser_stats_t *from,
+                size_t lineno);
+
+/**
+ * Starts timing a phase for sop_trace_end(), free when `trace` is 0.
+ */
+
+static inline uint64_t
+sop_trace_begin(sop_trace_t *trace) {
+  return trace ? sop_clock_now() : 0;
+}
+
+/**
+ * Records a phase of `category` named `name` (both static strings)
+ * that started at `begin` into the calling thread's buffer of `trace`.
+ * Does nothing when `trace` is 0.
+ */
+
+void
+sop_trace_end(sop_trace_t *trace,
+              const char *category,
+              const char *name,
+              uint64_t begin);
+
+/**
+ * A whole file in memory, mapped when possible.
+ */
+
+typedef struct sop_file sop_file_t;
+struct sop_file {
+  const char *data;
+  size_t length;
+
+  // set when `data` is a mapping rather than a heap copy
+  int mapped;
+};
+
+/**
+ * Maps a regular file read only, anything else is read into memory
+ * from `allocator`. The same allocator must be given to unmap it.
+ */
+
+int
+sop_file_map(const char *path,
+             const sop_allocator_t *allocator,
+             sop_file_t *file);
+
+void
+sop_file_unmap(sop_file_t *file, const sop_allocator_t *allocator);
+
+/**
+ * Unmaps the binary cache a mesh was loaded from and resets the mesh.
+ */
+
+void
+sop_cache_unmap(sop_mesh_t *mesh);
+
+#endif
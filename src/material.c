@@ -0,0 +1,307 @@
+#include <stdlib.h>
+#include <string.h>
+#include <sop/sop.h>
+#include "internal.h"
+
+/**
+ * FNV-1a hash of a material name.
+ */
+
+static uint64_t
+sop_materials_hash(const char *name, size_t length) {
+  uint64_t hash = 0xcbf29ce484222325ULL;
+  for (size_t i = 0; i < length; ++i) {
+    hash = (hash ^ (unsigned char) name[i]) * 0x100000001b3ULL;
+  }
+  return hash;
+}
+
+/**
+ * Returns the slot holding `name` or the empty slot it belongs in.
+ */
+
+static uint32_t *
+sop_materials_slot(const sop_materials_t *materials,
+                   const char *name,
+                   size_t length) {
+  const size_t mask = materials->slotcap - 1;
+  size_t slot = (size_t) sop_materials_hash(name, length) & mask;
+
+  for (;;) {
+    uint32_t *entry = &materials->slots[slot];
+    const sop_material_t *material = 0;
+    if (0 == *entry) {
+      return entry;
+    }
+
+    material = &materials->materials[*entry - 1];
+    if (material->length == length &&
+        0 == memcmp(material->name, name, length)) {
+      return entry;
+    }
+
+    slot = (slot + 1) & mask;
+  }
+}
+
+/**
+ * Keeps the name table at most half full for `count` materials.
+ */
+
+static int
+sop_materials_reserve(sop_materials_t *materials, size_t count) {
+  sop_materials_t next = *materials;
+
+  if (count > materials->capacity) {
+    size_t capacity = materials->capacity ? materials->capacity * 2 : 16;
+    sop_material_t *data = (sop_material_t *)
+      sop_realloc(materials->allocator, materials->materials,
+                  capacity * sizeof(sop_material_t));
+    if (!data) {
+      return SOP_EMEM;
+    }
+    materials->materials = next.materials = data;
+    materials->capacity = next.capacity = capacity;
+  }
+
+  if (2 * count <= materials->slotcap) {
+    return SOP_EOK;
+  }
+
+  next.slotcap = materials->slotcap ? materials->slotcap * 2 : 32;
+  next.slots = (uint32_t *)
+    sop_calloc(materials->allocator, next.slotcap, sizeof(uint32_t));
+  if (!next.slots) {
+    return SOP_EMEM;
+  }
+
+  for (size_t i = 0; i < materials->count; ++i) {
+    const sop_material_t *material = &materials->materials[i];
+    *sop_materials_slot(&next, material->name, material->length) =
+      (uint32_t) i + 1;
+  }
+
+  sop_free(materials->allocator, materials->slots);
+  materials->slots = next.slots;
+  materials->slotcap = next.slotcap;
+  return SOP_EOK;
+}
+
+int
+sop_materials_intern(sop_materials_t *materials,
+                     const char *name,
+                     size_t length) {
+  sop_material_t *material = 0;
+  uint32_t *slot = 0;
+
+  if (!materials || !name) {
+    return -1;
+  }
+
+  if (materials->slotcap) {
+    slot = sop_materials_slot(materials, name, length);
+    if (*slot) {
+      return (int) *slot - 1;
+    }
+  }
+
+  if (SOP_EOK != sop_materials_reserve(materials, materials->count + 1)) {
+    return -1;
+  }
+
+  material = &materials->materials[materials->count];
+  memset(material, 0, sizeof(sop_material_t));
+  material->name = (char *) sop_alloc(materials->allocator, length + 1);
+  if (!material->name) {
+    return -1;
+  }
+
+  memcpy(material->name, name, length);
+  material->name[length] = 0;
+  material->length = length;
+  material->ambient[3] = material->diffuse[3] = material->specular[3] = 1;
+  material->emissive[3] = material->transmission[3] = 1;
+  material->dissolve = 1;
+  material->density = 1;
+
+  *sop_materials_slot(materials, name, length) =
+    (uint32_t) materials->count + 1;
+  return (int) materials->count++;
+}
+
+int
+sop_materials_find(const sop_materials_t *materials,
+                   const char *name,
+                   size_t length) {
+  if (!materials || !name || 0 == materials->slotcap) {
+    return -1;
+  }
+  return (int) *sop_materials_slot(materials, name, length) - 1;
+}
+
+void
+sop_materials_destroy(sop_materials_t *materials) {
+  sop_allocator_t *allocator = 0;
+
+  if (!materials) {
+    return;
+  }
+
+  allocator = materials->allocator;
+  for (size_t i = 0; i < materials->count; ++i) {
+    sop_free(allocator, materials->materials[i].name);
+    for (int j = 0; j < SOP_MATERIAL_MAP_MAX; ++j) {
+      sop_free(allocator, materials->materials[i].maps[j]);
+    }
+  }
+
+  sop_free(allocator, materials->materials);
+  sop_free(allocator, materials->slots);
+  memset(materials, 0, sizeof(sop_materials_t));
+  materials->allocator = allocator;
+}
+
+/**
+ * Texture map slots by directive name.
+ */
+
+static const struct {
+  const char *directive;
+  int map;
+} sop_material_maps[] = {
+  { "map_Ka", SOP_MATERIAL_MAP_AMBIENT },
+  { "map_Kd", SOP_MATERIAL_MAP_DIFFUSE },
+  { "map_Ks", SOP_MATERIAL_MAP_SPECULAR },
+  { "map_Ke", SOP_MATERIAL_MAP_EMISSIVE },
+  { "map_Ns", SOP_MATERIAL_MAP_SHININESS },
+  { "map_d", SOP_MATERIAL_MAP_DISSOLVE },
+  { "map_Tr", SOP_MATERIAL_MAP_DISSOLVE },
+  { "map_bump", SOP_MATERIAL_MAP_BUMP },
+  { "map_Bump", SOP_MATERIAL_MAP_BUMP },
+  { "bump", SOP_MATERIAL_MAP_BUMP },
+  { "disp", SOP_MATERIAL_MAP_DISPLACEMENT },
+  { "decal", SOP_MATERIAL_MAP_DECAL },
+  { "refl", SOP_MATERIAL_MAP_REFLECTION },
+  { "norm", SOP_MATERIAL_MAP_NORMAL },
+};
+
+static int
+sop_material_map(const sop_materials_t *materials,
+                 sop_material_t *material,
+                 const sop_record_t *record) {
+  const size_t count = sizeof(sop_material_maps) / sizeof(sop_material_maps[0]);
+  char *value = 0;
+
+  for (size_t i = 0; i < count; ++i) {
+    if (0 == strcmp(sop_material_maps[i].directive, record->directive)) {
+      value = (char *) sop_alloc(materials->allocator, record->length + 1);
+      if (!value) {
+        return SOP_EMEM;
+      }
+
+      memcpy(value, record->span, record->length);
+      value[record->length] = 0;
+      sop_free(materials->allocator, material->maps[sop_material_maps[i].map]);
+      material->maps[sop_material_maps[i].map] = value;
+      break;
+    }
+  }
+
+  return SOP_EOK;
+}
+
+int
+sop_context_material(sop_context_t *ctx, const sop_record_t *record) {
+  sop_materials_t *materials = ctx->parser->options->materials;
+  sop_material_t *material = 0;
+  float value = 0;
+  int id = -1;
+
+  switch (record->type) {
+    case SOP_DIRECTIVE_USE_MTL:
+      id = sop_materials_intern(materials, record->span, record->length);
+      if (id < 0) {
+        return SOP_EMEM;
+      }
+
+      // a face batch holds faces of a single material
+      if (id != ctx->material &&
+          (ctx->pending & (1 << SOP_BATCH_FACE))) {
+        int rc = sop_context_flush(ctx);
+        if (SOP_EOK != rc) {
+          return rc;
+        }
+      }
+
+      ctx->material = id;
+      return SOP_EOK;
+
+    case SOP_DIRECTIVE_MATERIAL_NEW:
+      ctx->defining = sop_materials_intern(materials,
+                                           record->span,
+                                           record->length);
+      return ctx->defining < 0 ? SOP_EMEM : SOP_EOK;
+
+    default:
+      break;
+  }
+
+  // material statements outside of a newmtl section are ignored
+  if (ctx->defining < 0) {
+    return SOP_EOK;
+  }
+
+  material = &materials->materials[ctx->defining];
+
+  switch (record->type) {
+    case SOP_DIRECTIVE_MATERIAL_AMBIENT_COLOR:
+      memcpy(material->ambient, record->value.floats, sizeof(float[4]));
+      break;
+
+    case SOP_DIRECTIVE_MATERIAL_DIFFUSE_COLOR:
+      memcpy(material->diffuse, record->value.floats, sizeof(float[4]));
+      break;
+
+    case SOP_DIRECTIVE_MATERIAL_SPECULAR_COLOR:
+      memcpy(material->specular, record->value.floats, sizeof(float[4]));
+      break;
+
+    case SOP_DIRECTIVE_MATERIAL_EMISSIVE_COLOR:
+      memcpy(material->emissive, record->value.floats, sizeof(float[4]));
+      break;
+
+    case SOP_DIRECTIVE_MATERIAL_TRANSMISSION_FILTER:
+      memcpy(material->transmission, record->value.floats, sizeof(float[4]));
+      break;
+
+    case SOP_DIRECTIVE_MATERIAL_OPTICAL_DENSITY:
+      material->density = record->value.floats[0];
+      break;
+
+    case SOP_DIRECTIVE_MATERIAL_ILLUM:
+      material->illum = record->value.integer;
+      break;
+
+    // decoded as integers for the line callbacks, the table keeps the
+    // fractional values
+    case SOP_DIRECTIVE_MATERIAL_SHININESS:
+      if (sop_parse_floats(record->span, record->length, &value, 1)) {
+        material->shininess = value;
+      }
+      break;
+
+    case SOP_DIRECTIVE_MATERIAL_TRANSPARENCY:
+      if (sop_parse_floats(record->span, record->length, &value, 1)) {
+        material->dissolve = 'T' == record->directive[0] ? 1 - value : value;
+      }
+      break;
+
+    case SOP_DIRECTIVE_MATERIAL_MAP:
+      return sop_material_map(materials, material, record);
+
+    default:
+      break;
+  }
+
+  return SOP_EOK;
+}
@@ -0,0 +1,921 @@
+#include <limits.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <sop/sop.h>
+#include "internal.h"
+
+/**
+ * Initial element capacity of mesh arrays.
+ */
+
+#define SOP_MESH_INITIAL_CAPACITY 1024
+
+/**
+ * Marks an unused slot of the weld table.
+ */
+
+#define SOP_MESH_WELD_EMPTY UINT32_MAX
+
+/**
+ * A slot of the weld table. The corner is stored inline so a probe
+ * touches a single cache line.
+ */
+
+typedef struct sop_mesh_weld_entry sop_mesh_weld_entry_t;
+struct sop_mesh_weld_entry {
+  // resolved (v, vt, vn) corner
+  int corner[3];
+
+  // welded vertex index or SOP_MESH_WELD_EMPTY
+  uint32_t index;
+};
+
+/**
+ * Open addressing (linear probing) table of the welded corners. Slot
+ * `capacity` is a power of two and the table is kept at most half full.
+ */
+
+struct sop_mesh_weld_table {
+  sop_mesh_weld_entry_t *entries;
+  size_t capacity;
+
+  // set once any corner references a texcoord or a normal
+  int texcoords;
+  int normals;
+};
+
+/**
+ * Load state threaded through the parser callbacks.
+ */
+
+typedef struct sop_mesh_loader sop_mesh_loader_t;
+struct sop_mesh_loader {
+  sop_mesh_t *mesh;
+
+  // attribute counts before this load, positive OBJ
+  // indices are relative to these
+  size_t positions;
+  size_t texcoords;
+  size_t normals;
+
+  // per face scratch space: resolved corners, projected positions,
+  // corners left to clip and clipped triangles
+  int (*corners)[3];
+  float (*points)[2];
+  size_t *remaining;
+  size_t *triangles;
+  size_t scratch;
+};
+
+/**
+ * Returns the capacity to grow to for holding `count` elements.
+ */
+
+static size_t
+sop_mesh_grow(size_t capacity, size_t count) {
+  size_t next = capacity ? capacity : SOP_MESH_INITIAL_CAPACITY;
+  while (next < count) {
+    next *= 2;
+  }
+  return next;
+}
+
+/**
+ * Memory hooks of a mesh.
+ */
+
+static inline const sop_allocator_t *
+sop_mesh_allocator(const sop_mesh_t *mesh) {
+  return mesh->options ? mesh->options->allocator : 0;
+}
+
+/**
+ * Reallocates `*array` to hold exactly `count` elements of `size` bytes.
+ * The array is left untouched on failure.
+ */
+
+static int
+sop_mesh_resize(const sop_mesh_t *mesh,
+                void **array,
+                size_t count,
+                size_t size) {
+  void *ptr = 0;
+
+  if (0 == count) {
+    sop_free(sop_mesh_allocator(mesh), *array);
+    *array = 0;
+    return SOP_EOK;
+  }
+
+  ptr = sop_realloc(sop_mesh_allocator(mesh), *array, count * size);
+  if (!ptr) {
+    return SOP_EMEM;
+  }
+
+  *array = ptr;
+  return SOP_EOK;
+}
+
+/**
+ * Grows an attribute array to hold at least `count` elements. Arrays
+ * provided by the caller can't grow.
+ */
+
+static int
+sop_mesh_reserve(const sop_mesh_t *mesh,
+                 float **array,
+                 size_t *capacity,
+                 size_t count,
+                 size_t width) {
+  size_t next = 0;
+
+  if (count <= *capacity) {
+    return SOP_EOK;
+  } else if (mesh->external) {
+    return SOP_OOB;
+  }
+
+  next = sop_mesh_grow(*capacity, count);
+  if (SOP_EOK != sop_mesh_resize(mesh, (void **) array, next,
+                                 width * sizeof(float))) {
+    return SOP_EMEM;
+  }
+
+  *capacity = next;
+  return SOP_EOK;
+}
+
+/**
+ * Grows the index arrays, which share a capacity, to hold at least
+ * `count` corners.
+ */
+
+static int
+sop_mesh_reserve_indices(sop_mesh_t *mesh, size_t count) {
+  size_t next = 0;
+
+  if (count <= mesh->capacity.indices) {
+    return SOP_EOK;
+  } else if (mesh->external) {
+    return SOP_OOB;
+  }
+
+  next = sop_mesh_grow(mesh->capacity.indices, count);
+  if (SOP_EOK != sop_mesh_resize(mesh, (void **) &mesh->position_indices,
+                                 next, sizeof(int)) ||
+      SOP_EOK != sop_mesh_resize(mesh, (void **) &mesh->texcoord_indices,
+                                 next, sizeof(int)) ||
+      SOP_EOK != sop_mesh_resize(mesh, (void **) &mesh->normal_indices,
+                                 next, sizeof(int)) ||
+      (mesh->weld.table &&
+       SOP_EOK != sop_mesh_resize(mesh, &mesh->weld.indices,
+                                  next, sizeof(uint32_t)))) {
+    // arrays that did grow are only larger than needed
+    return SOP_EMEM;
+  }
+
+  mesh->capacity.indices = next;
+  return SOP_EOK;
+}
+
+/**
+ * Grows the face offsets to hold at least `count` faces.
+ */
+
+static int
+sop_mesh_reserve_faces(sop_mesh_t *mesh, size_t count) {
+  size_t next = 0;
+
+  if (count + 1 <= mesh->capacity.faces) {
+    return SOP_EOK;
+  } else if (mesh->external) {
+    return SOP_OOB;
+  }
+
+  next = sop_mesh_grow(mesh->capacity.faces, count + 1);
+  if (SOP_EOK != sop_mesh_resize(mesh, (void **) &mesh->face_offsets,
+                                 next, sizeof(size_t))) {
+    return SOP_EMEM;
+  }
+
+  if (0 == mesh->capacity.faces) {
+    mesh->face_offsets[0] = 0;
+  }
+
+  mesh->capacity.faces = next;
+  return SOP_EOK;
+}
+
+/**
+ * Grows the loader scratch space to hold a face of `count` corners.
+ */
+
+static int
+sop_mesh_reserve_scratch(sop_mesh_loader_t *loader, size_t count) {
+  const sop_mesh_t *mesh = loader->mesh;
+  size_t next = 0;
+
+  if (count <= loader->scratch) {
+    return SOP_EOK;
+  }
+
+  next = sop_mesh_grow(loader->scratch, count);
+  if (SOP_EOK != sop_mesh_resize(mesh, (void **) &loader->corners,
+                                 next, 3 * sizeof(int)) ||
+      SOP_EOK != sop_mesh_resize(mesh, (void **) &loader->points,
+                                 next, 2 * sizeof(float)) ||
+      SOP_EOK != sop_mesh_resize(mesh, (void **) &loader->remaining,
+                                 next, sizeof(size_t)) ||
+      SOP_EOK != sop_mesh_resize(mesh, (void **) &loader->triangles,
+                                 3 * next, sizeof(size_t))) {
+    return SOP_EMEM;
+  }
+
+  loader->scratch = next;
+  return SOP_EOK;
+}
+
+/**
+ * Shrinks all arrays to fit their contents. A failed shrink leaves the
+ * larger allocation in place.
+ */
+
+static void
+sop_mesh_shrink(sop_mesh_t *mesh) {
+  if (mesh->external) {
+    return;
+  }
+
+#define SHRINK(array, count, capacity, size) {                            \
+  if (count != capacity &&                                                \
+      SOP_EOK == sop_mesh_resize(mesh, (void **) &array, count, size)) {  \
+    capacity = count;                                                     \
+  }                                                                       \
+}
+  SHRINK(mesh->positions, mesh->position_count,
+         mesh->capacity.positions, 3 * sizeof(float));
+  SHRINK(mesh->texcoords, mesh->texcoord_count,
+         mesh->capacity.texcoords, 2 * sizeof(float));
+  SHRINK(mesh->normals, mesh->normal_count,
+         mesh->capacity.normals, 3 * sizeof(float));
+  if (mesh->face_offsets) {
+    SHRINK(mesh->face_offsets, mesh->face_count + 1,
+           mesh->capacity.faces, sizeof(size_t));
+  }
+#undef SHRINK
+
+  if (mesh->index_count != mesh->capacity.indices &&
+      SOP_EOK == sop_mesh_resize(mesh, (void **) &mesh->position_indices,
+                                 mesh->index_count, sizeof(int)) &&
+      SOP_EOK == sop_mesh_resize(mesh, (void **) &mesh->texcoord_indices,
+                                 mesh->index_count, sizeof(int)) &&
+      SOP_EOK == sop_mesh_resize(mesh, (void **) &mesh->normal_indices,
+                                 mesh->index_count, sizeof(int)) &&
+      (!mesh->weld.table ||
+       SOP_EOK == sop_mesh_resize(mesh, &mesh->weld.indices,
+                                  mesh->index_count,
+                                  mesh->weld.index_size))) {
+    mesh->capacity.indices = mesh->index_count;
+  }
+}
+
+static uint32_t
+sop_mesh_weld_hash(const int corner[3]) {
+  uint64_t hash = (uint32_t) corner[0] * 0x9e3779b97f4a7c15ULL;
+  hash ^= (uint32_t) corner[1] * 0xc2b2ae3d27d4eb4fULL;
+  hash ^= (uint32_t) corner[2] * 0x165667b19e3779f9ULL;
+  return (uint32_t) (hash ^ (hash >> 32));
+}
+
+/**
+ * Returns the slot holding `corner` or the empty slot it belongs in.
+ */
+
+static sop_mesh_weld_entry_t *
+sop_mesh_weld_find(const struct sop_mesh_weld_table *table,
+                   const int corner[3]) {
+  const size_t mask = table->capacity - 1;
+  size_t slot = sop_mesh_weld_hash(corner) & mask;
+
+  for (;; slot = (slot + 1) & mask) {
+    sop_mesh_weld_entry_t *entry = &table->entries[slot];
+    if (SOP_MESH_WELD_EMPTY == entry->index ||
+        (entry->corner[0] == corner[0] &&
+         entry->corner[1] == corner[1] &&
+         entry->corner[2] == corner[2])) {
+      return entry;
+    }
+  }
+}
+
+/**
+ * Grows the weld table to hold `count` corners at most half full.
+ */
+
+static int
+sop_mesh_weld_reserve(const sop_mesh_t *mesh,
+                      struct sop_mesh_weld_table *table,
+                      size_t count) {
+  struct sop_mesh_weld_table next = *table;
+
+  if (2 * count <= table->capacity) {
+    return SOP_EOK;
+  }
+
+  next.capacity = sop_mesh_grow(table->capacity, 2 * count);
+  next.entries = (sop_mesh_weld_entry_t *)
+    sop_alloc(sop_mesh_allocator(mesh),
+              next.capacity * sizeof(sop_mesh_weld_entry_t));
+  if (!next.entries) {
+    return SOP_EMEM;
+  }
+
+  // all bits set marks every slot empty
+  memset(next.entries, 0xff, next.capacity * sizeof(sop_mesh_weld_entry_t));
+  for (size_t i = 0; i < table->capacity; ++i) {
+    if (SOP_MESH_WELD_EMPTY != table->entries[i].index) {
+      *sop_mesh_weld_find(&next, table->entries[i].corner) =
+        table->entries[i];
+    }
+  }
+
+  sop_free(sop_mesh_allocator(mesh), table->entries);
+  *table = next;
+  return SOP_EOK;
+}
+
+/**
+ * Returns the welded vertex index of a resolved corner in `index`,
+ * adding a vertex for corners not seen before.
+ */
+
+static int
+sop_mesh_weld(sop_mesh_t *mesh, const int corner[3], uint32_t *index) {
+  struct sop_mesh_weld_table *table = mesh->weld.table;
+  sop_mesh_weld_entry_t *entry = 0;
+
+  if (mesh->weld.vertex_count >= SOP_MESH_WELD_EMPTY) {
+    return SOP_EMEM;
+  }
+
+  if (SOP_EOK != sop_mesh_weld_reserve(mesh, table,
+                                         mesh->weld.vertex_count + 1)) {
+    return SOP_EMEM;
+  }
+
+  entry = sop_mesh_weld_find(table, corner);
+  if (SOP_MESH_WELD_EMPTY == entry->index) {
+    memcpy(entry->corner, corner, sizeof(entry->corner));
+    entry->index = (uint32_t) mesh->weld.vertex_count++;
+    table->texcoords |= corner[1] >= 0;
+    table->normals |= corner[2] >= 0;
+  }
+
+  *index = entry->index;
+  return SOP_EOK;
+}
+
+/**
+ * Prepares welding for a load. Indices are collected 32 bit wide while
+ * loading so a 16 bit buffer from an earlier load is widened again.
+ */
+
+static int
+sop_mesh_weld_begin(sop_mesh_t *mesh) {
+  if (!mesh->weld.table) {
+    // faces loaded without welding have no vertices to refer to
+    if (mesh->index_count > 0) {
+      return SOP_EINVALID_OPTIONS;
+    }
+
+    mesh->weld.table = (struct sop_mesh_weld_table *)
+      sop_calloc(sop_mesh_allocator(mesh),
+                 1, sizeof(struct sop_mesh_weld_table));
+    if (!mesh->weld.table) {
+      return SOP_EMEM;
+    }
+  }
+
+  if (SOP_EOK != sop_mesh_resize(mesh, &mesh->weld.indices,
+                                 mesh->capacity.indices,
+                                 sizeof(uint32_t))) {
+    return SOP_EMEM;
+  }
+
+  if (sizeof(uint16_t) == mesh->weld.index_size) {
+    // back to front as the wide indices overlap the narrow ones
+    const uint16_t *narrow = (const uint16_t *) mesh->weld.indices;
+    uint32_t *wide = (uint32_t *) mesh->weld.indices;
+    for (size_t i = mesh->index_count; i > 0; --i) {
+      wide[i - 1] = narrow[i - 1];
+    }
+  }
+
+  mesh->weld.index_size = sizeof(uint32_t);
+  return SOP_EOK;
+}
+
+/**
+ * Lays out the interleaved vertex buffer from the weld table and
+ * narrows the indices to 16 bit when every vertex fits.
+ */
+
+static int
+sop_mesh_weld_end(sop_mesh_t *mesh) {
+  const struct sop_mesh_weld_table *table = mesh->weld.table;
+  size_t stride = 3;
+  float *vertices = 0;
+
+  mesh->weld.texcoord_offset = -1;
+  mesh->weld.normal_offset = -1;
+  if (table->texcoords) {
+    mesh->weld.texcoord_offset = (int) stride;
+    stride += 2;
+  }
+  if (table->normals) {
+    mesh->weld.normal_offset = (int) stride;
+    stride += 3;
+  }
+
+  if (SOP_EOK != sop_mesh_resize(mesh, (void **) &mesh->weld.vertices,
+                                 mesh->weld.vertex_count,
+                                 stride * sizeof(float))) {
+    return SOP_EMEM;
+  }
+
+  mesh->weld.stride = stride;
+  vertices = mesh->weld.vertices;
+  for (size_t i = 0; i < table->capacity; ++i) {
+    const sop_mesh_weld_entry_t *entry = &table->entries[i];
+    float *vertex = 0;
+
+    if (SOP_MESH_WELD_EMPTY == entry->index) {
+      continue;
+    }
+
+    vertex = vertices + stride * entry->index;
+    memcpy(vertex, mesh->positions + 3 * entry->corner[0],
+           3 * sizeof(float));
+
+    if (table->texcoords) {
+      float *texcoord = vertex + mesh->weld.texcoord_offset;
+      if (entry->corner[1] >= 0) {
+        memcpy(texcoord, mesh->texcoords + 2 * entry->corner[1],
+               2 * sizeof(float));
+      } else {
+        memset(texcoord, 0, 2 * sizeof(float));
+      }
+    }
+
+    if (table->normals) {
+      float *normal = vertex + mesh->weld.normal_offset;
+      if (entry->corner[2] >= 0) {
+        memcpy(normal, mesh->normals + 3 * entry->corner[2],
+               3 * sizeof(float));
+      } else {
+        memset(normal, 0, 3 * sizeof(float));
+      }
+    }
+  }
+
+  if (mesh->weld.vertex_count < UINT16_MAX) {
+    const uint32_t *wide = (const uint32_t *) mesh->weld.indices;
+    uint16_t *narrow = (uint16_t *) mesh->weld.indices;
+    for (size_t i = 0; i < mesh->index_count; ++i) {
+      narrow[i] = (uint16_t) wide[i];
+    }
+    mesh->weld.index_size = sizeof(uint16_t);
+  }
+
+  return SOP_EOK;
+}
+
+/**
+ * Resolves an OBJ index (1 based from `base` or negative relative to
+ * `count`) to a 0 based offset. Returns -1 for absent (0) indices and
+ * -2 for indices outside of the `count` elements loaded so far or past
+ * what an int offset can hold.
+ */
+
+static int
+sop_mesh_index(int index, size_t base, size_t count) {
+  size_t offset = 0;
+  if (index > 0) {
+    if ((size_t) index > count - base) { return -2; }
+    offset = base + (size_t) index - 1;
+  } else if (index < 0) {
+    const size_t distance = (size_t) -(index + 1) + 1;
+    if (distance > count) { return -2; }
+    offset = count - distance;
+  } else {
+    return -1;
+  }
+  return offset <= INT_MAX ? (int) offset : -2;
+}
+
+static int
+on_vertices(const sop_parser_state_t *state,
+            const sop_parser_batch_t *batch) {
+  sop_mesh_loader_t *loader = (sop_mesh_loader_t *) state->data;
+  sop_mesh_t *mesh = loader->mesh;
+  const float (*data)[4] = (const float (*)[4]) batch->data;
+  float *positions = 0;
+  int rc = SOP_EOK;
+
+  rc = sop_mesh_reserve(mesh,
+                        &mesh->positions,
+                        &mesh->capacity.positions,
+                        mesh->position_count + batch->count,
+                        3);
+  if (SOP_EOK != rc) {
+    return rc;
+  }
+
+  positions = mesh->positions + 3 * mesh->position_count;
+  for (size_t i = 0; i < batch->count; ++i) {
+    memcpy(positions + 3 * i, data[i], 3 * sizeof(float));
+  }
+
+  mesh->position_count += batch->count;
+  return SOP_EOK;
+}
+
+static int
+on_textures(const sop_parser_state_t *state,
+            const sop_parser_batch_t *batch) {
+  sop_mesh_loader_t *loader = (sop_mesh_loader_t *) state->data;
+  sop_mesh_t *mesh = loader->mesh;
+  const float (*data)[4] = (const float (*)[4]) batch->data;
+  float *texcoords = 0;
+  int rc = SOP_EOK;
+
+  rc = sop_mesh_reserve(mesh,
+                        &mesh->texcoords,
+                        &mesh->capacity.texcoords,
+                        mesh->texcoord_count + batch->count,
+                        2);
+  if (SOP_EOK != rc) {
+    return rc;
+  }
+
+  texcoords = mesh->texcoords + 2 * mesh->texcoord_count;
+  for (size_t i = 0; i < batch->count; ++i) {
+    memcpy(texcoords + 2 * i, data[i], 2 * sizeof(float));
+  }
+
+  mesh->texcoord_count += batch->count;
+  return SOP_EOK;
+}
+
+static int
+on_normals(const sop_parser_state_t *state,
+           const sop_parser_batch_t *batch) {
+  sop_mesh_loader_t *loader = (sop_mesh_loader_t *) state->data;
+  sop_mesh_t *mesh = loader->mesh;
+  const float (*data)[4] = (const float (*)[4]) batch->data;
+  float *normals = 0;
+  int rc = SOP_EOK;
+
+  rc = sop_mesh_reserve(mesh,
+                        &mesh->normals,
+                        &mesh->capacity.normals,
+                        mesh->normal_count + batch->count,
+                        3);
+  if (SOP_EOK != rc) {
+    return rc;
+  }
+
+  normals = mesh->normals + 3 * mesh->normal_count;
+  for (size_t i = 0; i < batch->count; ++i) {
+    memcpy(normals + 3 * i, data[i], 3 * sizeof(float));
+  }
+
+  mesh->normal_count += batch->count;
+  return SOP_EOK;
+}
+
+/**
+ * Twice the signed area of the 2D triangle (a, b, c).
+ */
+
+static float
+sop_mesh_area2(const float a[2], const float b[2], const float c[2]) {
+  return (b[0] - a[0]) * (c[1] - a[1]) - (b[1] - a[1]) * (c[0] - a[0]);
+}
+
+/**
+ * Ear clips a face of `count` resolved corners in `loader->corners`
+ * into `count - 2` triangles of corner offsets in `loader->triangles`.
+ * The face is projected onto the axis plane its Newell normal is most
+ * aligned with. Whatever is left when no ear can be found (degenerate
+ * or self intersecting faces) is fanned.
+ */
+
+static void
+sop_mesh_ear_clip(const sop_mesh_t *mesh,
+                  sop_mesh_loader_t *loader,
+                  size_t count) {
+  const int (*corners)[3] = (const int (*)[3]) loader->corners;
+  float (*points)[2] = loader->points;
+  size_t *remaining = loader->remaining;
+  size_t *triangles = loader->triangles;
+  float normal[3] = { 0, 0, 0 };
+  float orientation = 1;
+  size_t u = 1;
+  size_t v = 2;
+  size_t left = count;
+  size_t start = 0;
+
+  for (size_t i = 0; i < count; ++i) {
+    const float *a = mesh->positions + 3 * corners[i][0];
+    const float *b = mesh->positions + 3 * corners[(i + 1) % count][0];
+    normal[0] += (a[1] - b[1]) * (a[2] + b[2]);
+    normal[1] += (a[2] - b[2]) * (a[0] + b[0]);
+    normal[2] += (a[0] - b[0]) * (a[1] + b[1]);
+  }
+
+  // drop the dominant axis, (u, v) keep their cyclic order
+  if (fabsf(normal[0]) >= fabsf(normal[1]) &&
+      fabsf(normal[0]) >= fabsf(normal[2])) {
+    u = 1; v = 2;
+    orientation = normal[0] < 0 ? -1 : 1;
+  } else if (fabsf(normal[1]) >= fabsf(normal[2])) {
+    u = 2; v = 0;
+    orientation = normal[1] < 0 ? -1 : 1;
+  } else {
+    u = 0; v = 1;
+    orientation = normal[2] < 0 ? -1 : 1;
+  }
+
+  for (size_t i = 0; i < count; ++i) {
+    const float *position = mesh->positions + 3 * corners[i][0];
+    points[i][0] = position[u];
+    points[i][1] = orientation * position[v];
+    remaining[i] = i;
+  }
+
+  while (left > 3) {
+    int clipped = 0;
+
+    for (size_t step = 0; step < left && !clipped; ++step) {
+      const size_t k = (start + step) % left;
+      const size_t a = remaining[(k + left - 1) % left];
+      const size_t b = remaining[k];
+      const size_t c = remaining[(k + 1) % left];
+      int ear = sop_mesh_area2(points[a], points[b], points[c]) > 0;
+
+      // no other corner may lie inside or on the ear
+      for (size_t j = 0; j < left && ear; ++j) {
+        const float *p = points[remaining[j]];
+        if (remaining[j] == a || remaining[j] == b || remaining[j] == c ||
+            corners[remaining[j]][0] == corners[a][0] ||
+            corners[remaining[j]][0] == corners[b][0] ||
+            corners[remaining[j]][0] == corners[c][0]) {
+          continue;
+        }
+        ear = !(sop_mesh_area2(points[a], points[b], p) >= 0 &&
+                sop_mesh_area2(points[b], points[c], p) >= 0 &&
+                sop_mesh_area2(points[c], points[a], p) >= 0);
+      }
+
+      if (ear) {
+        *triangles++ = a;
+        *triangles++ = b;
+        *triangles++ = c;
+        memmove(remaining + k, remaining + k + 1,
+                (left - k - 1) * sizeof(size_t));
+        left--;
+        start = k;
+        clipped = 1;
+      }
+    }
+
+    if (!clipped) {
+      break;
+    }
+  }
+
+  for (size_t k = 1; k + 1 < left; ++k) {
+    *triangles++ = remaining[0];
+    *triangles++ = remaining[k];
+    *triangles++ = remaining[k + 1];
+  }
+}
+
+/**
+ * Appends a resolved corner to the index arrays.
+ */
+
+static int
+sop_mesh_push_corner(sop_mesh_t *mesh, const int corner[3]) {
+  if (mesh->weld.table) {
+    uint32_t *indices = (uint32_t *) mesh->weld.indices;
+    if (SOP_EOK != sop_mesh_weld(mesh, corner,
+                                 &indices[mesh->index_count])) {
+      return SOP_EMEM;
+    }
+  }
+
+  mesh->position_indices[mesh->index_count] = corner[0];
+  mesh->texcoord_indices[mesh->index_count] = corner[1];
+  mesh->normal_indices[mesh->index_count] = corner[2];
+  mesh->index_count++;
+  return SOP_EOK;
+}
+
+static int
+on_faces(const sop_parser_state_t *state,
+         const sop_parser_batch_t *batch) {
+  sop_mesh_loader_t *loader = (sop_mesh_loader_t *) state->data;
+  sop_mesh_t *mesh = loader->mesh;
+  const int (*corners)[3] = (const int (*)[3]) batch->data;
+  const int triangulate = mesh->options && mesh->options->triangulate;
+
+  for (size_t i = 0; i < batch->count; ++i) {
+    const size_t begin = batch->offsets[i];
+    const size_t count = batch->offsets[i + 1] - begin;
+    // a face of n corners clips into n - 2 triangles
+    const size_t faces = triangulate && count > 3 ? count - 2 : 1;
+    int rc = SOP_EOK;
+
+    // points and lines are not faces
+    if (count < 3) {
+      continue;
+    }
+
+    rc = sop_mesh_reserve_indices(mesh, mesh->index_count +
+                                  (faces > 1 ? 3 * faces : count));
+    if (SOP_EOK == rc) {
+      rc = sop_mesh_reserve_faces(mesh, mesh->face_count + faces);
+    }
+
+    if (SOP_EOK != rc) {
+      return rc;
+    }
+
+    if (SOP_EOK != sop_mesh_reserve_scratch(loader, count)) {
+      return SOP_EMEM;
+    }
+
+    for (size_t j = 0; j < count; ++j) {
+      int *corner = loader->corners[j];
+      corner[0] = sop_mesh_index(corners[begin + j][0],
+                                 loader->positions,
+                                 mesh->position_count);
+      corner[1] = sop_mesh_index(corners[begin + j][1],
+                                 loader->texcoords,
+                                 mesh->texcoord_count);
+      corner[2] = sop_mesh_index(corners[begin + j][2],
+                                 loader->normals,
+                                 mesh->normal_count);
+
+      if (corner[0] < 0 || corner[1] < -1 || corner[2] < -1) {
+        return SOP_EINVALID_SOURCE;
+      }
+    }
+
+    if (triangulate && count > 3) {
+      sop_mesh_ear_clip(mesh, loader, count);
+      for (size_t t = 0; t < count - 2; ++t) {
+        for (size_t j = 0; j < 3; ++j) {
+          size_t corner = loader->triangles[3 * t + j];
+          if (SOP_EOK != sop_mesh_push_corner(mesh, loader->corners[corner])) {
+            return SOP_EMEM;
+          }
+        }
+        mesh->face_offsets[++mesh->face_count] = mesh->index_count;
+      }
+    } else {
+      for (size_t j = 0; j < count; ++j) {
+        if (SOP_EOK != sop_mesh_push_corner(mesh, loader->corners[j])) {
+          return SOP_EMEM;
+        }
+      }
+      mesh->face_offsets[++mesh->face_count] = mesh->index_count;
+    }
+  }
+
+  return SOP_EOK;
+}
+
+int
+sop_mesh_init(sop_mesh_t *mesh, sop_mesh_options_t *options) {
+  if (!mesh) { return SOP_EMEM; }
+  memset(mesh, 0, sizeof(sop_mesh_t));
+  mesh->options = options;
+  return SOP_EOK;
+}
+
+int
+sop_mesh_load(const char *source, size_t length, sop_mesh_t *mesh) {
+  sop_mesh_loader_t loader;
+  sop_parser_t parser;
+  sop_parser_options_t options;
+  sop_trace_t *trace = 0;
+  uint64_t begin = 0;
+  uint64_t stage = 0;
+  int rc = SOP_EOK;
+
+  if (!mesh) {
+    return SOP_EMEM;
+  }
+
+  trace = mesh->options ? mesh->options->trace : 0;
+  begin = sop_trace_begin(trace);
+
+  memset(&options, 0, sizeof(options));
+  options.data = &loader;
+  options.zero_copy = 1;
+  options.threads = mesh->options ? mesh->options->threads : 0;
+  options.allocator = mesh->options ? mesh->options->allocator : 0;
+  options.trace = trace;
+  options.callbacks.on_vertices = on_vertices;
+  options.callbacks.on_textures = on_textures;
+  options.callbacks.on_normals = on_normals;
+  options.callbacks.on_faces = on_faces;
+
+  // caller provided face offsets start out uninitialized
+  if (mesh->face_offsets && 0 == mesh->face_count) {
+    mesh->face_offsets[0] = 0;
+  }
+
+  loader.mesh = mesh;
+  loader.positions = mesh->position_count;
+  loader.texcoords = mesh->texcoord_count;
+  loader.normals = mesh->normal_count;
+  loader.corners = 0;
+  loader.points = 0;
+  loader.remaining = 0;
+  loader.triangles = 0;
+  loader.scratch = 0;
+
+  if ((mesh->options && mesh->options->weld) || mesh->weld.table) {
+    rc = sop_mesh_weld_begin(mesh);
+    if (SOP_EOK != rc) {
+      return rc;
+    }
+  }
+
+  rc = sop_parser_init(&parser, &options);
+  if (SOP_EOK == rc) {
+    rc = sop_parser_execute(&parser, source, length);
+  }
+
+  if (mesh->weld.table) {
+    int weldrc = SOP_EOK;
+    stage = sop_trace_begin(trace);
+    weldrc = sop_mesh_weld_end(mesh);
+    sop_trace_end(trace, "mesh", "weld", stage);
+    if (SOP_EOK == rc) {
+      rc = weldrc;
+    }
+  }
+
+  sop_free(options.allocator, loader.corners);
+  sop_free(options.allocator, loader.points);
+  sop_free(options.allocator, loader.remaining);
+  sop_free(options.allocator, loader.triangles);
+
+  stage = sop_trace_begin(trace);
+  sop_mesh_shrink(mesh);
+  sop_trace_end(trace, "mesh", "shrink", stage);
+
+  sop_trace_end(trace, "mesh", "load", begin);
+  return rc;
+}
+
+void
+sop_mesh_destroy(sop_mesh_t *mesh) {
+  sop_mesh_options_t *options = 0;
+  const sop_allocator_t *allocator = 0;
+
+  if (!mesh) {
+    return;
+  }
+
+  if (mesh->mapping) {
+    sop_cache_unmap(mesh);
+    return;
+  }
+
+  options = mesh->options;
+  allocator = sop_mesh_allocator(mesh);
+  if (!mesh->external) {
+    sop_free(allocator, mesh->positions);
+    sop_free(allocator, mesh->texcoords);
+    sop_free(allocator, mesh->normals);
+    sop_free(allocator, mesh->position_indices);
+    sop_free(allocator, mesh->texcoord_indices);
+    sop_free(allocator, mesh->normal_indices);
+    sop_free(allocator, mesh->face_offsets);
+  }
+  sop_free(allocator, mesh->weld.vertices);
+  sop_free(allocator, mesh->weld.indices);
+  if (mesh->weld.table) {
+    sop_free(allocator, mesh->weld.table->entries);
+    sop_free(allocator, mesh->weld.table);
+  }
+  (void) sop_mesh_init(mesh, options);
+}
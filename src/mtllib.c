@@ -0,0 +1,298 @@
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <sop/sop.h>
+#include "internal.h"
+
+/**
+ * Material libraries are parsed on a single worker thread into a table
+ * of their own so the calling thread can keep interning usemtl names
+ * without locking. The tables are merged once the source is done.
+ */
+
+struct sop_mtllib {
+  pthread_t thread;
+  int started;
+
+  // guards `paths`, `count`, `next` and `done`
+  pthread_mutex_t lock;
+  pthread_cond_t cond;
+
+  // library paths in mtllib order and the next one to parse
+  char **paths;
+  size_t count;
+  size_t capacity;
+  size_t next;
+
+  // set when no more libraries will be queued
+  int done;
+
+  // materials of the parsed libraries
+  sop_materials_t materials;
+
+  // memory hooks of the parser loading the libraries
+  sop_allocator_t *allocator;
+
+  // trace of the parser loading the libraries
+  sop_trace_t *trace;
+};
+
+static void *
+sop_mtllib_run(void *arg) {
+  struct sop_mtllib *mtllib = (struct sop_mtllib *) arg;
+
+  pthread_mutex_lock(&mtllib->lock);
+  for (;;) {
+    sop_parser_options_t options;
+    sop_parser_t parser;
+    const char *path = 0;
+
+    while (mtllib->next == mtllib->count && !mtllib->done) {
+      pthread_cond_wait(&mtllib->cond, &mtllib->lock);
+    }
+
+    if (mtllib->next == mtllib->count) {
+      break;
+    }
+
+    path = mtllib->paths[mtllib->next++];
+    pthread_mutex_unlock(&mtllib->lock);
+
+    memset(&options, 0, sizeof(options));
+    options.materials = &mtllib->materials;
+    options.allocator = mtllib->allocator;
+    options.trace = mtllib->trace;
+    if (SOP_EOK == sop_parser_init(&parser, &options)) {
+      uint64_t begin = sop_trace_begin(mtllib->trace);
+      // unreadable libraries are ignored
+      (void) sop_parser_execute_file(&parser, path);
+      sop_trace_end(mtllib->trace, "mtl", "mtllib", begin);
+    }
+
+    pthread_mutex_lock(&mtllib->lock);
+  }
+  pthread_mutex_unlock(&mtllib->lock);
+
+  return 0;
+}
+
+/**
+ * Resolves a library name against the base directory of the parser.
+ * Returns a heap allocated path or 0 when out of memory.
+ */
+
+static char *
+sop_mtllib_path(const sop_parser_t *parser, const char *name, size_t size) {
+  const char *base = parser->options->base;
+  size_t baselen = 0;
+  char *path = 0;
+
+  if (!base && parser->path) {
+    const char *slash = strrchr(parser->path, '/');
+    base = parser->path;
+    baselen = slash ? (size_t) (slash - parser->path) + 1 : 0;
+  } else if (base) {
+    baselen = strlen(base);
+  }
+
+  if ('/' == name[0]) {
+    baselen = 0;
+  }
+
+  path = (char *) sop_alloc(parser->options->allocator, baselen + size + 2);
+  if (!path) {
+    return 0;
+  }
+
+  if (baselen) {
+    memcpy(path, base, baselen);
+    if ('/' != base[baselen - 1]) {
+      path[baselen++] = '/';
+    }
+  }
+
+  memcpy(path + baselen, name, size);
+  path[baselen + size] = 0;
+  return path;
+}
+
+/**
+ * Queues a library unless it is queued already.
+ */
+
+static int
+sop_mtllib_queue(struct sop_mtllib *mtllib, char *path) {
+  const sop_allocator_t *allocator = mtllib->allocator;
+  int rc = SOP_EOK;
+
+  pthread_mutex_lock(&mtllib->lock);
+
+  for (size_t i = 0; i < mtllib->count; ++i) {
+    if (0 == strcmp(mtllib->paths[i], path)) {
+      pthread_mutex_unlock(&mtllib->lock);
+      sop_free(allocator, path);
+      return SOP_EOK;
+    }
+  }
+
+  if (mtllib->count == mtllib->capacity) {
+    size_t capacity = mtllib->capacity ? mtllib->capacity * 2 : 8;
+    char **paths = (char **) sop_realloc(allocator, mtllib->paths,
+                                         capacity * sizeof(char *));
+    if (!paths) {
+      rc = SOP_EMEM;
+    } else {
+      mtllib->paths = paths;
+      mtllib->capacity = capacity;
+    }
+  }
+
+  if (SOP_EOK == rc) {
+    mtllib->paths[mtllib->count++] = path;
+    pthread_cond_signal(&mtllib->cond);
+  } else {
+    sop_free(allocator, path);
+  }
+
+  pthread_mutex_unlock(&mtllib->lock);
+  return rc;
+}
+
+int
+sop_context_mtllib(sop_context_t *ctx, const sop_record_t *record) {
+  struct sop_mtllib *mtllib = ctx->mtllib;
+  const char *p = record->span;
+  const char *end = record->span + record->length;
+
+  if (!mtllib) {
+    mtllib = (struct sop_mtllib *)
+      sop_calloc(ctx->allocator, 1, sizeof(struct sop_mtllib));
+    if (!mtllib) {
+      return SOP_EMEM;
+    }
+
+    mtllib->allocator = ctx->parser->options->allocator;
+    mtllib->trace = ctx->trace;
+    mtllib->materials.allocator = ctx->parser->options->materials->allocator;
+
+    pthread_mutex_init(&mtllib->lock, 0);
+    pthread_cond_init(&mtllib->cond, 0);
+
+    // without a worker the libraries are parsed when the source is done
+    mtllib->started = 0 == pthread_create(&mtllib->thread, 0,
+                                          sop_mtllib_run, mtllib);
+    ctx->mtllib = mtllib;
+  }
+
+  // mtllib takes one or more white space separated file names
+  while (p < end) {
+    const char *name = 0;
+    char *path = 0;
+    int rc = SOP_EOK;
+
+    while (p < end && (unsigned char) *p <= ' ') { p++; }
+    name = p;
+    while (p < end && (unsigned char) *p > ' ') { p++; }
+    if (name == p) {
+      break;
+    }
+
+    path = sop_mtllib_path(ctx->parser, name, (size_t) (p - name));
+    if (!path) {
+      return SOP_EMEM;
+    }
+
+    rc = sop_mtllib_queue(mtllib, path);
+    if (SOP_EOK != rc) {
+      return rc;
+    }
+  }
+
+  return SOP_EOK;
+}
+
+/**
+ * Stops queueing and waits for the worker. Libraries not parsed yet
+ * are parsed unless `discard` is set.
+ */
+
+static void
+sop_mtllib_join(struct sop_mtllib *mtllib, int discard) {
+  pthread_mutex_lock(&mtllib->lock);
+  mtllib->done = 1;
+  if (discard) {
+    mtllib->next = mtllib->count;
+  }
+  pthread_cond_signal(&mtllib->cond);
+  pthread_mutex_unlock(&mtllib->lock);
+
+  if (mtllib->started) {
+    pthread_join(mtllib->thread, 0);
+    mtllib->started = 0;
+  } else {
+    (void) sop_mtllib_run(mtllib);
+  }
+}
+
+int
+sop_context_mtllib_finish(sop_context_t *ctx) {
+  struct sop_mtllib *mtllib = ctx->mtllib;
+  sop_materials_t *materials = ctx->parser->options->materials;
+  uint64_t begin = 0;
+
+  if (!mtllib) {
+    return SOP_EOK;
+  }
+
+  begin = sop_trace_begin(ctx->trace);
+  sop_mtllib_join(mtllib, 0);
+  sop_trace_end(ctx->trace, "mtl", "mtllib wait", begin);
+
+  // names used before their library was parsed keep their ids
+  for (size_t i = 0; i < mtllib->materials.count; ++i) {
+    sop_material_t *source = &mtllib->materials.materials[i];
+    sop_material_t *target = 0;
+    char *name = 0;
+    int id = sop_materials_intern(materials, source->name, source->length);
+    if (id < 0) {
+      return SOP_EMEM;
+    }
+
+    target = &materials->materials[id];
+    name = target->name;
+    for (int j = 0; j < SOP_MATERIAL_MAP_MAX; ++j) {
+      sop_free(materials->allocator, target->maps[j]);
+    }
+
+    *target = *source;
+    target->name = name;
+    memset(source->maps, 0, sizeof(source->maps));
+  }
+
+  sop_context_mtllib_destroy(ctx);
+  return SOP_EOK;
+}
+
+void
+sop_context_mtllib_destroy(sop_context_t *ctx) {
+  struct sop_mtllib *mtllib = ctx->mtllib;
+
+  if (!mtllib) {
+    return;
+  }
+
+  if (!mtllib->done || mtllib->started) {
+    sop_mtllib_join(mtllib, 1);
+  }
+
+  for (size_t i = 0; i < mtllib->count; ++i) {
+    sop_free(mtllib->allocator, mtllib->paths[i]);
+  }
+
+  sop_free(mtllib->allocator, mtllib->paths);
+  sop_materials_destroy(&mtllib->materials);
+  pthread_mutex_destroy(&mtllib->lock);
+  pthread_cond_destroy(&mtllib->cond);
+  sop_free(mtllib->allocator, mtllib);
+  ctx->mtllib = 0;
+}
@@ -0,0 +1,270 @@
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <sop/sop.h>
+#include "internal.h"
+
+/**
+ * Records are produced for a window of `threads` chunks at a time. While
+ * the calling thread dispatches the records of one window, the workers
+ * decode the next one, so memory stays bounded by two windows no matter
+ * how large the source is.
+ */
+
+typedef struct sop_chunk sop_chunk_t;
+struct sop_chunk {
+  // source slice starting and ending on a line boundary
+  const char *source;
+  size_t length;
+
+  // directives to decode
+  uint64_t directives;
+
+  // decoded records in source order
+  sop_record_t *records;
+  size_t capacity;
+  size_t count;
+
+  // face corners of the records
+  sop_corners_t corners;
+
+  // number of lines in the slice
+  size_t lines;
+
+  // decode status
+  int rc;
+
+  // statistics of the slice when `collect` is set
+  sop_parser_stats_t stats;
+  int collect;
+
+  // trace the decode is recorded into, 0 for none
+  sop_trace_t *trace;
+
+  // worker decoding the slice
+  pthread_t thread;
+  int joinable;
+};
+
+typedef struct sop_window sop_window_t;
+struct sop_window {
+  sop_chunk_t *chunks;
+  int count;
+};
+
+static void *
+sop_chunk_decode(void *arg) {
+  sop_chunk_t *chunk = (sop_chunk_t *) arg;
+  sop_parser_stats_t *stats = 0;
+  uint64_t begin = sop_trace_begin(chunk->trace);
+  sop_scanner_t scanner;
+  const char *span = 0;
+  size_t spansize = 0;
+
+  chunk->count = 0;
+  chunk->corners.count = 0;
+  chunk->lines = 0;
+  chunk->rc = SOP_EOK;
+
+  if (SOP_STATS_ENABLED && chunk->collect) {
+    stats = &chunk->stats;
+    memset(stats, 0, sizeof(sop_parser_stats_t));
+  }
+
+  sop_scanner_init(&scanner, chunk->source, chunk->length);
+  for (;;) {
+    const int sampled = stats && 0 == chunk->lines % SOP_STATS_SAMPLE;
+    uint64_t clock[3] = {0};
+    sop_record_t *record = 0;
+    int decoded = 0;
+
+    if (sampled) { clock[0] = sop_clock_now(); }
+    if (!sop_scanner_next(&scanner, &span, &spansize)) {
+      break;
+    }
+
+    chunk->lines++;
+    if (sampled) { clock[1] = sop_clock_now(); }
+
+    if (chunk->count == chunk->capacity) {
+      size_t capacity = chunk->capacity ? chunk->capacity * 2 : 4096;
+      sop_record_t *records = (sop_record_t *)
+        sop_realloc(chunk->corners.allocator, chunk->records,
+                    capacity * sizeof(sop_record_t));
+      if (!records) {
+        chunk->rc = SOP_EMEM;
+        break;
+      }
+      chunk->records = records;
+      chunk->capacity = capacity;
+    }
+
+    record = &chunk->records[chunk->count];
+    decoded = sop_parser_decode(span, spansize, chunk->directives,
+                                record, &chunk->corners);
+
+    if (stats) {
+      if (sampled) {
+        clock[2] = sop_clock_now();
+        stats->scan_ns += (clock[1] - clock[0]) * SOP_STATS_SAMPLE;
+        stats->decode_ns += (clock[2] - clock[1]) * SOP_STATS_SAMPLE;
+      }
+      sop_stats_line(stats, span, spansize, chunk->lines, record, decoded);
+    }
+
+    if (decoded > 0) {
+      record->lineno = chunk->lines;
+      chunk->count++;
+    } else if (decoded < 0) {
+      chunk->rc = SOP_EMEM;
+      break;
+    }
+  }
+
+  sop_trace_end(chunk->trace, "parse", "decode", begin);
+  return 0;
+}
+
+/**
+ * Splits the source at `*offset` into up to `window->count` chunks that
+ * end on a newline and starts a worker for each of them. Chunks that
+ * could not get a thread are decoded on the calling thread.
+ */
+
+static void
+sop_window_start(sop_window_t *window,
+                 int threads,
+                 const char *source,
+                 size_t length,
+                 size_t *offset) {
+  window->count = 0;
+  while (window->count < threads && *offset < length) {
+    sop_chunk_t *chunk = &window->chunks[window->count++];
+    size_t start = *offset;
+    size_t end = start + SOP_PARSER_CHUNK_SIZE;
+
+    if (end >= length) {
+      end = length;
+    } else {
+      const char *nl = (const char *) memchr(source + end - 1, '\n',
+                                             length - end + 1);
+      end = nl ? (size_t) (nl - source) + 1 : length;
+    }
+
+    chunk->source = source + start;
+    chunk->length = end - start;
+    chunk->joinable = 0 == pthread_create(&chunk->thread, 0,
+                                          sop_chunk_decode, chunk);
+    if (!chunk->joinable) {
+      (void) sop_chunk_decode(chunk);
+    }
+
+    *offset = end;
+  }
+}
+
+static void
+sop_window_join(sop_window_t *window, sop_trace_t *trace) {
+  uint64_t begin = sop_trace_begin(trace);
+  for (int i = 0; i < window->count; ++i) {
+    if (window->chunks[i].joinable) {
+      pthread_join(window->chunks[i].thread, 0);
+      window->chunks[i].joinable = 0;
+    }
+  }
+  sop_trace_end(trace, "parse", "wait", begin);
+}
+
+int
+sop_parser_execute_parallel(sop_parser_t *parser,
+                            const char *source,
+                            size_t length) {
+  const int threads = parser->options->threads;
+  const sop_allocator_t *allocator = parser->options->allocator;
+  sop_context_t ctx;
+  sop_window_t windows[2];
+  sop_window_t *current = &windows[0];
+  sop_window_t *next = &windows[1];
+  sop_chunk_t *chunks = 0;
+  size_t offset = 0;
+  size_t lineno = 0;
+  int rc = SOP_EOK;
+
+  chunks = (sop_chunk_t *)
+    sop_calloc(allocator, 2 * (size_t) threads, sizeof(sop_chunk_t));
+  if (!chunks) {
+    return SOP_EMEM;
+  }
+
+  sop_context_init(&ctx, parser);
+
+  for (int i = 0; i < 2 * threads; ++i) {
+    chunks[i].directives = parser->directives;
+    chunks[i].corners.allocator = allocator;
+    chunks[i].collect = 0 != ctx.stats;
+    chunks[i].trace = ctx.trace;
+  }
+
+  windows[0].chunks = chunks;
+  windows[0].count = 0;
+  windows[1].chunks = chunks + threads;
+  windows[1].count = 0;
+
+  sop_window_start(current, threads, source, length, &offset);
+
+  while (current->count > 0) {
+    sop_window_t *swap = 0;
+
+    sop_window_join(current, ctx.trace);
+
+    // decode ahead while the consumer handles this window
+    sop_window_start(next, threads, source, length, &offset);
+
+    for (int i = 0; i < current->count && SOP_EOK == rc; ++i) {
+      sop_chunk_t *chunk = &current->chunks[i];
+      uint64_t begin = sop_trace_begin(ctx.trace);
+      rc = chunk->rc;
+      ctx.corners = &chunk->corners;
+      for (size_t j = 0; j < chunk->count && SOP_EOK == rc; ++j) {
+        sop_record_t *record = &chunk->records[j];
+        const int sampled = SOP_STATS_ENABLED && ctx.stats &&
+                            0 == j % SOP_STATS_SAMPLE;
+        uint64_t start = sampled ? sop_clock_now() : 0;
+        record->lineno += lineno;
+        rc = sop_parser_dispatch(&ctx, record);
+        if (sampled) {
+          ctx.stats->callback_ns +=
+            (sop_clock_now() - start) * SOP_STATS_SAMPLE;
+        }
+      }
+
+      if (SOP_STATS_ENABLED && ctx.stats) {
+        sop_stats_merge(ctx.stats, &chunk->stats, lineno);
+      }
+      lineno += chunk->lines;
+      sop_trace_end(ctx.trace, "parse", "dispatch", begin);
+    }
+
+    if (SOP_EOK != rc) {
+      sop_window_join(next, ctx.trace);
+      break;
+    }
+
+    swap = current;
+    current = next;
+    next = swap;
+  }
+
+  if (SOP_EOK == rc) {
+    rc = sop_context_finish(&ctx);
+  }
+
+  for (int i = 0; i < 2 * threads; ++i) {
+    sop_free(allocator, chunks[i].records);
+    sop_free(allocator, chunks[i].corners.data);
+  }
+
+  sop_context_destroy(&ctx);
+  sop_free(allocator, chunks);
+  return rc;
+}
@@ -0,0 +1,476 @@
+#include <stdlib.h>
+#include <string.h>
+#include <sop/sop.h>
+#include "internal.h"
+
+/**
+ * State of a reader kept between sop_reader_next() calls.
+ */
+
+struct sop_reader_state {
+  const sop_allocator_t *allocator;
+
+  // source mapped by sop_reader_init_file(), if any
+  sop_file_t file;
+
+  // line position in the source
+  sop_scanner_t scanner;
+  size_t lineno;
+
+  // SOP_DIRECTIVE_MASK()s of the directives decoded
+  uint64_t directives;
+
+  // the last decoded line and its corners. A line read past the end of
+  // a batch is kept here as `pending` for the next event.
+  sop_record_t record;
+  sop_corners_t corners;
+  int pending;
+
+  // next fan triangle of a triangulated face yielded a line at a time,
+  // 0 when none
+  size_t fan;
+
+  // line event data: int corner rows or a NUL terminated string
+  void *rows;
+  size_t rowcap;
+  void *string;
+  size_t stringcap;
+
+  // batch event data and size_t face offsets
+  void *data;
+  size_t datacap;
+  void *offsets;
+  size_t offsetcap;
+  size_t batchsize;
+
+  // first error, sticky
+  int rc;
+};
+
+/**
+ * Grows a reader buffer to hold at least `size` bytes.
+ */
+
+static int
+sop_reader_reserve(const sop_allocator_t *allocator,
+                   void **buffer,
+                   size_t *capacity,
+                   size_t size) {
+  size_t next = *capacity ? *capacity : 256;
+  void *data = 0;
+
+  if (size <= *capacity) {
+    return SOP_EOK;
+  }
+
+  while (next < size) {
+    next *= 2;
+  }
+
+  data = sop_realloc(allocator, *buffer, next);
+  if (!data) {
+    return SOP_EMEM;
+  }
+
+  *buffer = data;
+  *capacity = next;
+  return SOP_EOK;
+}
+
+int
+sop_reader_init(sop_reader_t *reader,
+                const char *source,
+                size_t length,
+                const sop_reader_options_t *options) {
+  struct sop_reader_state *state = 0;
+
+  if (!reader) {
+    return SOP_EMEM;
+  }
+
+  memset(reader, 0, sizeof(sop_reader_t));
+  if (!source || 0 == length) {
+    return SOP_EINVALID_SOURCE;
+  }
+
+  if (options) {
+    reader->options = *options;
+  }
+
+  state = (struct sop_reader_state *)
+    sop_calloc(reader->options.allocator, 1,
+               sizeof(struct sop_reader_state));
+  if (!state) {
+    return SOP_EMEM;
+  }
+
+  state->allocator = reader->options.allocator;
+  state->corners.allocator = state->allocator;
+  state->directives = reader->options.directives
+    ? reader->options.directives
+    : ~(uint64_t) 0;
+  state->batchsize = reader->options.batch_size
+    ? reader->options.batch_size
+    : SOP_PARSER_BATCH_SIZE;
+  state->rc = SOP_EOK;
+  sop_scanner_init(&state->scanner, source, length);
+
+  reader->source = source;
+  reader->length = length;
+  reader->state = state;
+  return SOP_EOK;
+}
+
+int
+sop_reader_init_file(sop_reader_t *reader,
+                     const char *path,
+                     const sop_reader_options_t *options) {
+  const sop_allocator_t *allocator = options ? options->allocator : 0;
+  sop_file_t file;
+  int rc = SOP_EOK;
+
+  if (!reader) {
+    return SOP_EMEM;
+  }
+
+  memset(reader, 0, sizeof(sop_reader_t));
+  if (!path) {
+    return SOP_EINVALID_SOURCE;
+  }
+
+  rc = sop_file_map(path, allocator, &file);
+  if (SOP_EOK != rc) {
+    return rc;
+  }
+
+  rc = sop_reader_init(reader, file.data, file.length, options);
+  if (SOP_EOK != rc) {
+    sop_file_unmap(&file, allocator);
+    return rc;
+  }
+
+  reader->state->file = file;
+  return SOP_EOK;
+}
+
+void
+sop_reader_destroy(sop_reader_t *reader) {
+  struct sop_reader_state *state = 0;
+
+  if (!reader || !reader->state) {
+    return;
+  }
+
+  state = reader->state;
+  if (state->file.data) {
+    sop_file_unmap(&state->file, state->allocator);
+  }
+
+  sop_free(state->allocator, state->corners.data);
+  sop_free(state->allocator, state->rows);
+  sop_free(state->allocator, state->string);
+  sop_free(state->allocator, state->data);
+  sop_free(state->allocator, state->offsets);
+  sop_free(state->allocator, state);
+  reader->state = 0;
+}
+
+/**
+ * Decodes the next line of interest into `state->record`. Returns 1
+ * when a line was decoded, 0 at the end of the source and -1 when the
+ * corners of a face could not be allocated.
+ */
+
+static int
+sop_reader_decode(struct sop_reader_state *state) {
+  const char *span = 0;
+  size_t spansize = 0;
+
+  while (sop_scanner_next(&state->scanner, &span, &spansize)) {
+    int decoded = 0;
+
+    state->lineno++;
+    state->corners.count = 0;
+    decoded = sop_parser_decode(span, spansize, state->directives,
+                                &state->record, &state->corners);
+    if (decoded > 0) {
+      state->record.lineno = state->lineno;
+      return 1;
+    } else if (decoded < 0) {
+      return -1;
+    }
+  }
+
+  return 0;
+}
+
+/**
+ * Lays `count` corners out as [3][n] rows for a line event, like
+ * on_face gets them, padded to `minimum` columns.
+ */
+
+static int
+sop_reader_rows(struct sop_reader_state *state,
+                sop_reader_event_t *event,
+                const int (*corners)[3],
+                size_t count,
+                size_t minimum) {
+  const size_t columns = count < minimum ? minimum : count;
+  int *rows = 0;
+
+  if (SOP_EOK != sop_reader_reserve(state->allocator,
+                                    &state->rows,
+                                    &state->rowcap,
+                                    3 * columns * sizeof(int))) {
+    return SOP_EMEM;
+  }
+
+  rows = (int *) state->rows;
+  for (size_t i = 0; i < columns; ++i) {
+    int present = i < count;
+    rows[i] = present ? corners[i][0] : -1;
+    rows[columns + i] = present && corners[i][1] ? corners[i][1] : -1;
+    rows[2 * columns + i] = present && corners[i][2] ? corners[i][2] : -1;
+  }
+
+  event->line.data = rows;
+  event->line.length = columns;
+  return SOP_EOK;
+}
+
+/**
+ * Fills a line event with the decoded line. Triangulated faces yield
+ * their fan one triangle per event.
+ */
+
+static int
+sop_reader_line(sop_reader_t *reader, sop_reader_event_t *event) {
+  struct sop_reader_state *state = reader->state;
+  const sop_record_t *record = &state->record;
+  const int (*corners)[3] = 0;
+  int triangle[3][3];
+  size_t count = 0;
+
+  event->line.type = record->type;
+  event->line.directive = record->directive;
+  event->line.lineno = record->lineno;
+  event->line.length = record->length;
+  event->line.data = (void *) &record->value;
+  event->line.material = -1;
+
+  switch (record->type) {
+    case SOP_COMMENT:
+    case SOP_DIRECTIVE_USE_MTL:
+    case SOP_DIRECTIVE_MTL_LIB:
+    case SOP_DIRECTIVE_MATERIAL_NEW:
+    case SOP_DIRECTIVE_OBJECT:
+    case SOP_DIRECTIVE_GROUP:
+    case SOP_DIRECTIVE_MATERIAL_MAP:
+      if (reader->options.zero_copy) {
+        event->line.data = (void *) record->span;
+        return SOP_EOK;
+      }
+
+      if (SOP_EOK != sop_reader_reserve(state->allocator,
+                                        &state->string,
+                                        &state->stringcap,
+                                        record->length + 1)) {
+        return SOP_EMEM;
+      }
+
+      memcpy(state->string, record->span, record->length);
+      ((char *) state->string)[record->length] = 0;
+      event->line.data = state->string;
+      return SOP_EOK;
+
+    case SOP_DIRECTIVE_FACE:
+      corners = state->corners.data + record->value.face.offset;
+      count = record->value.face.count;
+
+      if (!reader->options.triangulate || count <= 3) {
+        return sop_reader_rows(state, event, corners, count, 3);
+      }
+
+      // fan (0, i, i + 1), the next call yields the next triangle
+      if (0 == state->fan) {
+        state->fan = 1;
+      }
+
+      memcpy(triangle[0], corners[0], sizeof(triangle[0]));
+      memcpy(triangle[1], corners[state->fan], sizeof(triangle[1]));
+      memcpy(triangle[2], corners[state->fan + 1], sizeof(triangle[2]));
+      state->fan = state->fan + 2 < count ? state->fan + 1 : 0;
+      return sop_reader_rows(state, event,
+                             (const int (*)[3]) triangle, 3, 3);
+
+    case SOP_DIRECTIVE_LINE:
+    case SOP_DIRECTIVE_POINT:
+      corners = state->corners.data + record->value.face.offset;
+      return sop_reader_rows(state, event, corners,
+                             record->value.face.count, 1);
+
+    default:
+      return SOP_EOK;
+  }
+}
+
+/**
+ * Appends the decoded line to the batch of `event`.
+ */
+
+static int
+sop_reader_push(struct sop_reader_state *state,
+                const sop_reader_options_t *options,
+                sop_reader_event_t *event) {
+  const sop_record_t *record = &state->record;
+  sop_parser_batch_t *batch = &event->batch;
+  const int (*corners)[3] = 0;
+  size_t *offsets = 0;
+  size_t count = 0;
+  size_t used = 0;
+
+  if (SOP_DIRECTIVE_FACE != record->type) {
+    if (SOP_EOK != sop_reader_reserve(state->allocator, &state->data,
+                                      &state->datacap,
+                                      state->batchsize * 4 * sizeof(float))) {
+      return SOP_EMEM;
+    }
+
+    batch->data = state->data;
+    memcpy((float (*)[4]) batch->data + batch->count++,
+           record->value.floats, 4 * sizeof(float));
+    return SOP_EOK;
+  }
+
+  corners = state->corners.data + record->value.face.offset;
+  count = record->value.face.count;
+  used = batch->count ? ((size_t *) state->offsets)[batch->count] : 0;
+
+  // a fan takes 3 corners for each of its count - 2 triangles
+  if (SOP_EOK != sop_reader_reserve(state->allocator,
+                                    &state->offsets,
+                                    &state->offsetcap,
+                                    (batch->count + count + 1) *
+                                    sizeof(size_t)) ||
+      SOP_EOK != sop_reader_reserve(state->allocator, &state->data,
+                                    &state->datacap,
+                                    (used + 3 * count) * 3 * sizeof(int))) {
+    return SOP_EMEM;
+  }
+
+  offsets = (size_t *) state->offsets;
+  offsets[0] = 0;
+  batch->offsets = offsets;
+  batch->data = state->data;
+
+  if (!options->triangulate || count <= 3) {
+    memcpy((int (*)[3]) batch->data + used, corners, count * sizeof(int[3]));
+    offsets[++batch->count] = used + count;
+    return SOP_EOK;
+  }
+
+  // fan (0, i, i + 1), a batch may end up over batch_size by the fan
+  // of a single face
+  for (size_t i = 1; i + 1 < count; ++i) {
+    int (*triangle)[3] = (int (*)[3]) batch->data + used;
+    memcpy(triangle[0], corners[0], sizeof(triangle[0]));
+    memcpy(triangle[1], corners[i], sizeof(triangle[1]));
+    memcpy(triangle[2], corners[i + 1], sizeof(triangle[2]));
+    used += 3;
+    offsets[++batch->count] = used;
+  }
+
+  return SOP_EOK;
+}
+
+/**
+ * Fills a batch event with the decoded line and the lines of the same
+ * directive following it. The first line of another directive is kept
+ * pending for the next event.
+ */
+
+static int
+sop_reader_batch(sop_reader_t *reader, sop_reader_event_t *event) {
+  struct sop_reader_state *state = reader->state;
+  const sop_enum_t type = state->record.type;
+  int decoded = 1;
+  int rc = SOP_EOK;
+
+  event->batched = 1;
+  event->batch.type = type;
+  event->batch.directive = state->record.directive;
+  event->batch.lineno = state->record.lineno;
+  event->batch.material = -1;
+
+  for (;;) {
+    rc = sop_reader_push(state, &reader->options, event);
+    if (SOP_EOK != rc || event->batch.count >= state->batchsize) {
+      return rc;
+    }
+
+    decoded = sop_reader_decode(state);
+    if (decoded < 0) {
+      return SOP_EMEM;
+    } else if (0 == decoded) {
+      return SOP_EOK;
+    } else if (type != state->record.type) {
+      state->pending = 1;
+      return SOP_EOK;
+    }
+  }
+}
+
+int
+sop_reader_next(sop_reader_t *reader, sop_reader_event_t *event) {
+  struct sop_reader_state *state = 0;
+  int decoded = 1;
+
+  if (!reader || !reader->state || !event) {
+    return SOP_EMEM;
+  }
+
+  state = reader->state;
+  if (SOP_EOK != state->rc) {
+    return state->rc;
+  }
+
+  memset(event, 0, sizeof(sop_reader_event_t));
+
+  // the rest of a fan, the face is still decoded
+  if (state->fan) {
+    event->type = state->record.type;
+    state->rc = sop_reader_line(reader, event);
+    return state->rc;
+  }
+
+  if (state->pending) {
+    state->pending = 0;
+  } else {
+    decoded = sop_reader_decode(state);
+  }
+
+  if (0 == decoded) {
+    return SOP_NULL;
+  } else if (decoded < 0) {
+    state->rc = SOP_EMEM;
+    return state->rc;
+  }
+
+  event->type = state->record.type;
+  if (reader->options.batches & SOP_DIRECTIVE_MASK(state->record.type)) {
+    switch (state->record.type) {
+      case SOP_DIRECTIVE_VERTEX:
+      case SOP_DIRECTIVE_VERTEX_TEXTURE:
+      case SOP_DIRECTIVE_VERTEX_NORMAL:
+      case SOP_DIRECTIVE_FACE:
+        state->rc = sop_reader_batch(reader, event);
+        return state->rc;
+
+      default:
+        break;
+    }
+  }
+
+  state->rc = sop_reader_line(reader, event);
+  return state->rc;
+}
@@ -0,0 +1,112 @@
+#include <stdint.h>
+#include <string.h>
+#include "internal.h"
+
+#if defined(__x86_64__) || defined(_M_X64)
+#define SOP_SCAN_SSE2 1
+#include <emmintrin.h>
+#if defined(__GNUC__) || defined(__clang__)
+#define SOP_SCAN_AVX2 1
+#include <immintrin.h>
+#endif
+#endif
+
+/**
+ * Broadcasts a byte to all 8 lanes of a 64 bit word.
+ */
+
+#define SWAR_BROADCAST(c) (0x0101010101010101ULL * (uint8_t) (c))
+
+/**
+ * Yields a nonzero value if any byte of `x` is zero.
+ */
+
+#define SWAR_HAS_ZERO(x) \
+  (((x) - 0x0101010101010101ULL) & ~(x) & 0x8080808080808080ULL)
+
+static uint64_t
+scan_newlines_scalar(const char *source) {
+  const uint64_t nl = SWAR_BROADCAST('\n');
+  uint64_t mask = 0;
+  for (int i = 0; i < SOP_SCAN_BLOCK; i += 8) {
+    uint64_t word = 0;
+    memcpy(&word, source + i, sizeof(word));
+    // only words that may hold a newline get a closer look
+    if (SWAR_HAS_ZERO(word ^ nl)) {
+      for (int j = 0; j < 8; ++j) {
+        if ('\n' == source[i + j]) {
+          mask |= (uint64_t) 1 << (i + j);
+        }
+      }
+    }
+  }
+  return mask;
+}
+
+#if SOP_SCAN_SSE2
+static uint64_t
+scan_newlines_sse2(const char *source) {
+  const __m128i nl = _mm_set1_epi8('\n');
+  uint64_t mask = 0;
+  for (int i = 0; i < SOP_SCAN_BLOCK; i += 16) {
+    __m128i chunk = _mm_loadu_si128((const __m128i *) (source + i));
+    uint16_t bits = (uint16_t) _mm_movemask_epi8(_mm_cmpeq_epi8(chunk, nl));
+    mask |= (uint64_t) bits << i;
+  }
+  return mask;
+}
+#endif
+
+#if SOP_SCAN_AVX2
+__attribute__((target("avx2")))
+static uint64_t
+scan_newlines_avx2(const char *source) {
+  const __m256i nl = _mm256_set1_epi8('\n');
+  __m256i lo = _mm256_loadu_si256((const __m256i *) source);
+  __m256i hi = _mm256_loadu_si256((const __m256i *) (source + 32));
+  uint32_t lomask = (uint32_t) _mm256_movemask_epi8(_mm256_cmpeq_epi8(lo, nl));
+  uint32_t himask = (uint32_t) _mm256_movemask_epi8(_mm256_cmpeq_epi8(hi, nl));
+  return (uint64_t) lomask | ((uint64_t) himask << 32);
+}
+#endif
+
+static uint64_t
+scan_newlines_dispatch(const char *source);
+
+sop_scan_block_fn sop_scan_newlines_fn = scan_newlines_dispatch;
+
+/**
+ * Resolves the best block scanner for the running CPU.
+ */
+
+static void
+scan_resolve(void) {
+  sop_scan_block_fn newlines = scan_newlines_scalar;
+#if SOP_SCAN_SSE2
+  newlines = scan_newlines_sse2;
+#endif
+#if SOP_SCAN_AVX2
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("avx2")) {
+    newlines = scan_newlines_avx2;
+  }
+#endif
+  __atomic_store_n(&sop_scan_newlines_fn, newlines, __ATOMIC_RELAXED);
+}
+
+static uint64_t
+scan_newlines_dispatch(const char *source) {
+  scan_resolve();
+  return sop_scan_newlines(source);
+}
+
+uint64_t
+sop_scan_newlines_tail(const char *source, size_t length) {
+  uint64_t mask = 0;
+  for (size_t i = 0; i < length && i < SOP_SCAN_BLOCK; ++i) {
+    if ('\n' == source[i]) {
+      mask |= (uint64_t) 1 << i;
+    }
+  }
+  return mask;
+}
@@ -1,7 +1,10 @@
+#include <limits.h>
+#include <stdint.h>
 #include <stdlib.h>
 #include <string.h>
 #include <stdio.h>
 #include <sop/sop.h>
+#include "internal.h"
 
 int
 sop_parser_init(sop_parser_t *parser,
@@ -26,400 +29,924 @@ sop_parser_init(sop_parser_t *parser,
   SET_CALLBACK_IF(on_normal);
   SET_CALLBACK_IF(on_smooth);
   SET_CALLBACK_IF(on_face);
+  SET_CALLBACK_IF(on_vertex_parameter);
+  SET_CALLBACK_IF(on_line);
+  SET_CALLBACK_IF(on_point);
+  SET_CALLBACK_IF(on_object);
+  SET_CALLBACK_IF(on_group);
+  SET_CALLBACK_IF(on_material_emissive);
+  SET_CALLBACK_IF(on_material_density);
+  SET_CALLBACK_IF(on_material_transmission);
+  SET_CALLBACK_IF(on_material_map);
+  SET_CALLBACK_IF(on_vertices);
+  SET_CALLBACK_IF(on_textures);
+  SET_CALLBACK_IF(on_normals);
+  SET_CALLBACK_IF(on_faces);
+  SET_CALLBACK_IF(on_group_complete);
 #undef SET_CALLBACK_IF
+
+  // lines nobody consumes are skipped before decoding
+  parser->directives = options->directives;
+  if (0 == parser->directives) {
+#define DIRECTIVE_IF(cb, type) \
+  if (parser->callbacks. cb) { parser->directives |= SOP_DIRECTIVE_MASK(type); }
+    DIRECTIVE_IF(on_comment, SOP_COMMENT);
+    DIRECTIVE_IF(on_vertex, SOP_DIRECTIVE_VERTEX);
+    DIRECTIVE_IF(on_vertices, SOP_DIRECTIVE_VERTEX);
+    DIRECTIVE_IF(on_texture, SOP_DIRECTIVE_VERTEX_TEXTURE);
+    DIRECTIVE_IF(on_textures, SOP_DIRECTIVE_VERTEX_TEXTURE);
+    DIRECTIVE_IF(on_normal, SOP_DIRECTIVE_VERTEX_NORMAL);
+    DIRECTIVE_IF(on_normals, SOP_DIRECTIVE_VERTEX_NORMAL);
+    DIRECTIVE_IF(on_face, SOP_DIRECTIVE_FACE);
+    DIRECTIVE_IF(on_faces, SOP_DIRECTIVE_FACE);
+    DIRECTIVE_IF(on_smooth, SOP_DIRECTIVE_SMOOTH);
+    DIRECTIVE_IF(on_material_use, SOP_DIRECTIVE_USE_MTL);
+    DIRECTIVE_IF(on_material_lib, SOP_DIRECTIVE_MTL_LIB);
+    DIRECTIVE_IF(on_material_new, SOP_DIRECTIVE_MATERIAL_NEW);
+    DIRECTIVE_IF(on_material_ambient, SOP_DIRECTIVE_MATERIAL_AMBIENT_COLOR);
+    DIRECTIVE_IF(on_material_diffuse, SOP_DIRECTIVE_MATERIAL_DIFFUSE_COLOR);
+    DIRECTIVE_IF(on_material_specular, SOP_DIRECTIVE_MATERIAL_SPECULAR_COLOR);
+    DIRECTIVE_IF(on_material_illum, SOP_DIRECTIVE_MATERIAL_ILLUM);
+    DIRECTIVE_IF(on_material_shininess, SOP_DIRECTIVE_MATERIAL_SHININESS);
+    DIRECTIVE_IF(on_material_transparency,
+                 SOP_DIRECTIVE_MATERIAL_TRANSPARENCY);
+    DIRECTIVE_IF(on_vertex_parameter, SOP_DIRECTIVE_VERTEX_PARAMETER);
+    DIRECTIVE_IF(on_line, SOP_DIRECTIVE_LINE);
+    DIRECTIVE_IF(on_point, SOP_DIRECTIVE_POINT);
+    DIRECTIVE_IF(on_object, SOP_DIRECTIVE_OBJECT);
+    DIRECTIVE_IF(on_group, SOP_DIRECTIVE_GROUP);
+    DIRECTIVE_IF(on_material_emissive, SOP_DIRECTIVE_MATERIAL_EMISSIVE_COLOR);
+    DIRECTIVE_IF(on_material_density, SOP_DIRECTIVE_MATERIAL_OPTICAL_DENSITY);
+    DIRECTIVE_IF(on_material_transmission,
+                 SOP_DIRECTIVE_MATERIAL_TRANSMISSION_FILTER);
+    DIRECTIVE_IF(on_material_map, SOP_DIRECTIVE_MATERIAL_MAP);
+
+    // materials are tabled from every statement describing them
+    if (options->materials) {
+      parser->directives |= SOP_MATERIAL_DIRECTIVES;
+      if (options->load_materials) {
+        parser->directives |= SOP_DIRECTIVE_MASK(SOP_DIRECTIVE_MTL_LIB);
+      }
+    }
+
+    // groups are counted from every element they may hold
+    if (parser->callbacks.on_group_complete) {
+      parser->directives |= SOP_DIRECTIVE_MASK(SOP_DIRECTIVE_VERTEX) |
+                            SOP_DIRECTIVE_MASK(SOP_DIRECTIVE_VERTEX_TEXTURE) |
+                            SOP_DIRECTIVE_MASK(SOP_DIRECTIVE_VERTEX_NORMAL) |
+                            SOP_DIRECTIVE_MASK(SOP_DIRECTIVE_FACE) |
+                            SOP_DIRECTIVE_MASK(SOP_DIRECTIVE_OBJECT) |
+                            SOP_DIRECTIVE_MASK(SOP_DIRECTIVE_GROUP);
+    }
+#undef DIRECTIVE_IF
+  }
+
   return SOP_EOK;
 }
 
+/**
+ * Directive keywords are at most 8 bytes so a keyword loaded little
+ * endian into a zero padded 64 bit word is its own key. Multiplying by
+ * SOP_DIRECTIVE_HASH and keeping the top 6 bits maps every known key to
+ * a distinct slot of a 64 entry table, a single probe and compare then
+ * resolves any directive. The multiplier was found by search, adding a
+ * keyword means checking it still yields no collisions.
+ */
+
+#define SOP_DIRECTIVE_HASH 0x09986fdb6d8c7befULL
+#define SOP_DIRECTIVE_SLOT(key) ((uint64_t) ((key) * SOP_DIRECTIVE_HASH) >> 58)
+
+#define KEY(a, b, c, d, e, f, g, h) \
+  ((uint64_t) (a)       | (uint64_t) (b) << 8  | \
+   (uint64_t) (c) << 16 | (uint64_t) (d) << 24 | \
+   (uint64_t) (e) << 32 | (uint64_t) (f) << 40 | \
+   (uint64_t) (g) << 48 | (uint64_t) (h) << 56)
+
+#define DIRECTIVE(name, t, key) \
+  [SOP_DIRECTIVE_SLOT(key)] = { key, t, name, sizeof(name) - 1 }
+
+typedef struct sop_directive_entry sop_directive_entry_t;
+struct sop_directive_entry {
+  uint64_t key;
+  sop_enum_t type;
+  char *name;
+  size_t size;
+};
+
+static const sop_directive_entry_t sop_directives[64] = {
+  DIRECTIVE("v", SOP_DIRECTIVE_VERTEX,
+            KEY('v', 0, 0, 0, 0, 0, 0, 0)),
+  DIRECTIVE("vt", SOP_DIRECTIVE_VERTEX_TEXTURE,
+            KEY('v', 't', 0, 0, 0, 0, 0, 0)),
+  DIRECTIVE("vn", SOP_DIRECTIVE_VERTEX_NORMAL,
+            KEY('v', 'n', 0, 0, 0, 0, 0, 0)),
+  DIRECTIVE("vp", SOP_DIRECTIVE_VERTEX_PARAMETER,
+            KEY('v', 'p', 0, 0, 0, 0, 0, 0)),
+  DIRECTIVE("f", SOP_DIRECTIVE_FACE,
+            KEY('f', 0, 0, 0, 0, 0, 0, 0)),
+  DIRECTIVE("l", SOP_DIRECTIVE_LINE,
+            KEY('l', 0, 0, 0, 0, 0, 0, 0)),
+  DIRECTIVE("p", SOP_DIRECTIVE_POINT,
+            KEY('p', 0, 0, 0, 0, 0, 0, 0)),
+  DIRECTIVE("o", SOP_DIRECTIVE_OBJECT,
+            KEY('o', 0, 0, 0, 0, 0, 0, 0)),
+  DIRECTIVE("g", SOP_DIRECTIVE_GROUP,
+            KEY('g', 0, 0, 0, 0, 0, 0, 0)),
+  DIRECTIVE("s", SOP_DIRECTIVE_SMOOTH,
+            KEY('s', 0, 0, 0, 0, 0, 0, 0)),
+  DIRECTIVE("usemtl", SOP_DIRECTIVE_USE_MTL,
+            KEY('u', 's', 'e', 'm', 't', 'l', 0, 0)),
+  DIRECTIVE("mtllib", SOP_DIRECTIVE_MTL_LIB,
+            KEY('m', 't', 'l', 'l', 'i', 'b', 0, 0)),
+  DIRECTIVE("newmtl", SOP_DIRECTIVE_MATERIAL_NEW,
+            KEY('n', 'e', 'w', 'm', 't', 'l', 0, 0)),
+  DIRECTIVE("Ka", SOP_DIRECTIVE_MATERIAL_AMBIENT_COLOR,
+            KEY('K', 'a', 0, 0, 0, 0, 0, 0)),
+  DIRECTIVE("Kd", SOP_DIRECTIVE_MATERIAL_DIFFUSE_COLOR,
+            KEY('K', 'd', 0, 0, 0, 0, 0, 0)),
+  DIRECTIVE("Ks", SOP_DIRECTIVE_MATERIAL_SPECULAR_COLOR,
+            KEY('K', 's', 0, 0, 0, 0, 0, 0)),
+  DIRECTIVE("Ke", SOP_DIRECTIVE_MATERIAL_EMISSIVE_COLOR,
+            KEY('K', 'e', 0, 0, 0, 0, 0, 0)),
+  DIRECTIVE("Ns", SOP_DIRECTIVE_MATERIAL_SHININESS,
+            KEY('N', 's', 0, 0, 0, 0, 0, 0)),
+  DIRECTIVE("Ni", SOP_DIRECTIVE_MATERIAL_OPTICAL_DENSITY,
+            KEY('N', 'i', 0, 0, 0, 0, 0, 0)),
+  DIRECTIVE("d", SOP_DIRECTIVE_MATERIAL_TRANSPARENCY,
+            KEY('d', 0, 0, 0, 0, 0, 0, 0)),
+  DIRECTIVE("Tr", SOP_DIRECTIVE_MATERIAL_TRANSPARENCY,
+            KEY('T', 'r', 0, 0, 0, 0, 0, 0)),
+  DIRECTIVE("Tf", SOP_DIRECTIVE_MATERIAL_TRANSMISSION_FILTER,
+            KEY('T', 'f', 0, 0, 0, 0, 0, 0)),
+  DIRECTIVE("illum", SOP_DIRECTIVE_MATERIAL_ILLUM,
+            KEY('i', 'l', 'l', 'u', 'm', 0, 0, 0)),
+  DIRECTIVE("map_Ka", SOP_DIRECTIVE_MATERIAL_MAP,
+            KEY('m', 'a', 'p', '_', 'K', 'a', 0, 0)),
+  DIRECTIVE("map_Kd", SOP_DIRECTIVE_MATERIAL_MAP,
+            KEY('m', 'a', 'p', '_', 'K', 'd', 0, 0)),
+  DIRECTIVE("map_Ks", SOP_DIRECTIVE_MATERIAL_MAP,
+            KEY('m', 'a', 'p', '_', 'K', 's', 0, 0)),
+  DIRECTIVE("map_Ke", SOP_DIRECTIVE_MATERIAL_MAP,
+            KEY('m', 'a', 'p', '_', 'K', 'e', 0, 0)),
+  DIRECTIVE("map_Ns", SOP_DIRECTIVE_MATERIAL_MAP,
+            KEY('m', 'a', 'p', '_', 'N', 's', 0, 0)),
+  DIRECTIVE("map_d", SOP_DIRECTIVE_MATERIAL_MAP,
+            KEY('m', 'a', 'p', '_', 'd', 0, 0, 0)),
+  DIRECTIVE("map_Tr", SOP_DIRECTIVE_MATERIAL_MAP,
+            KEY('m', 'a', 'p', '_', 'T', 'r', 0, 0)),
+  DIRECTIVE("map_bump", SOP_DIRECTIVE_MATERIAL_MAP,
+            KEY('m', 'a', 'p', '_', 'b', 'u', 'm', 'p')),
+  DIRECTIVE("map_Bump", SOP_DIRECTIVE_MATERIAL_MAP,
+            KEY('m', 'a', 'p', '_', 'B', 'u', 'm', 'p')),
+  DIRECTIVE("bump", SOP_DIRECTIVE_MATERIAL_MAP,
+            KEY('b', 'u', 'm', 'p', 0, 0, 0, 0)),
+  DIRECTIVE("disp", SOP_DIRECTIVE_MATERIAL_MAP,
+            KEY('d', 'i', 's', 'p', 0, 0, 0, 0)),
+  DIRECTIVE("decal", SOP_DIRECTIVE_MATERIAL_MAP,
+            KEY('d', 'e', 'c', 'a', 'l', 0, 0, 0)),
+  DIRECTIVE("refl", SOP_DIRECTIVE_MATERIAL_MAP,
+            KEY('r', 'e', 'f', 'l', 0, 0, 0, 0)),
+  DIRECTIVE("norm", SOP_DIRECTIVE_MATERIAL_MAP,
+            KEY('n', 'o', 'r', 'm', 0, 0, 0, 0)),
+};
+
+#undef DIRECTIVE
+#undef KEY
+
+/**
+ * Yields a mask with the high bit of every byte of `x` set that is a
+ * white space or control character (<= ' '). Bytes are tested exactly,
+ * no carries cross lanes.
+ */
+
+#define SWAR_SPACES(x)                                               \
+  (~((((x) & 0x7f7f7f7f7f7f7f7fULL) + 0x5f5f5f5f5f5f5f5fULL) | (x)) & \
+   0x8080808080808080ULL)
+
+sop_enum_t
+sop_parser_directive(const char *line,
+                     size_t length,
+                     char **directive,
+                     size_t *size) {
+  const sop_directive_entry_t *entry = 0;
+  uint64_t word = 0;
+  uint64_t spaces = 0;
+  size_t keysize = 0;
+
+  *directive = 0;
+  *size = 0;
+
+  // comments need no separating white space
+  if ('#' == line[0]) {
+    *directive = "#";
+    *size = 1;
+    return SOP_COMMENT;
+  }
+
+  // the zero padding past the end of a short line reads as white space
+  if (length >= 8) {
+    memcpy(&word, line, sizeof(word));
+  } else {
+    for (size_t i = 0; i < length; ++i) {
+      word |= (uint64_t) (unsigned char) line[i] << (8 * i);
+    }
+  }
+  spaces = SWAR_SPACES(word);
+  if (spaces) {
+    keysize = (size_t) __builtin_ctzll(spaces) / 8;
+    word &= keysize ? ~(uint64_t) 0 >> (64 - 8 * keysize) : 0;
+  } else if (length == 8 || (unsigned char) line[8] <= ' ') {
+    keysize = 8;
+  }
+
+  // unknown directives (or ones too long to be known) are skipped
+  entry = &sop_directives[SOP_DIRECTIVE_SLOT(word)];
+  if (0 == keysize || entry->key != word) {
+    return SOP_NULL;
+  }
+
+  *directive = entry->name;
+  *size = entry->size;
+  return entry->type;
+}
+
+#define IS_SPACE(c) (' ' == (c) || '\t' == (c) || '\r' == (c))
+
+/**
+ * Yields a mask with the high bit of every byte of `x` set that is not
+ * an ASCII digit. Bytes are tested exactly, no carries cross lanes.
+ */
+
+#define SWAR_NON_DIGITS(x)                                       \
+  (((((x) ^ 0x3030303030303030ULL) & 0x7f7f7f7f7f7f7f7fULL) +    \
+    0x7676767676767676ULL) | (x)) & 0x8080808080808080ULL
+
+/**
+ * Converts up to 8 leading ASCII digits of `word` (first character in
+ * the low byte) to their value with three multiplies. Returns the
+ * number of digits converted.
+ */
+
+static size_t
+sop_parser_digits8(uint64_t word, uint32_t *out) {
+  const uint64_t nondigits = SWAR_NON_DIGITS(word);
+  const size_t count = nondigits
+    ? (size_t) __builtin_ctzll(nondigits) / 8
+    : 8;
+  uint64_t value = 0;
+
+  if (0 == count) {
+    return 0;
+  }
+
+  // left align the digits so the missing leading ones read as zeros
+  value = (word - 0x3030303030303030ULL) << (8 * (8 - count));
+  value = (value * 10) + (value >> 8);
+  value = (((value & 0x000000ff000000ffULL) * (100 + (1000000ULL << 32))) +
+           (((value >> 16) & 0x000000ff000000ffULL) *
+            (1 + (10000ULL << 32)))) >> 32;
+
+  *out = (uint32_t) value;
+  return count;
+}
+
+/**
+ * Parses a decimal integer in place. Returns the number of bytes
+ * consumed or 0 if `source` does not start with an integer. Values
+ * past INT_MAX are clamped to +/-INT_MAX.
+ */
+
+static size_t
+sop_parser_integer(const char *source, size_t length, int *out) {
+  const char *end = source + length;
+  const char *p = source;
+  uint32_t digits = 0;
+  uint64_t value = 0;
+  int negative = 0;
+
+  if (p < end && ('-' == *p || '+' == *p)) {
+    negative = '-' == *p;
+    p++;
+  }
+
+  // 8 digits at a time while a whole word is left on the line
+  if (end - p >= 8) {
+    uint64_t word = 0;
+    size_t count = 0;
+    memcpy(&word, p, sizeof(word));
+    count = sop_parser_digits8(word, &digits);
+    if (0 == count) {
+      return 0;
+    }
+    value = digits;
+    p += count;
+    if (count < 8) {
+      *out = negative ? -(int) value : (int) value;
+      return (size_t) (p - source);
+    }
+  } else if (p == end || (unsigned char) (*p - '0') > 9) {
+    return 0;
+  }
+
+  // digits past INT_MAX are consumed but no longer accumulated
+  for (; p < end && (unsigned char) (*p - '0') <= 9; ++p) {
+    if (value <= INT_MAX) {
+      value = value * 10 + (uint64_t) (*p - '0');
+    }
+  }
+
+  if (value > INT_MAX) {
+    value = INT_MAX;
+  }
+
+  *out = negative ? -(int) value : (int) value;
+  return (size_t) (p - source);
+}
+
+/**
+ * Copies a line slice into a NUL terminated string. Slices that do not
+ * fit `buffer` (BUFSIZ bytes) are copied into a heap allocation that is
+ * returned in `heap` and must be freed by the caller.
+ */
+
+static char *
+sop_parser_string(const sop_allocator_t *allocator,
+                  char *buffer,
+                  char **heap,
+                  const char *span,
+                  size_t size) {
+  char *out = buffer;
+  if (size >= BUFSIZ) {
+    out = *heap = (char *) sop_alloc(allocator, size + 1);
+    if (!out) { return 0; }
+  }
+
+  memcpy(out, span, size);
+  out[size] = 0;
+  return out;
+}
+
+/**
+ * Decodes the face corners of a line into `face`. Every corner holds
+ * its (v, vt, vn) indices as written in the source, texture and normal
+ * indices are 0 when absent. Corners are `v`, `v/vt`, `v//vn` or
+ * `v/vt/vn` groups separated by white space.
+ */
+
+#define IS_FACE_SPACE(c) ((unsigned char) (c) <= ' ')
+
+static int
+sop_parser_face(const char *span,
+                size_t length,
+                sop_record_t *record,
+                sop_corners_t *corners) {
+  const char *p = span;
+  const char *end = span + length;
+  // every corner but the last takes at least two bytes
+  const size_t most = corners->count + length / 2 + 1;
+  int (*corner)[3] = 0;
+
+  if (most > corners->capacity) {
+    size_t capacity = corners->capacity ? corners->capacity : 64;
+    void *data = 0;
+    while (capacity < most) {
+      capacity *= 2;
+    }
+
+    data = sop_realloc(corners->allocator, corners->data,
+                       capacity * sizeof(corners->data[0]));
+    if (!data) {
+      return SOP_OOB;
+    }
+
+    corners->data = (int (*)[3]) data;
+    corners->capacity = capacity;
+  }
+
+  record->value.face.offset = corners->count;
+  corner = corners->data + corners->count;
+
+  for (;;) {
+    while (p < end && IS_FACE_SPACE(*p)) { p++; }
+    if (p == end) {
+      break;
+    }
+
+    (*corner)[0] = (*corner)[1] = (*corner)[2] = 0;
+    p += sop_parser_integer(p, (size_t) (end - p), &(*corner)[0]);
+    if (p < end && '/' == *p) {
+      p++;
+      p += sop_parser_integer(p, (size_t) (end - p), &(*corner)[1]);
+      if (p < end && '/' == *p) {
+        p++;
+        p += sop_parser_integer(p, (size_t) (end - p), &(*corner)[2]);
+      }
+    }
+
+    // ignore anything else up to the next corner
+    while (p < end && !IS_FACE_SPACE(*p)) { p++; }
+    corner++;
+  }
+
+  record->value.face.count =
+    (size_t) (corner - corners->data) - record->value.face.offset;
+  corners->count += record->value.face.count;
+  return 1;
+}
+
 int
-sop_parser_execute(sop_parser_t *parser,
-                   const char *source,
-                   size_t length) {
-  // handle poor state and input
-  if (!parser) {
-    return SOP_EMEM;
-  } else if (!source || 0 == length) {
-    return SOP_EINVALID_SOURCE;
+sop_parser_decode(const char *span,
+                  size_t size,
+                  uint64_t directives,
+                  sop_record_t *record,
+                  sop_corners_t *corners) {
+  const char *end = span + size;
+  size_t skip = 0;
+
+  while (span < end && IS_SPACE(*span)) { span++; }
+  while (end > span && IS_SPACE(end[-1])) { end--; }
+
+  if (span == end) {
+    record->type = SOP_NULL;
+    record->length = 0;
+    return 0;
+  }
+
+  record->type = sop_parser_directive(span, (size_t) (end - span),
+                                      &record->directive, &skip);
+
+  span += skip;
+  while (span < end && IS_SPACE(*span)) { span++; }
+
+  // nothing to notify the consumer about, a bare `o` or `g` still
+  // starts a new group
+  if ((span == end &&
+       SOP_DIRECTIVE_OBJECT != record->type &&
+       SOP_DIRECTIVE_GROUP != record->type) ||
+      SOP_NULL == record->type ||
+      !(directives & SOP_DIRECTIVE_MASK(record->type))) {
+    return 0;
+  }
+
+  record->span = span;
+  record->length = (size_t) (end - span);
+
+  switch (record->type) {
+    case SOP_DIRECTIVE_VERTEX:
+    case SOP_DIRECTIVE_MATERIAL_AMBIENT_COLOR:
+    case SOP_DIRECTIVE_MATERIAL_DIFFUSE_COLOR:
+    case SOP_DIRECTIVE_MATERIAL_SPECULAR_COLOR:
+    case SOP_DIRECTIVE_MATERIAL_EMISSIVE_COLOR:
+    case SOP_DIRECTIVE_MATERIAL_TRANSMISSION_FILTER: {
+      float *values = record->value.floats;
+      values[0] = values[1] = values[2] = 0;
+      values[3] = 1;
+      (void) sop_parse_floats(span, record->length, values, 4);
+      break;
+    }
+
+    case SOP_DIRECTIVE_VERTEX_TEXTURE:
+    case SOP_DIRECTIVE_VERTEX_NORMAL: {
+      float *values = record->value.floats;
+      values[0] = values[1] = values[2] = values[3] = 0;
+      (void) sop_parse_floats(span, record->length, values, 4);
+      break;
+    }
+
+    case SOP_DIRECTIVE_VERTEX_PARAMETER: {
+      // w defaults to 1 for rational curves and surfaces
+      float *values = record->value.floats;
+      values[0] = values[1] = values[3] = 0;
+      values[2] = 1;
+      (void) sop_parse_floats(span, record->length, values, 3);
+      break;
+    }
+
+    case SOP_DIRECTIVE_MATERIAL_OPTICAL_DENSITY:
+      record->value.floats[0] = 1;
+      (void) sop_parse_floats(span, record->length, record->value.floats, 1);
+      break;
+
+    case SOP_DIRECTIVE_FACE:
+    case SOP_DIRECTIVE_LINE:
+    case SOP_DIRECTIVE_POINT:
+      return sop_parser_face(span, record->length, record, corners);
+
+    case SOP_DIRECTIVE_MATERIAL_ILLUM:
+    case SOP_DIRECTIVE_MATERIAL_SHININESS:
+    case SOP_DIRECTIVE_MATERIAL_TRANSPARENCY:
+      record->value.integer = 0;
+      (void) sop_parser_integer(span, record->length,
+                                &record->value.integer);
+      break;
+
+    case SOP_DIRECTIVE_SMOOTH:
+      // "off" and "0" disable smoothing, "on" or a smoothing
+      // group number enable it
+      if ((3 == record->length && 0 == memcmp(span, "off", 3)) ||
+          (1 == record->length && '0' == span[0])) {
+        record->value.integer = 0;
+      } else {
+        record->value.integer = 1;
+      }
+      break;
+
+    default:
+      break;
   }
 
-  // sop state
-  sop_parser_line_state_t line;
-  sop_parser_state_t state;
-  sop_enum_t type = SOP_NULL;
+  return 1;
+}
 
-  // setup sate pointers
-  state.line = &line;
-  state.data = parser->options->data;
+/**
+ * Notifies a string directive callback. String directives point into
+ * the source in zero copy mode, otherwise they get a NUL terminated copy.
+ */
 
-  // source state
-  size_t bufsize = 0;
+static int
+sop_parser_dispatch_string(sop_context_t *ctx,
+                           const sop_record_t *record,
+                           sop_parser_line_cb cb) {
   char buffer[BUFSIZ];
-  char prev = 0;
-  char ch0 = 0;
-  char ch1 = 0;
-  int lineno = 0;
-  int colno = 0;
-
-  // init buffer
-  memset(buffer, 0, BUFSIZ);
-
-#define RESET_LINE_STATE {   \
-  memset(buffer, 0, BUFSIZ); \
-  lineno++;                  \
-  bufsize = 0;               \
-  colno = 0;                 \
+  char *heap = 0;
+  int rc = SOP_EOK;
+
+  if (ctx->parser->options->zero_copy) {
+    ctx->line.data = (void *) record->span;
+  } else {
+    ctx->line.data = sop_parser_string(ctx->allocator, buffer, &heap,
+                                       record->span,
+                                       record->length);
+    if (!ctx->line.data) {
+      return SOP_EMEM;
+    }
+  }
+
+  rc = cb(&ctx->state, ctx->line);
+
+  if (heap) {
+    sop_free(ctx->allocator, heap);
+  }
+
+  return rc;
 }
 
-  for (int i = 0; i < length; ++i) {
-    ch0 = source[i];
-    ch1 = source[i + 1];
+/**
+ * Notifies a callback of `count` corners as [3][n] rows: row 0 holds
+ * the vertex indices, row 1 the texture indices and row 2 the normal
+ * indices, missing indices are -1. Rows are padded to `minimum` columns.
+ */
+
+static int
+sop_parser_notify_corners(sop_context_t *ctx,
+                          sop_parser_line_cb cb,
+                          const int (*corners)[3],
+                          size_t count,
+                          size_t minimum) {
+  const size_t columns = count < minimum ? minimum : count;
+  int *faces = ctx->faces;
+
+  if (3 * columns > ctx->facecap) {
+    faces = (int *) sop_realloc(ctx->allocator, ctx->faces,
+                                3 * columns * sizeof(int));
+    if (!faces) {
+      return SOP_EMEM;
+    }
+    ctx->faces = faces;
+    ctx->facecap = 3 * columns;
+  }
 
-    if (i > 0) {
-      prev = source[i - 1];
+  for (size_t i = 0; i < columns; ++i) {
+    int present = i < count;
+    faces[i] = present ? corners[i][0] : -1;
+    faces[columns + i] = present && corners[i][1] ? corners[i][1] : -1;
+    faces[2 * columns + i] = present && corners[i][2] ? corners[i][2] : -1;
+  }
+
+  ctx->line.data = faces;
+  ctx->line.length = columns;
+  return cb(&ctx->state, ctx->line);
+}
+
+/**
+ * Notifies on_face of a face or, when triangulating, of every triangle
+ * of its fan.
+ */
+
+static int
+sop_parser_dispatch_face(sop_context_t *ctx,
+                         const sop_record_t *record,
+                         sop_parser_line_cb cb) {
+  const int (*corners)[3] = ctx->corners->data + record->value.face.offset;
+  const size_t count = record->value.face.count;
+  int rc = SOP_EOK;
+
+  if (!ctx->parser->options->triangulate || count <= 3) {
+    return sop_parser_notify_corners(ctx, cb, corners, count, 3);
+  }
+
+  for (size_t i = 1; i + 1 < count && SOP_EOK == rc; ++i) {
+    int triangle[3][3];
+    memcpy(triangle[0], corners[0], sizeof(triangle[0]));
+    memcpy(triangle[1], corners[i], sizeof(triangle[1]));
+    memcpy(triangle[2], corners[i + 1], sizeof(triangle[2]));
+    rc = sop_parser_notify_corners(ctx, cb,
+                                   (const int (*)[3]) triangle, 3, 3);
+  }
+
+  return rc;
+}
+
+int
+sop_parser_dispatch(sop_context_t *ctx, const sop_record_t *record) {
+  sop_parser_t *parser = ctx->parser;
+  sop_parser_line_cb cb = 0;
+  int string = 0;
+  int rc = SOP_EOK;
+
+  if (parser->callbacks.on_group_complete) {
+    rc = sop_context_group(ctx, record);
+    if (SOP_EOK != rc) {
+      return rc;
     }
+  }
 
-    if ((' ' == ch0 && '\n' == prev)) {
-      RESET_LINE_STATE;
-      continue;
+  if (parser->options->materials) {
+    if (SOP_MATERIAL_DIRECTIVES & SOP_DIRECTIVE_MASK(record->type)) {
+      rc = sop_context_material(ctx, record);
+    } else if (SOP_DIRECTIVE_MTL_LIB == record->type &&
+               parser->options->load_materials) {
+      rc = sop_context_mtllib(ctx, record);
     }
 
-    if (' ' == ch0 && 0 == colno) {
-      ch0 = ch1;
-      ch1 = source[++i];
+    if (SOP_EOK != rc) {
+      return rc;
     }
+  }
 
-#define CALL_CALLBACK_IF(cb, ...) {              \
-  int rc = SOP_EOK;                              \
-  if (parser->callbacks. cb) {                   \
-    rc = parser->callbacks. cb(__VA_ARGS__);     \
-    if (rc != SOP_EOK) return rc;                \
-  }                                              \
-}
-    // we've reached the end of the line and now need
-    // to notify the consumer with a callback, state error,
-    // or continue if there is nothing to do
-    if ('\n' == ch0) {
-      if (!bufsize) {
-        RESET_LINE_STATE;
-        continue;
+  switch (record->type) {
+    // continue until something meaningful
+    case SOP_NULL: return SOP_EOK;
+
+    // handle comments
+    case SOP_COMMENT:
+      cb = parser->callbacks.on_comment;
+      string = 1;
+      break;
+
+    // handle directives
+    case SOP_DIRECTIVE_VERTEX_TEXTURE:
+      if (parser->callbacks.on_textures) {
+        return sop_context_push(ctx, record);
       }
-      line.data = 0;
-      line.type = type;
-      line.length = bufsize;
-      line.data = (void *) buffer;
-      switch (type) {
-        // continue until something meaningful
-        case SOP_NULL: break;
-
-        // handle comments
-        case SOP_COMMENT: {
-          line.data = (void *) buffer;
-          CALL_CALLBACK_IF(on_comment, &state, line);
-          break;
-        }
-
-        // handle directives
-        case SOP_DIRECTIVE_VERTEX_TEXTURE: {
-          float vertex[4];
-          sscanf(buffer, "%f %f %f %f",
-              &vertex[0], &vertex[1], &vertex[2], &vertex[3]);
-          line.data = vertex;
-          CALL_CALLBACK_IF(on_texture, &state, line);
-          break;
-        }
-
-        case SOP_DIRECTIVE_VERTEX_NORMAL: {
-          float vertex[4];
-          sscanf(buffer, "%f %f %f %f",
-              &vertex[0], &vertex[1], &vertex[2], &vertex[3]);
-          line.data = vertex;
-          CALL_CALLBACK_IF(on_normal, &state, line);
-          break;
-        }
-
-        case SOP_DIRECTIVE_VERTEX: {
-          float vertex[4];
-          sscanf(buffer, "%f %f %f %f",
-              &vertex[0], &vertex[1], &vertex[2], &vertex[3]);
-          line.data = vertex;
-          CALL_CALLBACK_IF(on_vertex, &state, line);
-          break;
-        }
-
-        case SOP_DIRECTIVE_FACE: {
-          int maxfaces = 3;
-          int faces[3][maxfaces];
-
-          // vertex faces
-          int *vf = faces[0];
-          int x = 0;
-          // vertex texture faces
-          int *vtf = faces[1];
-          int y = 0;
-          // vertex normal faces
-          int *vnf = faces[2];
-          int z = 0;
-
-          for (int i = 0; i < maxfaces; i++) {
-            vf[i] = -1;
-            vtf[i] = -1;
-            vnf[i] = -1;
-          }
-
-          // current char buffer
-          size_t size = 0;
-          char buf[BUFSIZ];
-          memset(buf, 0, BUFSIZ);
-
-          // current face scope
-          enum { READ = 0, VERTEX, TEXTURE, NORMAL };
-          int scope = VERTEX;
-
-          for (int j = 0; j < bufsize; ++j) {
-            char c = buffer[j];
-
-            // skip white space at beginning of line
-            if (0 == size && ' ' == c) {
-              continue;
-            }
-
-            if (j == bufsize - 1) {
-              buf[size++] = c;
-              goto read_face_data;
-            }
-
-            switch (c) {
-              case '/':
-              case '\t':
-              case '\n':
-              case ' ':
-                goto read_face_data;
-
-              default:
-                buf[size++] = c;
-                continue;
-            }
-
-read_face_data:
-            switch (scope) {
-              case VERTEX:
-                sscanf(buf, "%d", &vf[x++]);
-                break;
-
-              case TEXTURE:
-                sscanf(buf, "%d", &vtf[y++]);
-                break;
-
-              case NORMAL:
-                sscanf(buf, "%d", &vnf[z++]);
-                break;
-            }
-
-            switch (c) {
-              case '/':
-                scope++;
-                break;
-
-              case '\n':
-              case '\t':
-              case ' ':
-                scope = VERTEX;
-                break;
-            }
-
-            memset(buf, 0, BUFSIZ);
-            size = 0;
-          }
-
-          line.data = faces;
-          CALL_CALLBACK_IF(on_face, &state, line)
-          break;
-        }
-
-        case SOP_DIRECTIVE_USE_MTL: {
-          line.data = (void *) buffer;
-          CALL_CALLBACK_IF(on_material_use, &state, line);
-          break;
-        }
-
-        case SOP_DIRECTIVE_MTL_LIB: {
-          line.data = (void *) buffer;
-          CALL_CALLBACK_IF(on_material_lib, &state, line);
-          break;
-        }
-
-        case SOP_DIRECTIVE_MATERIAL_NEW: {
-          line.data = (void *) buffer;
-          CALL_CALLBACK_IF(on_material_new, &state, line);
-          break;
-        }
-
-        case SOP_DIRECTIVE_MATERIAL_AMBIENT_COLOR: {
-          float color[4];
-          sscanf(buffer, "%f %f %f %f",
-                 &color[0], &color[1], &color[2], &color[3]);
-          line.data = color;
-          CALL_CALLBACK_IF(on_material_ambient, &state, line);
-          break;
-        }
-
-        case SOP_DIRECTIVE_MATERIAL_DIFFUSE_COLOR: {
-          float color[4];
-          sscanf(buffer, "%f %f %f %f",
-                 &color[0], &color[1], &color[2], &color[3]);
-          line.data = color;
-          CALL_CALLBACK_IF(on_material_diffuse, &state, line);
-          break;
-        }
-
-        case SOP_DIRECTIVE_MATERIAL_SPECULAR_COLOR: {
-          float color[4];
-          sscanf(buffer, "%f %f %f %f",
-                 &color[0], &color[1], &color[2], &color[3]);
-          line.data = color;
-          CALL_CALLBACK_IF(on_material_specular, &state, line);
-          break;
-        }
-
-        case SOP_DIRECTIVE_MATERIAL_ILLUM: {
-          unsigned int illum = 0;
-          sscanf(buffer, "%d", &illum);
-          line.data = &illum;
-          CALL_CALLBACK_IF(on_material_illum, &state, line);
-          break;
-        }
-
-        case SOP_DIRECTIVE_MATERIAL_SHININESS: {
-          unsigned int shininess = 0;
-          sscanf(buffer, "%d", &shininess);
-          line.data = &shininess;
-          CALL_CALLBACK_IF(on_material_shininess, &state, line);
-          break;
-        }
-
-        case SOP_DIRECTIVE_MATERIAL_TRANSPARENCY: {
-          unsigned int transparency = 0;
-          sscanf(buffer, "%d", &transparency);
-          line.data = &transparency;
-          CALL_CALLBACK_IF(on_material_transparency, &state, line);
-          break;
-        }
-
-        case SOP_DIRECTIVE_SMOOTH: {
-          int on = 1;
-          int off = 0;
-          if (strcmp(buffer, "on") >= 0) {
-            line.data = (int *) &on;
-          } else if (strcmp(buffer, "off") >= 0) {
-            line.data = (int *) &off;
-          } else {
-            return SOP_OOB;
-          }
-          CALL_CALLBACK_IF(on_smooth, &state, line);
-          break;
-        }
-
-        // notify of memory errors
-        case SOP_EMEM:
-          return SOP_EMEM;
-
-        // out of bounds if we get here for some reason
-        default:
-          return SOP_OOB;
+      cb = parser->callbacks.on_texture;
+      break;
+
+    case SOP_DIRECTIVE_VERTEX_NORMAL:
+      if (parser->callbacks.on_normals) {
+        return sop_context_push(ctx, record);
+      }
+      cb = parser->callbacks.on_normal;
+      break;
+
+    case SOP_DIRECTIVE_VERTEX:
+      if (parser->callbacks.on_vertices) {
+        return sop_context_push(ctx, record);
       }
+      cb = parser->callbacks.on_vertex;
+      break;
 
-      RESET_LINE_STATE;
-      continue;
+    case SOP_DIRECTIVE_FACE:
+      if (parser->callbacks.on_faces) {
+        return sop_context_push(ctx, record);
+      }
+      cb = parser->callbacks.on_face;
+      break;
+
+    case SOP_DIRECTIVE_USE_MTL:
+      cb = parser->callbacks.on_material_use;
+      string = 1;
+      break;
+
+    case SOP_DIRECTIVE_MTL_LIB:
+      cb = parser->callbacks.on_material_lib;
+      string = 1;
+      break;
+
+    case SOP_DIRECTIVE_MATERIAL_NEW:
+      cb = parser->callbacks.on_material_new;
+      string = 1;
+      break;
+
+    case SOP_DIRECTIVE_MATERIAL_AMBIENT_COLOR:
+      cb = parser->callbacks.on_material_ambient;
+      break;
+
+    case SOP_DIRECTIVE_MATERIAL_DIFFUSE_COLOR:
+      cb = parser->callbacks.on_material_diffuse;
+      break;
+
+    case SOP_DIRECTIVE_MATERIAL_SPECULAR_COLOR:
+      cb = parser->callbacks.on_material_specular;
+      break;
+
+    case SOP_DIRECTIVE_MATERIAL_ILLUM:
+      cb = parser->callbacks.on_material_illum;
+      break;
+
+    case SOP_DIRECTIVE_MATERIAL_SHININESS:
+      cb = parser->callbacks.on_material_shininess;
+      break;
+
+    case SOP_DIRECTIVE_MATERIAL_TRANSPARENCY:
+      cb = parser->callbacks.on_material_transparency;
+      break;
+
+    case SOP_DIRECTIVE_SMOOTH:
+      cb = parser->callbacks.on_smooth;
+      break;
+
+    case SOP_DIRECTIVE_VERTEX_PARAMETER:
+      cb = parser->callbacks.on_vertex_parameter;
+      break;
+
+    case SOP_DIRECTIVE_LINE:
+      cb = parser->callbacks.on_line;
+      break;
+
+    case SOP_DIRECTIVE_POINT:
+      cb = parser->callbacks.on_point;
+      break;
+
+    case SOP_DIRECTIVE_OBJECT:
+      cb = parser->callbacks.on_object;
+      string = 1;
+      break;
+
+    case SOP_DIRECTIVE_GROUP:
+      cb = parser->callbacks.on_group;
+      string = 1;
+      break;
+
+    case SOP_DIRECTIVE_MATERIAL_EMISSIVE_COLOR:
+      cb = parser->callbacks.on_material_emissive;
+      break;
+
+    case SOP_DIRECTIVE_MATERIAL_OPTICAL_DENSITY:
+      cb = parser->callbacks.on_material_density;
+      break;
+
+    case SOP_DIRECTIVE_MATERIAL_TRANSMISSION_FILTER:
+      cb = parser->callbacks.on_material_transmission;
+      break;
+
+    case SOP_DIRECTIVE_MATERIAL_MAP:
+      cb = parser->callbacks.on_material_map;
+      string = 1;
+      break;
+
+    // notify of memory errors
+    case SOP_EMEM:
+      return SOP_EMEM;
+
+    // out of bounds if we get here for some reason
+    default:
+      return SOP_OOB;
+  }
+
+  if (!cb) {
+    return SOP_EOK;
+  }
+
+  // keep batches in order with line callbacks
+  if (ctx->pending) {
+    rc = sop_context_flush(ctx);
+    if (SOP_EOK != rc) {
+      return rc;
     }
+  }
 
-    if (0 == colno) {
-      // v, vt, vn
-      if ('v' == ch0) {
-        if (' '== ch1) {
-          type = SOP_DIRECTIVE_VERTEX;
-          line.directive = "v";
-        } else if ('t' == ch1) {
-          type = SOP_DIRECTIVE_VERTEX_TEXTURE;
-          (void) i++;
-          line.directive = "vt";
-        } else if ('n' == ch1) {
-          type = SOP_DIRECTIVE_VERTEX_NORMAL;
-          (void) i++;
-          line.directive = "vn";
-        } else {
-          type = SOP_NULL;
-        }
-      } else if ('f' == ch0) {
-        type = SOP_DIRECTIVE_FACE;
-        line.directive = "f";
-      } else if ('#' == ch0) {
-        type = SOP_COMMENT;
-        line.directive = "#";
-      } else if ('u' == ch0) {
-        type = SOP_DIRECTIVE_USE_MTL;
-        line.directive = "usemtl";
-        i += 5; // 5 == strlen("usemtl") - 1;
-      } else if ('m' == ch0) {
-        type = SOP_DIRECTIVE_MTL_LIB;
-        line.directive = "mtllib";
-        i += 5; // 5 == strlen("mtllib") - 1;
-      } else if ('n' == ch0) {
-        type = SOP_DIRECTIVE_MATERIAL_NEW;
-        line.directive = "newmtl";
-        i += 5; // 5 == strlen("newmtl") - 1;
-      } else if ('i' == ch0) {
-        type = SOP_DIRECTIVE_MATERIAL_ILLUM;
-        line.directive = "illum";
-        i += 4; // 4 == strlen("illum") - 1;
-      } else if ('d' == ch0 || ('T' == ch0 && 'r' == ch1)) {
-        type = SOP_DIRECTIVE_MATERIAL_TRANSPARENCY;
-        if ('d' == ch0) {
-          line.directive = "d";
-        } else {
-          line.directive = "Tr";
-          (void) i++;
-        }
-      } else if ('N' == ch0 && 's' == ch1) {
-        type = SOP_DIRECTIVE_MATERIAL_SHININESS;
-        line.directive = "Ns";
-        (void) i++;
-      } else if ('K' == ch0) {
-        if ('a' == ch1) {
-          type = SOP_DIRECTIVE_MATERIAL_AMBIENT_COLOR;
-          line.directive = "Ka";
-        } else if ('d' == ch1) {
-          type = SOP_DIRECTIVE_MATERIAL_DIFFUSE_COLOR;
-          line.directive = "Kd";
-        } else if ('s' == ch1) {
-          type = SOP_DIRECTIVE_MATERIAL_SPECULAR_COLOR;
-          line.directive = "Ks";
-        } else {
-          type = SOP_NULL;
-          continue;
-        }
-
-        (void) i++;
-      } else if ('s' == ch0) {
-        type = SOP_DIRECTIVE_SMOOTH;
-        line.directive = "s";
-      } else {
-        switch (ch0) {
-          case '\n':
-            RESET_LINE_STATE;
-            continue;
-        }
+  ctx->line.type = record->type;
+  ctx->line.directive = record->directive;
+  ctx->line.lineno = record->lineno;
+  ctx->line.length = record->length;
+  ctx->line.data = (void *) &record->value;
+  ctx->line.material = SOP_DIRECTIVE_MATERIAL_NEW == record->type
+    ? ctx->defining
+    : ctx->material;
+
+  if (string) {
+    return sop_parser_dispatch_string(ctx, record, cb);
+  }
 
-        type = SOP_NULL;
-      }
-    } else {
-      if (0 == bufsize && ' ' == ch0) {
-        continue;
+  if (SOP_DIRECTIVE_FACE == record->type) {
+    return sop_parser_dispatch_face(ctx, record, cb);
+  }
+
+  if (SOP_DIRECTIVE_LINE == record->type ||
+      SOP_DIRECTIVE_POINT == record->type) {
+    const int (*corners)[3] = ctx->corners->data + record->value.face.offset;
+    return sop_parser_notify_corners(ctx, cb, corners,
+                                     record->value.face.count, 1);
+  }
+
+  return cb(&ctx->state, ctx->line);
+}
+
+int
+sop_parser_scan(sop_context_t *ctx,
+                const char *source,
+                size_t length,
+                size_t *lineno) {
+  sop_parser_stats_t *stats = SOP_STATS_ENABLED ? ctx->stats : 0;
+  uint64_t begin = sop_trace_begin(ctx->trace);
+  sop_scanner_t scanner;
+  sop_record_t record;
+  const char *span = 0;
+  size_t spansize = 0;
+  int rc = SOP_EOK;
+
+  sop_scanner_init(&scanner, source, length);
+
+  // the scanner hands us whole lines which are decoded and
+  // dispatched on their leading directive
+  ctx->corners = &ctx->decoded;
+
+  while (SOP_EOK == rc) {
+    const int sampled = stats && 0 == *lineno % SOP_STATS_SAMPLE;
+    uint64_t clock[4] = {0};
+    int decoded = 0;
+
+    if (sampled) { clock[0] = sop_clock_now(); }
+    if (!sop_scanner_next(&scanner, &span, &spansize)) {
+      break;
+    }
+
+    ++*lineno;
+    if (sampled) { clock[1] = sop_clock_now(); }
+
+    // corners of the previous line have been delivered or copied
+    ctx->decoded.count = 0;
+    decoded = sop_parser_decode(span, spansize, ctx->parser->directives,
+                                &record, &ctx->decoded);
+    if (sampled) { clock[2] = sop_clock_now(); }
+
+    if (decoded > 0) {
+      record.lineno = *lineno;
+      rc = sop_parser_dispatch(ctx, &record);
+    } else if (decoded < 0) {
+      rc = SOP_EMEM;
+    }
+
+    if (stats) {
+      if (sampled) {
+        clock[3] = sop_clock_now();
+        stats->scan_ns += (clock[1] - clock[0]) * SOP_STATS_SAMPLE;
+        stats->decode_ns += (clock[2] - clock[1]) * SOP_STATS_SAMPLE;
+        stats->callback_ns += (clock[3] - clock[2]) * SOP_STATS_SAMPLE;
       }
-      buffer[bufsize++] = ch0;
+      sop_stats_line(stats, span, spansize, *lineno, &record, decoded);
     }
+  }
+
+  // lines are scanned, decoded and dispatched one at a time here so
+  // the phases share a single event
+  sop_trace_end(ctx->trace, "parse", "parse", begin);
+  return rc;
+}
+
+int
+sop_parser_execute(sop_parser_t *parser,
+                   const char *source,
+                   size_t length) {
+  // handle poor state and input
+  if (!parser) {
+    return SOP_EMEM;
+  } else if (!source || 0 == length) {
+    return SOP_EINVALID_SOURCE;
+  }
 
-    colno++;
+  sop_trace_t *trace = parser->options->trace;
+  uint64_t begin = sop_trace_begin(trace);
+  int rc = SOP_EOK;
+
+  // large sources are decoded on worker threads when asked to
+  if (parser->options->threads > 1 &&
+      length >= 2 * SOP_PARSER_CHUNK_SIZE) {
+    rc = sop_parser_execute_parallel(parser, source, length);
+  } else {
+    sop_context_t ctx;
+    size_t lineno = 0;
+
+    sop_context_init(&ctx, parser);
+    rc = sop_parser_scan(&ctx, source, length, &lineno);
+    if (SOP_EOK == rc) {
+      rc = sop_context_finish(&ctx);
+    }
+
+    sop_context_destroy(&ctx);
   }
-  return SOP_EOK;
-#undef RESET_LINE_STATE
-#undef CALL_CALLBACK_IF
+
+  sop_trace_end(trace, "parse", "execute", begin);
+  return rc;
 }
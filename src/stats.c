@@ -0,0 +1,75 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdint.h>
+#include <time.h>
+#include <sop/sop.h>
+#include "internal.h"
+
+uint64_t
+sop_clock_now(void) {
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return (uint64_t) now.tv_sec * 1000000000 + (uint64_t) now.tv_nsec;
+}
+
+void
+sop_stats_line(sop_parser_stats_t *stats,
+               const char *span,
+               size_t size,
+               size_t lineno,
+               const sop_record_t *record,
+               int decoded) {
+  stats->lines++;
+  if (size > stats->longest) {
+    stats->longest = size;
+    stats->longest_lineno = lineno;
+  }
+
+  if (SOP_NULL == record->type) {
+    // sop_parser_decode() found nothing but white space or a directive
+    // it doesn't know
+    size_t i = 0;
+    while (i < size &&
+           (' ' == span[i] || '\t' == span[i] || '\r' == span[i])) {
+      i++;
+    }
+    if (i == size) {
+      stats->blank++;
+    } else {
+      stats->unknown++;
+    }
+    return;
+  }
+
+  if (record->type >= 0 && record->type < SOP_PARSER_STATS_TYPES) {
+    stats->directives[record->type]++;
+    stats->bytes[record->type] += size;
+  }
+
+  if (0 == decoded) {
+    stats->skipped++;
+  }
+}
+
+void
+sop_stats_merge(sop_parser_stats_t *stats,
+                const sop_parser_stats_t *from,
+                size_t lineno) {
+  stats->lines += from->lines;
+  if (from->longest > stats->longest) {
+    stats->longest = from->longest;
+    stats->longest_lineno = from->longest_lineno + lineno;
+  }
+
+  for (int i = 0; i < SOP_PARSER_STATS_TYPES; ++i) {
+    stats->directives[i] += from->directives[i];
+    stats->bytes[i] += from->bytes[i];
+  }
+
+  stats->blank += from->blank;
+  stats->unknown += from->unknown;
+  stats->skipped += from->skipped;
+  stats->scan_ns += from->scan_ns;
+  stats->decode_ns += from->decode_ns;
+  stats->callback_ns += from->callback_ns;
+}
@@ -0,0 +1,180 @@
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <sop/sop.h>
+#include "internal.h"
+
+/**
+ * State of a source fed in chunks.
+ */
+
+struct sop_parser_stream {
+  // dispatch state, batches survive between chunks
+  sop_context_t ctx;
+
+  // partial line carried over to the next chunk
+  char *carry;
+  size_t carrysize;
+  size_t carrycap;
+
+  // lines dispatched so far
+  size_t lineno;
+
+  // first error, sticky until the stream is finished
+  int rc;
+};
+
+/**
+ * Appends `length` bytes to the carried partial line.
+ */
+
+static int
+sop_stream_carry(struct sop_parser_stream *stream,
+                 const char *source,
+                 size_t length) {
+  if (0 == length) {
+    return SOP_EOK;
+  }
+
+  if (stream->carrysize + length > stream->carrycap) {
+    size_t capacity = stream->carrycap ? stream->carrycap : BUFSIZ;
+    char *carry = 0;
+    while (capacity < stream->carrysize + length) {
+      capacity *= 2;
+    }
+
+    carry = (char *) sop_realloc(stream->ctx.allocator,
+                                 stream->carry, capacity);
+    if (!carry) {
+      return SOP_EMEM;
+    }
+
+    stream->carry = carry;
+    stream->carrycap = capacity;
+  }
+
+  memcpy(stream->carry + stream->carrysize, source, length);
+  stream->carrysize += length;
+  return SOP_EOK;
+}
+
+/**
+ * Returns the offset just past the last newline of `source` or 0.
+ */
+
+static size_t
+sop_stream_complete(const char *source, size_t length) {
+  while (length > 0 && '\n' != source[length - 1]) {
+    --length;
+  }
+  return length;
+}
+
+int
+sop_parser_feed(sop_parser_t *parser,
+                const char *chunk,
+                size_t length) {
+  struct sop_parser_stream *stream = 0;
+  size_t complete = 0;
+
+  if (!parser) {
+    return SOP_EMEM;
+  } else if (!chunk && length > 0) {
+    return SOP_EINVALID_SOURCE;
+  }
+
+  if (!parser->stream) {
+    parser->stream = (struct sop_parser_stream *)
+      sop_calloc(parser->options->allocator,
+                 1, sizeof(struct sop_parser_stream));
+    if (!parser->stream) {
+      return SOP_EMEM;
+    }
+    sop_context_init(&parser->stream->ctx, parser);
+    parser->stream->rc = SOP_EOK;
+  }
+
+  stream = parser->stream;
+  if (SOP_EOK != stream->rc) {
+    return stream->rc;
+  }
+
+  // complete the carried line with the head of this chunk
+  if (stream->carrysize > 0) {
+    const char *nl = (const char *) memchr(chunk, '\n', length);
+    size_t head = nl ? (size_t) (nl - chunk) + 1 : length;
+
+    stream->rc = sop_stream_carry(stream, chunk, head);
+    if (SOP_EOK != stream->rc || !nl) {
+      return stream->rc;
+    }
+
+    stream->rc = sop_parser_scan(&stream->ctx,
+                                 stream->carry,
+                                 stream->carrysize,
+                                 &stream->lineno);
+    stream->carrysize = 0;
+    if (SOP_EOK != stream->rc) {
+      return stream->rc;
+    }
+
+    chunk += head;
+    length -= head;
+  }
+
+  // whole lines are scanned in place, the rest is carried
+  complete = sop_stream_complete(chunk, length);
+  if (complete > 0) {
+    stream->rc = sop_parser_scan(&stream->ctx,
+                                 chunk,
+                                 complete,
+                                 &stream->lineno);
+    if (SOP_EOK != stream->rc) {
+      return stream->rc;
+    }
+  }
+
+  stream->rc = sop_stream_carry(stream, chunk + complete, length - complete);
+  return stream->rc;
+}
+
+int
+sop_parser_finish(sop_parser_t *parser) {
+  struct sop_parser_stream *stream = 0;
+  int rc = SOP_EOK;
+
+  if (!parser) {
+    return SOP_EMEM;
+  } else if (!parser->stream) {
+    return SOP_EINVALID_SOURCE;
+  }
+
+  stream = parser->stream;
+  rc = stream->rc;
+
+  if (SOP_EOK == rc && stream->carrysize > 0) {
+    rc = sop_parser_scan(&stream->ctx,
+                         stream->carry,
+                         stream->carrysize,
+                         &stream->lineno);
+  }
+
+  if (SOP_EOK == rc) {
+    rc = sop_context_finish(&stream->ctx);
+  }
+
+  sop_parser_destroy(parser);
+  return rc;
+}
+
+void
+sop_parser_destroy(sop_parser_t *parser) {
+  if (!parser || !parser->stream) {
+    return;
+  }
+
+  sop_context_destroy(&parser->stream->ctx);
+  sop_free(parser->options->allocator, parser->stream->carry);
+  sop_free(parser->options->allocator, parser->stream);
+  parser->stream = 0;
+}
@@ -0,0 +1,230 @@
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <sop/sop.h>
+#include "internal.h"
+
+/**
+ * Events held by a single block of a thread buffer.
+ */
+
+#define SOP_TRACE_BLOCK_EVENTS 1024
+
+typedef struct sop_trace_event sop_trace_event_t;
+struct sop_trace_event {
+  const char *category;
+  const char *name;
+  uint64_t begin;
+  uint64_t end;
+};
+
+struct sop_trace_block {
+  struct sop_trace_block *next;
+  size_t count;
+  sop_trace_event_t events[SOP_TRACE_BLOCK_EVENTS];
+};
+
+/**
+ * Events of one thread. Only the owning thread appends to a buffer, a
+ * thread that reuses the id of a joined thread picks up its buffer.
+ */
+
+struct sop_trace_buffer {
+  struct sop_trace_buffer *next;
+  pthread_t thread;
+  int tid;
+
+  // blocks newest first
+  struct sop_trace_block *blocks;
+};
+
+/**
+ * Source of sop_trace.id.
+ */
+
+static uint64_t sop_trace_ids = 0;
+
+/**
+ * Buffer the calling thread used last, so recording into the same
+ * trace over and over skips the buffer lookup.
+ */
+
+static __thread struct {
+  const sop_trace_t *trace;
+  uint64_t id;
+  struct sop_trace_buffer *buffer;
+} sop_trace_cache;
+
+/**
+ * Finds or publishes the buffer of the calling thread. Returns 0 when
+ * out of memory.
+ */
+
+static struct sop_trace_buffer *
+sop_trace_buffer(sop_trace_t *trace) {
+  pthread_t self = pthread_self();
+  struct sop_trace_buffer *buffer = 0;
+
+  if (sop_trace_cache.trace == trace && sop_trace_cache.id == trace->id) {
+    return sop_trace_cache.buffer;
+  }
+
+  buffer = __atomic_load_n(&trace->buffers, __ATOMIC_ACQUIRE);
+  for (; buffer; buffer = buffer->next) {
+    if (pthread_equal(buffer->thread, self)) {
+      break;
+    }
+  }
+
+  if (!buffer) {
+    buffer = (struct sop_trace_buffer *)
+      sop_calloc(trace->allocator, 1, sizeof(struct sop_trace_buffer));
+    if (!buffer) {
+      return 0;
+    }
+
+    buffer->thread = self;
+    buffer->tid = __atomic_add_fetch(&trace->threads, 1, __ATOMIC_RELAXED);
+    buffer->next = __atomic_load_n(&trace->buffers, __ATOMIC_RELAXED);
+    while (!__atomic_compare_exchange_n(&trace->buffers, &buffer->next,
+                                        buffer, 1, __ATOMIC_RELEASE,
+                                        __ATOMIC_RELAXED)) { }
+  }
+
+  sop_trace_cache.trace = trace;
+  sop_trace_cache.id = trace->id;
+  sop_trace_cache.buffer = buffer;
+  return buffer;
+}
+
+void
+sop_trace_end(sop_trace_t *trace,
+              const char *category,
+              const char *name,
+              uint64_t begin) {
+  const uint64_t end = trace ? sop_clock_now() : 0;
+  struct sop_trace_buffer *buffer = 0;
+  struct sop_trace_block *block = 0;
+
+  if (!trace || !(buffer = sop_trace_buffer(trace))) {
+    return;
+  }
+
+  block = buffer->blocks;
+  if (!block || SOP_TRACE_BLOCK_EVENTS == block->count) {
+    block = (struct sop_trace_block *)
+      sop_alloc(trace->allocator, sizeof(struct sop_trace_block));
+    if (!block) {
+      return;
+    }
+    block->count = 0;
+    block->next = buffer->blocks;
+    buffer->blocks = block;
+  }
+
+  block->events[block->count].category = category;
+  block->events[block->count].name = name;
+  block->events[block->count].begin = begin;
+  block->events[block->count].end = end;
+  block->count++;
+}
+
+int
+sop_trace_init(sop_trace_t *trace, sop_allocator_t *allocator) {
+  if (!trace) {
+    return SOP_EMEM;
+  }
+
+  memset(trace, 0, sizeof(sop_trace_t));
+  trace->id = __atomic_add_fetch(&sop_trace_ids, 1, __ATOMIC_RELAXED);
+  trace->start = sop_clock_now();
+  trace->allocator = allocator;
+  return SOP_EOK;
+}
+
+/**
+ * Microseconds since the start of `trace`.
+ */
+
+static double
+sop_trace_us(const sop_trace_t *trace, uint64_t ns) {
+  return ns > trace->start ? (double) (ns - trace->start) / 1000.0 : 0;
+}
+
+int
+sop_trace_write(const sop_trace_t *trace, const char *path) {
+  const struct sop_trace_buffer *buffer = 0;
+  const char *separator = "\n";
+  FILE *file = 0;
+  int rc = SOP_EOK;
+
+  if (!trace || !path) {
+    return SOP_EINVALID_OPTIONS;
+  }
+
+  file = fopen(path, "w");
+  if (!file) {
+    return SOP_EINVALID_SOURCE;
+  }
+
+  fprintf(file, "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[");
+  for (buffer = trace->buffers; buffer; buffer = buffer->next) {
+    const struct sop_trace_block *block = buffer->blocks;
+
+    fprintf(file, "%s{\"ph\":\"M\",\"name\":\"thread_name\",\"pid\":1,"
+                  "\"tid\":%d,\"args\":{\"name\":\"thread %d\"}}",
+            separator, buffer->tid, buffer->tid);
+    separator = ",\n";
+
+    for (; block; block = block->next) {
+      for (size_t i = 0; i < block->count; ++i) {
+        const sop_trace_event_t *event = &block->events[i];
+        fprintf(file, ",\n{\"ph\":\"X\",\"cat\":\"%s\",\"name\":\"%s\","
+                      "\"pid\":1,\"tid\":%d,\"ts\":%.3f,\"dur\":%.3f}",
+                event->category, event->name, buffer->tid,
+                sop_trace_us(trace, event->begin),
+                (double) (event->end - event->begin) / 1000.0);
+      }
+    }
+  }
+  fprintf(file, "\n]}\n");
+
+  if (ferror(file)) {
+    rc = SOP_EMEM;
+  }
+
+  if (0 != fclose(file)) {
+    rc = SOP_EMEM;
+  }
+
+  return rc;
+}
+
+void
+sop_trace_destroy(sop_trace_t *trace) {
+  struct sop_trace_buffer *buffer = 0;
+
+  if (!trace) {
+    return;
+  }
+
+  buffer = trace->buffers;
+  while (buffer) {
+    struct sop_trace_buffer *next = buffer->next;
+    struct sop_trace_block *block = buffer->blocks;
+    while (block) {
+      struct sop_trace_block *following = block->next;
+      sop_free(trace->allocator, block);
+      block = following;
+    }
+    sop_free(trace->allocator, buffer);
+    buffer = next;
+  }
+
+  // threads still caching a buffer of this trace must not find it
+  trace->buffers = 0;
+  trace->threads = 0;
+  trace->id = __atomic_add_fetch(&sop_trace_ids, 1, __ATOMIC_RELAXED);
+}
@@ -0,0 +1,155 @@
+#include <stdlib.h>
+#include <assert.h>
+#include <string.h>
+#include <stdio.h>
+
+#include <sop/sop.h>
+#include <ok/ok.h>
+#include <fs/fs.h>
+
+#include "test.h"
+
+static int
+on_faces(const sop_parser_state_t *state,
+         const sop_parser_batch_t *batch);
+
+static struct {
+  size_t allocations;
+  size_t outstanding;
+  size_t faces;
+} TestState;
+
+static void ResetTestState(void) {
+  memset(&TestState, 0, sizeof(TestState));
+}
+
+// counts allocations made through the hooks
+static void *
+counting_allocate(void *data, size_t size) {
+  __atomic_add_fetch(&TestState.allocations, 1, __ATOMIC_RELAXED);
+  __atomic_add_fetch(&TestState.outstanding, 1, __ATOMIC_RELAXED);
+  return malloc(size);
+}
+
+static void *
+counting_reallocate(void *data, void *ptr, size_t size) {
+  if (!ptr) {
+    return counting_allocate(data, size);
+  }
+  return realloc(ptr, size);
+}
+
+static void
+counting_deallocate(void *data, void *ptr) {
+  if (ptr) {
+    __atomic_sub_fetch(&TestState.outstanding, 1, __ATOMIC_RELAXED);
+    free(ptr);
+  }
+}
+
+static sop_allocator_t counting = {
+  .allocate = counting_allocate,
+  .reallocate = counting_reallocate,
+  .deallocate = counting_deallocate,
+};
+
+TEST(arena) {
+  const char *src = fs_read("fixtures/teapot.obj");
+  sop_mesh_options_t meshopts = { .weld = 1 };
+  sop_materials_t materials = { .allocator = &counting };
+  sop_parser_options_t options = {
+    .materials = &materials,
+    .allocator = &counting,
+    .callbacks = {
+      .on_faces = on_faces,
+    }
+  };
+  sop_allocator_t *allocator = 0;
+  sop_parser_t parser;
+  sop_arena_t arena;
+  sop_mesh_t mesh;
+  char *a = 0;
+  char *b = 0;
+  char *c = 0;
+  char *first = 0;
+
+  assert(SOP_EOK == sop_arena_init(&arena, 4096));
+  allocator = &arena.allocator;
+
+  a = first = (char *) allocator->allocate(allocator->data, 100);
+  b = (char *) allocator->allocate(allocator->data, 100);
+  assert(a && b && a != b);
+  assert(0 == ((size_t) a & 15) && 0 == ((size_t) b & 15));
+  memset(b, 'b', 100);
+  c = (char *) allocator->reallocate(allocator->data, b, 1000);
+  assert(b == c && 'b' == c[99]);
+  c = (char *) allocator->reallocate(allocator->data, a, 200);
+  assert(a != c);
+  allocator->deallocate(allocator->data, c);
+  c = (char *) allocator->allocate(allocator->data, 64);
+  assert(c);
+  ok("arena: latest allocations grow and free in place");
+
+  a = (char *) allocator->allocate(allocator->data, 100000);
+  memset(a, 'a', 100000);
+  b = (char *) allocator->allocate(allocator->data, 16);
+  assert(a && b && 'a' == a[99999]);
+  // the current block kept serving small allocations
+  assert(b == c + 64 + 16);
+  sop_arena_reset(&arena);
+  assert(0 == arena.used);
+  assert(first == allocator->allocate(allocator->data, 100));
+  ok("arena: large allocations and reset");
+
+  meshopts.allocator = allocator;
+  assert(SOP_EOK == sop_mesh_init(&mesh, &meshopts));
+  assert(SOP_EOK == sop_mesh_load(src, strlen(src), &mesh));
+  assert(3644 == mesh.position_count && 6320 == mesh.face_count);
+  assert(mesh.weld.vertex_count > 0 && arena.used > 0);
+  sop_mesh_destroy(&mesh);
+  sop_arena_reset(&arena);
+  sop_arena_destroy(&arena);
+  assert(0 == arena.blocks);
+  ok("arena: meshes load into an arena");
+
+  ResetTestState();
+  assert(SOP_EOK == sop_parser_init(&parser, &options));
+  assert(SOP_EOK == sop_parser_execute(&parser, src, strlen(src)));
+  assert(6320 == TestState.faces);
+  assert(TestState.allocations > 0 && 0 == TestState.outstanding);
+
+  TestState.faces = 0;
+  for (size_t i = 0; i < strlen(src); i += 1000) {
+    size_t n = strlen(src) - i < 1000 ? strlen(src) - i : 1000;
+    assert(SOP_EOK == sop_parser_feed(&parser, src + i, n));
+  }
+  assert(SOP_EOK == sop_parser_finish(&parser));
+  assert(6320 == TestState.faces && 0 == TestState.outstanding);
+
+  assert(0 == sop_materials_intern(&materials, "red", 3));
+  assert(TestState.outstanding > 0);
+  sop_materials_destroy(&materials);
+  assert(0 == TestState.outstanding && &counting == materials.allocator);
+  ok("arena: parser memory goes through the hooks");
+
+  {
+    // character devices are read rather than mapped
+    sop_reader_options_t readeropts = { .allocator = &counting };
+    sop_reader_t reader;
+    ResetTestState();
+    assert(SOP_EINVALID_SOURCE ==
+           sop_reader_init_file(&reader, "/dev/null", &readeropts));
+    assert(TestState.allocations > 0 && 0 == TestState.outstanding);
+  }
+  ok("arena: unmappable reader sources go through the hooks");
+
+  ok_done();
+  return 0;
+}
+
+static int
+on_faces(const sop_parser_state_t *state,
+         const sop_parser_batch_t *batch) {
+  TestState.faces += batch->count;
+  return SOP_EOK;
+}
@@ -0,0 +1,165 @@
+#include <stdlib.h>
+#include <assert.h>
+#include <string.h>
+#include <stdio.h>
+
+#include <sop/sop.h>
+#include <ok/ok.h>
+#include <fs/fs.h>
+
+#include "test.h"
+
+static int
+on_vertices(const sop_parser_state_t *state,
+            const sop_parser_batch_t *batch);
+
+static int
+on_faces(const sop_parser_state_t *state,
+         const sop_parser_batch_t *batch);
+
+static int
+on_material_use(const sop_parser_state_t *state,
+                const sop_parser_line_state_t line);
+
+static sop_parser_t parser;
+static sop_parser_options_t options = {
+  .batch_size = 100,
+  .callbacks = {
+    .on_material_use = on_material_use,
+    .on_vertices = on_vertices,
+    .on_faces = on_faces,
+  }
+};
+
+static struct {
+  struct {
+    int batches;
+    int vertices;
+    int faces;
+    int materials;
+  } counters;
+  size_t lastlineno;
+  size_t facelineno;
+  int facevertices;
+} TestState;
+
+static void ResetTestState(void) {
+  memset(&TestState, 0, sizeof(TestState));
+}
+
+TEST(batch) {
+  ResetTestState();
+
+  const char *src = fs_read("fixtures/teapot.obj");
+
+  assert(SOP_EOK == sop_parser_init(&parser, &options));
+  ok("batch: sop_parser_init");
+  assert(SOP_EOK == sop_parser_execute(&parser, src, strlen(src)));
+  ok("batch: sop_parser_exec");
+
+  assert(3644 == TestState.counters.vertices);
+  ok("batch: vertices parsed");
+
+  assert(6320 == TestState.counters.faces);
+  ok("batch: faces parsed");
+
+  assert((3644 + 99) / 100 + (6320 + 99) / 100 == TestState.counters.batches);
+  ok("batch: batches are filled up to batch_size");
+
+  ResetTestState();
+
+  const char *mixed = ""
+    "v 0 0 0\n"
+    "v 1 0 0\n"
+    "v 0 1 0\n"
+    "f 1 2 3\n"
+    "usemtl red\n"
+    "v 1 1 0\n"
+    "f 2/1 4/2 3/3\n"
+    "f -1//1 -2//1 -3//1\n"
+    "f 123456789/12345678/1 -20000000//7 4\t\n"
+    "";
+
+  assert(SOP_EOK == sop_parser_execute(&parser, mixed, strlen(mixed)));
+  assert(4 == TestState.counters.vertices);
+  assert(4 == TestState.counters.faces);
+  assert(1 == TestState.counters.materials);
+  assert(4 == TestState.counters.batches);
+  ok("batch: batches stay in order with line callbacks");
+
+  {
+    // 3 vertices, a face, then more vertices than fit a batch
+    char split[2048];
+    char *p = split;
+    for (int i = 0; i < 3; ++i) { p += sprintf(p, "v 0 0 0\n"); }
+    p += sprintf(p, "f -3 -2 -1\n");
+    for (int i = 0; i < 150; ++i) { p += sprintf(p, "v 1 1 1\n"); }
+
+    ResetTestState();
+    assert(SOP_EOK == sop_parser_execute(&parser, split, strlen(split)));
+    assert(153 == TestState.counters.vertices);
+    assert(1 == TestState.counters.faces);
+    assert(3 == TestState.facevertices);
+  }
+  ok("batch: faces arrive before the attributes that follow them");
+
+  ok_done();
+  return 0;
+}
+
+static int
+on_vertices(const sop_parser_state_t *state,
+            const sop_parser_batch_t *batch) {
+  const float (*vertices)[4] = (const float (*)[4]) batch->data;
+  assert(SOP_DIRECTIVE_VERTEX == batch->type);
+  assert(batch->count > 0 && batch->count <= 100);
+  assert(batch->lineno > TestState.lastlineno);
+  for (size_t i = 0; i < batch->count; ++i) {
+    assert(1 == vertices[i][3]);
+  }
+  TestState.lastlineno = batch->lineno;
+  TestState.counters.vertices += (int) batch->count;
+  TestState.counters.batches++;
+  return SOP_EOK;
+}
+
+static int
+on_faces(const sop_parser_state_t *state,
+         const sop_parser_batch_t *batch) {
+  const int (*corners)[3] = (const int (*)[3]) batch->data;
+  assert(SOP_DIRECTIVE_FACE == batch->type);
+  assert(batch->count > 0 && batch->count <= 100);
+  assert(batch->lineno > TestState.lastlineno);
+  assert(0 == batch->offsets[0]);
+  for (size_t i = 0; i < batch->count; ++i) {
+    assert(3 == batch->offsets[i + 1] - batch->offsets[i]);
+  }
+
+  if (TestState.counters.materials) {
+    // f 2/1 4/2 3/3
+    assert(2 == corners[0][0] && 1 == corners[0][1] && 0 == corners[0][2]);
+    assert(4 == corners[1][0] && 2 == corners[1][1]);
+    // f -1//1 -2//1 -3//1
+    assert(-1 == corners[3][0] && 0 == corners[3][1] && 1 == corners[3][2]);
+    assert(-3 == corners[5][0]);
+    // f 123456789/12345678/1 -20000000//7 4
+    assert(123456789 == corners[6][0] && 12345678 == corners[6][1]);
+    assert(-20000000 == corners[7][0] && 7 == corners[7][2]);
+    assert(4 == corners[8][0] && 0 == corners[8][1] && 0 == corners[8][2]);
+  }
+
+  TestState.lastlineno = batch->lineno;
+  TestState.facevertices = TestState.counters.vertices;
+  TestState.counters.faces += (int) batch->count;
+  TestState.counters.batches++;
+  return SOP_EOK;
+}
+
+static int
+on_material_use(const sop_parser_state_t *state,
+                const sop_parser_line_state_t line) {
+  // the first face batch must have been delivered
+  assert(1 == TestState.counters.faces);
+  TestState.counters.materials++;
+  return SOP_EOK;
+}
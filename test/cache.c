@@ -0,0 +1,168 @@
+#include <stdlib.h>
+#include <assert.h>
+#include <stdint.h>
+#include <string.h>
+#include <stdio.h>
+
+#include <sop/sop.h>
+#include <ok/ok.h>
+#include <fs/fs.h>
+
+#include "test.h"
+
+#define SOURCE "/tmp/sop-cache-test.obj"
+#define CACHE "/tmp/sop-cache-test.obj.sopb"
+
+static void
+write_file(const char *path, const char *data, size_t size) {
+  FILE *file = fopen(path, "wb");
+  assert(file);
+  assert(size == fwrite(data, 1, size, file));
+  fclose(file);
+}
+
+/**
+ * Overwrites `size` bytes at `at` bytes into the first cache block of
+ * `type`, or into its directory entry when `entry` is set. Mirrors the
+ * layout in src/cache.c.
+ */
+
+static void
+patch_cache(uint32_t type, int entry, size_t at,
+            const void *data, size_t size) {
+  FILE *file = fopen(CACHE, "r+b");
+  uint32_t blocks = 0;
+  assert(file);
+  assert(0 == fseek(file, 40, SEEK_SET));
+  assert(1 == fread(&blocks, sizeof(blocks), 1, file));
+  for (uint32_t i = 0; i < blocks; ++i) {
+    const long position = 48 + 24 * (long) i;
+    uint32_t found = 0;
+    uint64_t offset = 0;
+    assert(0 == fseek(file, position, SEEK_SET));
+    assert(1 == fread(&found, sizeof(found), 1, file));
+    assert(0 == fseek(file, position + 16, SEEK_SET));
+    assert(1 == fread(&offset, sizeof(offset), 1, file));
+    if (type == found) {
+      assert(0 == fseek(file, (entry ? position : (long) offset) + at,
+                        SEEK_SET));
+      assert(size == fwrite(data, 1, size, file));
+      break;
+    }
+  }
+  fclose(file);
+}
+
+static void
+assert_same(const sop_mesh_t *a, const sop_mesh_t *b) {
+  assert(a->position_count == b->position_count);
+  assert(a->texcoord_count == b->texcoord_count);
+  assert(a->normal_count == b->normal_count);
+  assert(a->index_count == b->index_count);
+  assert(a->face_count == b->face_count);
+  assert(0 == memcmp(a->positions, b->positions,
+                     3 * a->position_count * sizeof(float)));
+  assert(0 == memcmp(a->position_indices, b->position_indices,
+                     a->index_count * sizeof(int)));
+  assert(0 == memcmp(a->normal_indices, b->normal_indices,
+                     a->index_count * sizeof(int)));
+  assert(0 == memcmp(a->face_offsets, b->face_offsets,
+                     (a->face_count + 1) * sizeof(size_t)));
+}
+
+TEST(cache) {
+  const char *src = fs_read("fixtures/teapot.obj");
+  sop_mesh_options_t options = { .weld = 1 };
+  sop_mesh_t expected;
+  sop_mesh_t mesh;
+
+  remove(CACHE);
+  write_file(SOURCE, src, strlen(src));
+
+  assert(SOP_EOK == sop_mesh_init(&expected, &options));
+  assert(SOP_EOK == sop_mesh_load(src, strlen(src), &expected));
+
+  assert(SOP_EOK == sop_mesh_init(&mesh, &options));
+  assert(SOP_EOK == sop_mesh_load_file(SOURCE, 0, &mesh));
+  assert(0 == mesh.mapping);
+  assert_same(&expected, &mesh);
+  sop_mesh_destroy(&mesh);
+  {
+    FILE *cache = fopen(CACHE, "rb");
+    assert(cache);
+    fclose(cache);
+  }
+  ok("cache: first load parses and writes the cache");
+
+  assert(SOP_EOK == sop_mesh_load_file(SOURCE, 0, &mesh));
+  assert(0 != mesh.mapping);
+  assert(mesh.external);
+  assert_same(&expected, &mesh);
+  assert(expected.weld.vertex_count == mesh.weld.vertex_count);
+  assert(expected.weld.stride == mesh.weld.stride);
+  assert(expected.weld.index_size == mesh.weld.index_size);
+  assert(0 == memcmp(expected.weld.indices, mesh.weld.indices,
+                     mesh.index_count * mesh.weld.index_size));
+  mesh.positions[0] = 42;
+  sop_mesh_destroy(&mesh);
+  assert(0 == mesh.mapping && 0 == mesh.positions);
+  ok("cache: matching cache is mapped");
+
+  options.weld = 0;
+  assert(SOP_EOK == sop_mesh_load_file(SOURCE, 0, &mesh));
+  assert(0 == mesh.mapping);
+  sop_mesh_destroy(&mesh);
+  assert(SOP_EOK == sop_mesh_load_file(SOURCE, 0, &mesh));
+  assert(0 != mesh.mapping);
+  assert(0 == mesh.weld.vertices);
+  sop_mesh_destroy(&mesh);
+  ok("cache: other options regenerate the cache");
+
+  write_file(SOURCE, "v 0 0 0\nv 1 0 0\nv 0 1 0\nf 1 2 3\n", 32);
+  assert(SOP_EOK == sop_mesh_load_file(SOURCE, 0, &mesh));
+  assert(0 == mesh.mapping);
+  assert(3 == mesh.position_count && 1 == mesh.face_count);
+  sop_mesh_destroy(&mesh);
+  ok("cache: edited sources regenerate the cache");
+
+  write_file(CACHE, "SOPB", 4);
+  assert(SOP_EOK == sop_mesh_load_file(SOURCE, 0, &mesh));
+  assert(0 == mesh.mapping);
+  assert(3 == mesh.position_count);
+  sop_mesh_destroy(&mesh);
+  assert(SOP_EOK == sop_mesh_load_file(SOURCE, 0, &mesh));
+  assert(0 != mesh.mapping);
+  assert(3 == mesh.position_count);
+  assert(1 == mesh.positions[3]);
+  sop_mesh_destroy(&mesh);
+  ok("cache: broken caches are rewritten");
+
+  {
+    // block types 4 and 5 are the position and texcoord indices
+    const int index = 99;
+    const uint64_t count = 0;
+
+    patch_cache(4, 0, sizeof(int), &index, sizeof(index));
+    assert(SOP_EOK == sop_mesh_load_file(SOURCE, 0, &mesh));
+    assert(0 == mesh.mapping);
+    assert(1 == mesh.position_indices[1]);
+    sop_mesh_destroy(&mesh);
+    assert(SOP_EOK == sop_mesh_load_file(SOURCE, 0, &mesh));
+    assert(0 != mesh.mapping);
+    assert(1 == mesh.position_indices[1]);
+    sop_mesh_destroy(&mesh);
+
+    patch_cache(5, 1, 8, &count, sizeof(count));
+    assert(SOP_EOK == sop_mesh_load_file(SOURCE, 0, &mesh));
+    assert(0 == mesh.mapping);
+    assert(3 == mesh.index_count);
+    sop_mesh_destroy(&mesh);
+  }
+  ok("cache: inconsistent caches are rejected");
+
+  sop_mesh_destroy(&expected);
+  remove(SOURCE);
+  remove(CACHE);
+  ok_done();
+  return 0;
+}
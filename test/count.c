@@ -0,0 +1,86 @@
+#include <stdlib.h>
+#include <assert.h>
+#include <string.h>
+#include <stdio.h>
+
+#include <sop/sop.h>
+#include <ok/ok.h>
+#include <fs/fs.h>
+
+#include "test.h"
+
+TEST(count) {
+  sop_parser_counts_t counts;
+  sop_mesh_options_t options = { .triangulate = 1 };
+  sop_mesh_t mesh;
+  const char *src = fs_read("fixtures/teapot.obj");
+
+  assert(SOP_EOK == sop_parser_count(src, strlen(src), &counts));
+  assert(3644 == counts.vertices);
+  assert(0 == counts.textures && 0 == counts.normals);
+  assert(6320 == counts.faces);
+  assert(3 * 6320 == counts.corners);
+  assert(6320 == counts.triangles);
+  ok("count: teapot counted");
+
+  const char *polygons = ""
+    "mtllib cube.mtl\n"
+    "o cube\n"
+    "v 0 0 0\n"
+    "v 1 0 0\n"
+    "v 1 1 0\n"
+    "v 0 1 0\n"
+    "vt 0 0\n"
+    "vn 0 0 1\n"
+    "g front\n"
+    "usemtl red\n"
+    "f 1/1/1 2/1/1  3/1/1\t4/1/1\n"
+    "usemtl blue\n"
+    "f 1 2 3\n"
+    "";
+
+  assert(SOP_EOK == sop_parser_count(polygons, strlen(polygons), &counts));
+  assert(4 == counts.vertices);
+  assert(1 == counts.textures && 1 == counts.normals);
+  assert(2 == counts.faces && 7 == counts.corners && 3 == counts.triangles);
+  assert(2 == counts.groups);
+  assert(2 == counts.materials);
+  ok("count: polygons, groups and materials counted");
+
+  {
+    float positions[4 * 3];
+    float texcoords[1 * 2];
+    float normals[1 * 3];
+    int indices[3][3 * 3];
+    size_t offsets[3 + 1];
+
+    assert(SOP_EOK == sop_mesh_init(&mesh, &options));
+    mesh.external = 1;
+    mesh.positions = positions;
+    mesh.texcoords = texcoords;
+    mesh.normals = normals;
+    mesh.position_indices = indices[0];
+    mesh.texcoord_indices = indices[1];
+    mesh.normal_indices = indices[2];
+    mesh.face_offsets = offsets;
+    mesh.capacity.positions = counts.vertices;
+    mesh.capacity.texcoords = counts.textures;
+    mesh.capacity.normals = counts.normals;
+    mesh.capacity.indices = 3 * counts.triangles;
+    mesh.capacity.faces = counts.triangles + 1;
+
+    assert(SOP_EOK == sop_mesh_load(polygons, strlen(polygons), &mesh));
+    assert(positions == mesh.positions && 4 == mesh.position_count);
+    assert(indices[0] == mesh.position_indices && 9 == mesh.index_count);
+    assert(3 == mesh.face_count && 9 == offsets[3]);
+    assert(1 == positions[3] && 1 == normals[2]);
+    ok("count: mesh loads into exactly sized caller buffers");
+
+    assert(SOP_OOB == sop_mesh_load(polygons, strlen(polygons), &mesh));
+    sop_mesh_destroy(&mesh);
+    ok("count: full caller buffers are not grown");
+  }
+
+  ok_done();
+  return 0;
+}
@@ -0,0 +1,192 @@
+#include <stdlib.h>
+#include <assert.h>
+#include <string.h>
+#include <stdio.h>
+
+#include <sop/sop.h>
+#include <ok/ok.h>
+
+#include "test.h"
+
+static int
+on_line(const sop_parser_state_t *state,
+        const sop_parser_line_state_t line);
+
+static sop_parser_t parser;
+static sop_parser_options_t options = {
+  .callbacks = {
+    .on_material_transparency = on_line,
+    .on_material_shininess = on_line,
+    .on_material_specular = on_line,
+    .on_material_ambient = on_line,
+    .on_material_diffuse = on_line,
+    .on_material_illum = on_line,
+    .on_material_lib = on_line,
+    .on_material_use = on_line,
+    .on_material_new = on_line,
+    .on_texture = on_line,
+    .on_comment = on_line,
+    .on_vertex = on_line,
+    .on_normal = on_line,
+    .on_smooth = on_line,
+    .on_face = on_line,
+    .on_vertex_parameter = on_line,
+    .on_line = on_line,
+    .on_point = on_line,
+    .on_object = on_line,
+    .on_group = on_line,
+    .on_material_emissive = on_line,
+    .on_material_density = on_line,
+    .on_material_transmission = on_line,
+    .on_material_map = on_line,
+  }
+};
+
+static const char *keywords[] = {
+  "v", "vt", "vn", "vp", "f", "l", "p", "o", "g", "s", "usemtl", "mtllib",
+  "newmtl", "Ka", "Kd", "Ks", "Ke", "Ns", "Ni", "d", "Tr", "Tf", "illum",
+  "map_Ka", "map_Kd", "map_Ks", "map_Ke", "map_Ns", "map_d", "map_Tr",
+  "map_bump", "map_Bump", "bump", "disp", "decal", "refl", "norm",
+};
+
+#define KEYWORDS (sizeof(keywords) / sizeof(keywords[0]))
+
+static struct {
+  int lines;
+  char directives[64][16];
+  sop_enum_t types[64];
+  char strings[64][64];
+  float floats[64][4];
+  int corners[64][4][3];
+  size_t lengths[64];
+} TestState;
+
+static void ResetTestState(void) {
+  memset(&TestState, 0, sizeof(TestState));
+}
+
+TEST(directives) {
+  char src[4096];
+  size_t length = 0;
+
+  ResetTestState();
+  for (size_t i = 0; i < KEYWORDS; ++i) {
+    length += (size_t) sprintf(src + length, "%s 1 2 3\n", keywords[i]);
+  }
+
+  assert(SOP_EOK == sop_parser_init(&parser, &options));
+  assert(SOP_EOK == sop_parser_execute(&parser, src, length));
+  assert(KEYWORDS == (size_t) TestState.lines);
+  for (size_t i = 0; i < KEYWORDS; ++i) {
+    assert(0 == strcmp(keywords[i], TestState.directives[i]));
+    assert(SOP_NULL != TestState.types[i]);
+  }
+  ok("directives: every keyword resolves");
+
+  ResetTestState();
+  strcpy(src,
+         "foo 1 2 3\n"
+         "fo 1 2 3\n"
+         "vx 1 2 3\n"
+         "map_Kd_extra a.png\n"
+         "curv 0 1 1 2\n"
+         "\v 1\n"
+         "v 1 2 3\n");
+  assert(SOP_EOK == sop_parser_execute(&parser, src, strlen(src)));
+  assert(1 == TestState.lines);
+  assert(SOP_DIRECTIVE_VERTEX == TestState.types[0]);
+  ok("directives: unknown directives are skipped");
+
+  ResetTestState();
+  strcpy(src,
+         "o teapot\n"
+         "g body lid\n"
+         "vp 0.5 0.25\n"
+         "l 1/1 2/2 3/3\n"
+         "p 4\n"
+         "Ni 1.45\n"
+         "Ke 0.5 0.25 0\n"
+         "map_Kd -s 2 2 1 wood.png\n"
+         "#tight comment\n"
+         "map_bump\n");
+  assert(SOP_EOK == sop_parser_execute(&parser, src, strlen(src)));
+  assert(9 == TestState.lines);
+
+  assert(SOP_DIRECTIVE_OBJECT == TestState.types[0]);
+  assert(0 == strcmp("teapot", TestState.strings[0]));
+  assert(SOP_DIRECTIVE_GROUP == TestState.types[1]);
+  assert(0 == strcmp("body lid", TestState.strings[1]));
+
+  assert(SOP_DIRECTIVE_VERTEX_PARAMETER == TestState.types[2]);
+  assert(0.5f == TestState.floats[2][0] && 0.25f == TestState.floats[2][1]);
+  assert(1 == TestState.floats[2][2]);
+
+  assert(SOP_DIRECTIVE_LINE == TestState.types[3]);
+  assert(3 == TestState.lengths[3]);
+  assert(1 == TestState.corners[3][0][0] && -1 == TestState.corners[3][0][2]);
+  assert(2 == TestState.corners[3][1][1] && 3 == TestState.corners[3][2][0]);
+
+  assert(SOP_DIRECTIVE_POINT == TestState.types[4]);
+  assert(1 == TestState.lengths[4] && 4 == TestState.corners[4][0][0]);
+
+  assert(SOP_DIRECTIVE_MATERIAL_OPTICAL_DENSITY == TestState.types[5]);
+  assert(1.45f == TestState.floats[5][0]);
+
+  assert(SOP_DIRECTIVE_MATERIAL_EMISSIVE_COLOR == TestState.types[6]);
+  assert(0.25f == TestState.floats[6][1] && 1 == TestState.floats[6][3]);
+
+  assert(SOP_DIRECTIVE_MATERIAL_MAP == TestState.types[7]);
+  assert(0 == strcmp("map_Kd", TestState.directives[7]));
+  assert(0 == strcmp("-s 2 2 1 wood.png", TestState.strings[7]));
+
+  assert(SOP_COMMENT == TestState.types[8]);
+  assert(0 == strcmp("tight comment", TestState.strings[8]));
+  ok("directives: objects, groups, lines, points and material maps");
+
+  ok_done();
+  return 0;
+}
+
+static int
+on_line(const sop_parser_state_t *state,
+        const sop_parser_line_state_t line) {
+  int i = TestState.lines++;
+
+  strncpy(TestState.directives[i], line.directive, 15);
+  TestState.types[i] = line.type;
+  TestState.lengths[i] = line.length;
+
+  switch (line.type) {
+    case SOP_COMMENT:
+    case SOP_DIRECTIVE_OBJECT:
+    case SOP_DIRECTIVE_GROUP:
+    case SOP_DIRECTIVE_MATERIAL_MAP:
+      strncpy(TestState.strings[i], (const char *) line.data, 63);
+      break;
+
+    case SOP_DIRECTIVE_LINE:
+    case SOP_DIRECTIVE_POINT: {
+      const int *rows = (const int *) line.data;
+      for (size_t j = 0; j < line.length && j < 4; ++j) {
+        for (int k = 0; k < 3; ++k) {
+          TestState.corners[i][j][k] = rows[k * line.length + j];
+        }
+      }
+      for (size_t j = line.length; j < 4; ++j) {
+        TestState.corners[i][j][0] = -1;
+      }
+      break;
+    }
+
+    case SOP_DIRECTIVE_VERTEX_PARAMETER:
+    case SOP_DIRECTIVE_MATERIAL_OPTICAL_DENSITY:
+    case SOP_DIRECTIVE_MATERIAL_EMISSIVE_COLOR:
+      memcpy(TestState.floats[i], line.data, sizeof(TestState.floats[i]));
+      break;
+
+    default:
+      break;
+  }
+
+  return SOP_EOK;
+}
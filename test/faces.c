@@ -0,0 +1,188 @@
+#include <stdlib.h>
+#include <assert.h>
+#include <limits.h>
+#include <string.h>
+#include <stdio.h>
+
+#include <sop/sop.h>
+#include <ok/ok.h>
+
+#include "test.h"
+
+static int
+on_face(const sop_parser_state_t *state,
+        const sop_parser_line_state_t line);
+
+static int
+on_faces(const sop_parser_state_t *state,
+         const sop_parser_batch_t *batch);
+
+static sop_parser_t parser;
+static sop_parser_options_t options = {
+  .callbacks = {
+    .on_face = on_face,
+  }
+};
+
+static struct {
+  int faces;
+  size_t corners;
+} TestState;
+
+static void ResetTestState(void) {
+  memset(&TestState, 0, sizeof(TestState));
+}
+
+static const char *polygons = ""
+  "v 0 0 0\n"
+  "v 2 0 0\n"
+  "v 2 2 0\n"
+  "v 1 1 0\n"
+  "v 0 2 0\n"
+  "vn 0 0 1\n"
+  "f 1//1 2//1 3//1 4//1 5//1\n"
+  "f 1 2 3 5\n"
+  "";
+
+/**
+ * Area of the triangles of a mesh in the z = 0 plane.
+ */
+
+static float
+area(const sop_mesh_t *mesh) {
+  float sum = 0;
+  for (size_t i = 0; i < mesh->face_count; ++i) {
+    const int *v = mesh->position_indices + mesh->face_offsets[i];
+    const float *a = mesh->positions + 3 * v[0];
+    const float *b = mesh->positions + 3 * v[1];
+    const float *c = mesh->positions + 3 * v[2];
+    float twice = (b[0] - a[0]) * (c[1] - a[1]) - (b[1] - a[1]) * (c[0] - a[0]);
+    assert(twice > 0);
+    assert(3 == mesh->face_offsets[i + 1] - mesh->face_offsets[i]);
+    sum += twice / 2;
+  }
+  return sum;
+}
+
+TEST(faces) {
+  ResetTestState();
+  assert(SOP_EOK == sop_parser_init(&parser, &options));
+  assert(SOP_EOK == sop_parser_execute(&parser, polygons, strlen(polygons)));
+  assert(2 == TestState.faces);
+  assert(9 == TestState.corners);
+  ok("faces: polygons reach on_face whole");
+
+  ResetTestState();
+  options.triangulate = 1;
+  assert(SOP_EOK == sop_parser_init(&parser, &options));
+  assert(SOP_EOK == sop_parser_execute(&parser, polygons, strlen(polygons)));
+  assert(5 == TestState.faces);
+  assert(15 == TestState.corners);
+  ok("faces: polygons are fanned into triangles");
+
+  ResetTestState();
+  options.triangulate = 0;
+  options.callbacks.on_faces = on_faces;
+  assert(SOP_EOK == sop_parser_init(&parser, &options));
+  assert(SOP_EOK == sop_parser_execute(&parser, polygons, strlen(polygons)));
+  assert(2 == TestState.faces);
+  assert(9 == TestState.corners);
+
+  ResetTestState();
+  options.triangulate = 1;
+  assert(SOP_EOK == sop_parser_init(&parser, &options));
+  assert(SOP_EOK == sop_parser_execute(&parser, polygons, strlen(polygons)));
+  assert(5 == TestState.faces);
+  assert(15 == TestState.corners);
+  options.triangulate = 0;
+  options.callbacks.on_faces = 0;
+  ok("faces: batches hold polygons or their triangles");
+
+  {
+    sop_mesh_t mesh;
+    sop_mesh_options_t meshoptions = { .triangulate = 0 };
+
+    assert(SOP_EOK == sop_mesh_init(&mesh, &meshoptions));
+    assert(SOP_EOK == sop_mesh_load(polygons, strlen(polygons), &mesh));
+    assert(2 == mesh.face_count);
+    assert(9 == mesh.index_count);
+    assert(0 == mesh.face_offsets[0]);
+    assert(5 == mesh.face_offsets[1]);
+    assert(9 == mesh.face_offsets[2]);
+    assert(4 == mesh.position_indices[mesh.face_offsets[1] + 3]);
+    assert(0 == mesh.normal_indices[4] && -1 == mesh.normal_indices[5]);
+    sop_mesh_destroy(&mesh);
+    ok("faces: mesh keeps polygons with face offsets");
+
+    meshoptions.triangulate = 1;
+    assert(SOP_EOK == sop_mesh_init(&mesh, &meshoptions));
+    assert(SOP_EOK == sop_mesh_load(polygons, strlen(polygons), &mesh));
+    assert(5 == mesh.face_count);
+    assert(15 == mesh.index_count);
+    // the concave pentagon covers 3, the square 4
+    assert(7 == area(&mesh));
+    sop_mesh_destroy(&mesh);
+    ok("faces: mesh ear clips concave polygons");
+  }
+
+  {
+    const char *huge = "f 1 99999999999 -3000000000/2 2147483648\n";
+    sop_reader_event_t event;
+    sop_reader_t reader;
+    const int *rows = 0;
+
+    assert(SOP_EOK == sop_reader_init(&reader, huge, strlen(huge), 0));
+    assert(SOP_EOK == sop_reader_next(&reader, &event));
+    rows = (const int *) event.line.data;
+    assert(4 == event.line.length);
+    assert(1 == rows[0]);
+    assert(INT_MAX == rows[1]);
+    assert(-INT_MAX == rows[2] && 2 == rows[4 + 2]);
+    assert(INT_MAX == rows[3]);
+    sop_reader_destroy(&reader);
+    ok("faces: indices past INT_MAX are clamped");
+  }
+
+  ok_done();
+  return 0;
+}
+
+static int
+on_face(const sop_parser_state_t *state,
+        const sop_parser_line_state_t line) {
+  const size_t n = line.length;
+  const int *rows = (const int *) line.data;
+
+  if (options.triangulate) {
+    assert(3 == n);
+  } else if (0 == TestState.faces) {
+    // f 1//1 2//1 3//1 4//1 5//1
+    assert(5 == n);
+    for (size_t i = 0; i < n; ++i) {
+      assert((int) i + 1 == rows[i]);
+      assert(-1 == rows[n + i]);
+      assert(1 == rows[2 * n + i]);
+    }
+  }
+
+  TestState.faces++;
+  TestState.corners += n;
+  return SOP_EOK;
+}
+
+static int
+on_faces(const sop_parser_state_t *state,
+         const sop_parser_batch_t *batch) {
+  const int (*corners)[3] = (const int (*)[3]) batch->data;
+
+  if (options.triangulate) {
+    // fan (0, i, i + 1) of the pentagon
+    assert(1 == corners[3][0] && 3 == corners[4][0] && 4 == corners[5][0]);
+  } else {
+    assert(5 == batch->offsets[1] && 9 == batch->offsets[2]);
+  }
+
+  TestState.faces += (int) batch->count;
+  TestState.corners += batch->offsets[batch->count];
+  return SOP_EOK;
+}
@@ -0,0 +1,78 @@
+#include <stdlib.h>
+#include <assert.h>
+#include <string.h>
+#include <stdio.h>
+
+#include <sop/sop.h>
+#include <ok/ok.h>
+#include <fs/fs.h>
+
+#include "test.h"
+
+static int
+on_line(const sop_parser_state_t *state,
+        const sop_parser_line_state_t line);
+
+static sop_parser_t parser;
+static sop_parser_options_t options = {
+  .callbacks = {
+    .on_vertex = on_line,
+    .on_face = on_line,
+  }
+};
+
+static struct {
+  unsigned long hash;
+  size_t lastlineno;
+  size_t lines;
+} TestState;
+
+static void ResetTestState(void) {
+  memset(&TestState, 0, sizeof(TestState));
+}
+
+TEST(file) {
+  const char *src = fs_read("fixtures/teapot.obj");
+  unsigned long expected = 0;
+  size_t lines = 0;
+
+  ResetTestState();
+  assert(SOP_EOK == sop_parser_init(&parser, &options));
+  assert(SOP_EOK == sop_parser_execute(&parser, src, strlen(src)));
+  expected = TestState.hash;
+  lines = TestState.lines;
+
+  ResetTestState();
+  assert(SOP_EOK == sop_parser_execute_file(&parser, "fixtures/teapot.obj"));
+  assert(lines == TestState.lines);
+  assert(expected == TestState.hash);
+  ok("file: mapped file matches an in memory source");
+
+  assert(SOP_EINVALID_SOURCE ==
+         sop_parser_execute_file(&parser, "fixtures/missing.obj"));
+  ok("file: missing files fail");
+
+  assert(SOP_EINVALID_SOURCE == sop_parser_execute_file(&parser, "/dev/null"));
+  assert(0 == parser.stream);
+  ok("file: unmappable empty files fail");
+
+  ok_done();
+  return 0;
+}
+
+static int
+on_line(const sop_parser_state_t *state,
+        const sop_parser_line_state_t line) {
+  const unsigned char *bytes = (const unsigned char *) line.data;
+  const size_t size = SOP_DIRECTIVE_FACE == line.type
+    ? 9 * sizeof(int)
+    : 4 * sizeof(float);
+
+  assert(line.lineno > TestState.lastlineno);
+  TestState.lastlineno = line.lineno;
+  TestState.lines++;
+  for (size_t i = 0; i < size; ++i) {
+    TestState.hash = (TestState.hash ^ bytes[i]) * 1099511628211UL;
+  }
+  return SOP_EOK;
+}
@@ -0,0 +1,107 @@
+#include <stdlib.h>
+#include <assert.h>
+#include <string.h>
+#include <stdio.h>
+
+#include <sop/sop.h>
+#include <ok/ok.h>
+
+#include "test.h"
+
+static const char *values[] = {
+  "0", "-0", "+0.5", "1", "-1.000000", "0.539062", "-2.991600",
+  "96.078431", "3.4028235e38", "1.17549435e-38", "1e-45", "7.0e-46",
+  "16777217", "0.1", "123456789012345678901234567890",
+  "0.000000000000000000000000000000000000001", "1.5E+3", "2.5e-3",
+  "8.50000035762786865234375", "0.300000011920928955078125",
+  "340282356779733661637539395458142568448", "1e39", "-1e39",
+};
+
+TEST(float) {
+  const size_t count = sizeof(values) / sizeof(values[0]);
+
+  for (size_t i = 0; i < count; ++i) {
+    const char *value = values[i];
+    float expected = strtof(value, 0);
+    float actual = 0;
+    assert(strlen(value) == sop_strtof(value, strlen(value), &actual));
+    assert(0 == memcmp(&expected, &actual, sizeof(float)));
+  }
+  ok("float: sop_strtof rounds like strtof");
+
+  {
+    float actual = 0;
+    assert(0 == sop_strtof("abc", 3, &actual));
+    assert(1 == sop_strtof("1e", 2, &actual) && 1 == actual);
+    assert(3 == sop_strtof("2.5/", 4, &actual) && 2.5f == actual);
+  }
+  ok("float: sop_strtof stops at the end of a number");
+
+  {
+    float vertex[4] = {0, 0, 0, 1};
+    const char *line = "-0.5\t0.25 +1.5";
+    assert(3 == sop_parse_floats(line, strlen(line), vertex, 4));
+    assert(-0.5f == vertex[0]);
+    assert(0.25f == vertex[1]);
+    assert(1.5f == vertex[2]);
+    assert(1.0f == vertex[3]);
+  }
+  ok("float: sop_parse_floats reports components parsed");
+
+  {
+    // fixed format values of every width, with and without a source
+    // tail long enough for a whole block
+    char line[64] = {0};
+    srand(3);
+    for (int i = 0; i < 100000; ++i) {
+      float actual[2] = {0, 0};
+      int whole = rand() % 8;
+      int decimals = 1 + rand() % 9;
+      long long scale = 1;
+      long long digits = 0;
+      int size = 0;
+      for (int j = 0; j < whole + decimals; ++j) { scale *= 10; }
+      digits = ((long long) rand() * RAND_MAX + rand()) % scale;
+      size = snprintf(line, sizeof(line), "%s%0*lld",
+                      rand() % 2 ? "-" : "", whole + decimals + 1, digits);
+      memmove(line + size - decimals + 1, line + size - decimals,
+              (size_t) decimals + 1);
+      line[size - decimals] = '.';
+      size++;
+
+      assert(1 == sop_parse_floats(line, (size_t) size, actual, 2));
+      {
+        float expected = strtof(line, 0);
+        assert(0 == memcmp(&expected, &actual[0], sizeof(float)));
+      }
+
+      memcpy(line + size, " 0.5 0.25 0.125 0.0625", 23);
+      assert(2 == sop_parse_floats(line, strlen(line), actual, 2));
+      {
+        float expected = strtof(line, 0);
+        assert(0 == memcmp(&expected, &actual[0], sizeof(float)));
+        assert(0.5f == actual[1]);
+      }
+    }
+  }
+  ok("float: fixed format values round like strtof");
+
+  {
+    float value[2] = {0, 0};
+    const char *shapes[] = {
+      "1.5e3 2", "1.5E-3 2", "1. 2", ".5 2", "1.2.3 2", "0.000000 2",
+      "-0.000000 2", "12345678.12345678 2", "1.17549435e-38 2",
+      "0.00000000000001 2", "1.5/2 2",
+    };
+    for (size_t i = 0; i < sizeof(shapes) / sizeof(shapes[0]); ++i) {
+      const char *shape = shapes[i];
+      float expected = strtof(shape, 0);
+      assert(sop_parse_floats(shape, strlen(shape), value, 1));
+      assert(0 == memcmp(&expected, &value[0], sizeof(float)));
+    }
+  }
+  ok("float: unusual shapes fall back to sop_strtof");
+
+  ok_done();
+  return 0;
+}
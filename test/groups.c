@@ -0,0 +1,137 @@
+#include <stdlib.h>
+#include <assert.h>
+#include <string.h>
+#include <stdio.h>
+
+#include <sop/sop.h>
+#include <ok/ok.h>
+
+#include "test.h"
+
+static int
+on_faces(const sop_parser_state_t *state,
+         const sop_parser_batch_t *batch);
+
+static int
+on_group_complete(const sop_parser_state_t *state,
+                  const sop_parser_group_t *group);
+
+static sop_parser_t parser;
+static sop_parser_options_t options = {
+  .batch_size = 2,
+  .callbacks = {
+    .on_faces = on_faces,
+    .on_group_complete = on_group_complete,
+  }
+};
+
+static const char *source =
+  "v 0 0 0\n"
+  "v 1 0 0\n"
+  "v 0 1 0\n"
+  "f 1 2 3\n"
+  "o cube\n"
+  "v 0 0 1\n"
+  "v 1 0 1\n"
+  "v 1 1 1\n"
+  "v 0 1 1\n"
+  "vn 0 0 1\n"
+  "g front\n"
+  "f 4//1 5//1 6//1 7//1\n"
+  "g back\n"
+  "f 1 2 3\n"
+  "o empty\n"
+  "g\n";
+
+static struct {
+  int groups;
+  size_t faces;
+  char objects[8][16];
+  char names[8][16];
+  sop_parser_group_t group[8];
+} TestState;
+
+static void ResetTestState(void) {
+  memset(&TestState, 0, sizeof(TestState));
+}
+
+#define RANGE(range, o, c) ((o) == (range).offset && (c) == (range).count)
+
+TEST(groups) {
+  const size_t length = strlen(source);
+
+  ResetTestState();
+  assert(SOP_EOK == sop_parser_init(&parser, &options));
+  assert(SOP_EOK == sop_parser_execute(&parser, source, length));
+  assert(4 == TestState.groups);
+
+  assert(0 == strcmp("", TestState.objects[0]));
+  assert(0 == strcmp("", TestState.names[0]));
+  assert(0 == TestState.group[0].lineno);
+  assert(RANGE(TestState.group[0].vertices, 0, 3));
+  assert(RANGE(TestState.group[0].faces, 0, 1));
+  assert(RANGE(TestState.group[0].corners, 0, 3));
+
+  assert(0 == strcmp("cube", TestState.objects[1]));
+  assert(0 == strcmp("", TestState.names[1]));
+  assert(5 == TestState.group[1].lineno);
+  assert(RANGE(TestState.group[1].vertices, 3, 4));
+  assert(RANGE(TestState.group[1].normals, 0, 1));
+  assert(RANGE(TestState.group[1].faces, 1, 0));
+
+  assert(0 == strcmp("cube", TestState.objects[2]));
+  assert(0 == strcmp("front", TestState.names[2]));
+  assert(RANGE(TestState.group[2].faces, 1, 1));
+  assert(RANGE(TestState.group[2].corners, 3, 4));
+
+  assert(0 == strcmp("back", TestState.names[3]));
+  assert(RANGE(TestState.group[3].faces, 2, 1));
+  assert(RANGE(TestState.group[3].corners, 7, 3));
+  ok("groups: ranges of objects and groups");
+
+  ResetTestState();
+  options.triangulate = 1;
+  assert(SOP_EOK == sop_parser_init(&parser, &options));
+  assert(SOP_EOK == sop_parser_execute(&parser, source, length));
+  assert(4 == TestState.groups);
+  assert(RANGE(TestState.group[2].faces, 1, 2));
+  assert(RANGE(TestState.group[2].corners, 3, 6));
+  assert(RANGE(TestState.group[3].faces, 3, 1));
+  options.triangulate = 0;
+  ok("groups: triangulated ranges");
+
+  ResetTestState();
+  assert(SOP_EOK == sop_parser_init(&parser, &options));
+  for (size_t i = 0; i < length; ++i) {
+    assert(SOP_EOK == sop_parser_feed(&parser, source + i, 1));
+  }
+  assert(SOP_EOK == sop_parser_finish(&parser));
+  assert(4 == TestState.groups);
+  assert(0 == strcmp("back", TestState.names[3]));
+  assert(RANGE(TestState.group[3].corners, 7, 3));
+  ok("groups: streamed groups");
+
+  ok_done();
+  return 0;
+}
+
+static int
+on_faces(const sop_parser_state_t *state,
+         const sop_parser_batch_t *batch) {
+  TestState.faces += batch->count;
+  return SOP_EOK;
+}
+
+static int
+on_group_complete(const sop_parser_state_t *state,
+                  const sop_parser_group_t *group) {
+  int i = TestState.groups++;
+
+  // every face of the group has been delivered
+  assert(TestState.faces == group->faces.offset + group->faces.count);
+
+  strncpy(TestState.objects[i], group->object, 15);
+  strncpy(TestState.names[i], group->name, 15);
+  TestState.group[i] = *group;
+  return SOP_EOK;
+}
@@ -0,0 +1,274 @@
+#include <cassert>
+#include <climits>
+#include <cmath>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <sop/sop.hpp>
+
+extern "C" {
+#include <ok/ok.h>
+}
+
+/**
+ * Sums of everything the C parser and a sop::parse() handler see, so
+ * the two can be compared.
+ */
+
+struct totals {
+  size_t vertices = 0;
+  size_t faces = 0;
+  size_t corners = 0;
+  double positions = 0;
+  long indices = 0;
+};
+
+static int
+on_vertex(const sop_parser_state_t *state,
+          const sop_parser_line_state_t line) {
+  totals *t = (totals *) state->data;
+  const float *v = (const float *) line.data;
+  t->vertices++;
+  t->positions += (double) v[0] + v[1] + v[2];
+  return SOP_EOK;
+}
+
+static int
+on_face(const sop_parser_state_t *state,
+        const sop_parser_line_state_t line) {
+  totals *t = (totals *) state->data;
+  const int *v = (const int *) line.data;
+  t->faces++;
+  for (size_t i = 0; i < line.length; ++i) {
+    t->corners++;
+    t->indices += v[i];
+  }
+  return SOP_EOK;
+}
+
+struct mesh_handler {
+  totals t;
+
+  void
+  on_vertex(float x, float y, float z) {
+    t.vertices++;
+    t.positions += (double) x + y + z;
+  }
+
+  void
+  on_face(const sop::corners &corners) {
+    t.faces++;
+    for (const sop::corner &c : corners) {
+      t.corners++;
+      t.indices += c.v;
+    }
+  }
+};
+
+static void
+test_teapot(void) {
+  std::ifstream file("fixtures/teapot.obj", std::ios::binary);
+  std::stringstream buffer;
+  sop_parser_options_t options = {};
+  sop_parser_t parser;
+  mesh_handler handler;
+  totals c;
+
+  buffer << file.rdbuf();
+  const std::string src = buffer.str();
+
+  options.data = &c;
+  options.callbacks.on_vertex = on_vertex;
+  options.callbacks.on_face = on_face;
+  assert(SOP_EOK == sop_parser_init(&parser, &options));
+  assert(SOP_EOK == sop_parser_execute(&parser, src.data(), src.size()));
+  sop_parser_destroy(&parser);
+
+  assert(SOP_EOK == sop::parse(src, handler));
+  assert(3644 == handler.t.vertices);
+  assert(6320 == handler.t.faces);
+  ok("hpp: teapot parses like the C API");
+
+  assert(c.vertices == handler.t.vertices);
+  assert(c.faces == handler.t.faces);
+  assert(c.corners == handler.t.corners);
+  assert(c.indices == handler.t.indices);
+  assert(c.positions == handler.t.positions);
+  ok("hpp: teapot values match the C API");
+}
+
+struct everything_handler {
+  std::vector<float> floats;
+  std::vector<sop::corner> corners;
+  std::vector<std::string> strings;
+  std::vector<int> integers;
+
+  void on_vertex(float x, float y, float z, float w) {
+    floats.insert(floats.end(), { x, y, z, w });
+  }
+
+  void on_texture(float u, float v) { floats.insert(floats.end(), { u, v }); }
+  void on_normal(float x, float y, float z) {
+    floats.insert(floats.end(), { x, y, z });
+  }
+
+  void on_face(const sop::corners &c) {
+    corners.insert(corners.end(), c.begin(), c.end());
+  }
+
+  void on_line(const sop::corners &c) { integers.push_back((int) c.size()); }
+  void on_smooth(bool on) { integers.push_back(on ? 1 : 0); }
+  void on_material_illum(int illum) { integers.push_back(illum); }
+  void on_material_density(float d) { floats.push_back(d); }
+  void on_material_diffuse(float r, float g, float b) {
+    floats.insert(floats.end(), { r, g, b });
+  }
+
+  void on_comment(std::string_view s) { strings.emplace_back(s); }
+  void on_group(std::string_view s) { strings.emplace_back(s); }
+  void on_material_use(std::string_view s) { strings.emplace_back(s); }
+  void on_material_map(std::string_view name, std::string_view file) {
+    strings.emplace_back(std::string(name) + "=" + std::string(file));
+  }
+};
+
+static void
+test_directives(void) {
+  const char *src = ""
+    "# a comment  \r\n"
+    "v 1 2 3\n"
+    "v 4 5 6 0.5\n"
+    "  vt 0.25 0.75\n"
+    "vn 0 0 1\n"
+    "vp 1 2\n"
+    "o ignored\n"
+    "g\n"
+    "g  body \n"
+    "usemtl red\n"
+    "s off\n"
+    "s 4\n"
+    "f 1 2/3 -4//5 6/7/8\n"
+    "l 1 2 3\n"
+    "Kd 0.5 0.25 1\n"
+    "Ni 1.5\n"
+    "illum 2\n"
+    "map_Kd red.png\n"
+    "unknown 1 2 3\n"
+    "averyverylongdirective\n"
+    "";
+  everything_handler h;
+
+  assert(SOP_EOK == sop::parse(src, strlen(src), h));
+
+  const std::vector<float> floats = {
+    1, 2, 3, 1,
+    4, 5, 6, 0.5f,
+    0.25f, 0.75f,
+    0, 0, 1,
+    0.5f, 0.25f, 1,
+    1.5f,
+  };
+  assert(floats == h.floats);
+  ok("hpp: floats reach the members that take them");
+
+  assert(4 == h.corners.size());
+  assert(1 == h.corners[0].v && -1 == h.corners[0].vt);
+  assert(-1 == h.corners[0].vn);
+  assert(2 == h.corners[1].v && 3 == h.corners[1].vt);
+  assert(-1 == h.corners[1].vn);
+  assert(-4 == h.corners[2].v && -1 == h.corners[2].vt);
+  assert(5 == h.corners[2].vn);
+  assert(6 == h.corners[3].v && 7 == h.corners[3].vt);
+  assert(8 == h.corners[3].vn);
+  ok("hpp: face corners");
+
+  const std::vector<int> integers = { 0, 1, 3, 2 };
+  assert(integers == h.integers);
+  ok("hpp: smooth, line and illum");
+
+  const std::vector<std::string> strings = {
+    "a comment", "", "body", "red", "map_Kd=red.png",
+  };
+  assert(strings == h.strings);
+  ok("hpp: strings are trimmed views into the source");
+}
+
+struct corner_handler {
+  std::vector<sop::corner> corners;
+
+  void on_face(const sop::corners &c) {
+    corners.insert(corners.end(), c.begin(), c.end());
+  }
+};
+
+static int
+on_face_rows(const sop_parser_state_t *state,
+             const sop_parser_line_state_t line) {
+  std::vector<int> *rows = (std::vector<int> *) state->data;
+  const int *v = (const int *) line.data;
+  rows->assign(v, v + 3 * line.length);
+  return SOP_EOK;
+}
+
+static void
+test_oversized(void) {
+  const char *src = "f 1 99999999999 -3000000000/2 2147483648\n";
+  sop_parser_options_t options = {};
+  std::vector<int> rows;
+  sop_parser_t parser;
+  corner_handler h;
+
+  options.data = &rows;
+  options.callbacks.on_face = on_face_rows;
+  assert(SOP_EOK == sop_parser_init(&parser, &options));
+  assert(SOP_EOK == sop_parser_execute(&parser, src, strlen(src)));
+  sop_parser_destroy(&parser);
+
+  assert(SOP_EOK == sop::parse(src, strlen(src), h));
+  assert(4 == h.corners.size() && 12 == rows.size());
+  for (size_t i = 0; i < h.corners.size(); ++i) {
+    assert(rows[i] == h.corners[i].v);
+  }
+  assert(INT_MAX == h.corners[1].v);
+  assert(-INT_MAX == h.corners[2].v && 2 == h.corners[2].vt);
+  assert(INT_MAX == h.corners[3].v);
+  ok("hpp: oversized indices are clamped like the C API");
+}
+
+struct stopping_handler {
+  int faces = 0;
+
+  int
+  on_face(const sop::corners &) {
+    return ++faces < 2 ? SOP_EOK : SOP_EINVALID_OPTIONS;
+  }
+};
+
+struct empty_handler { };
+
+static void
+test_stop(void) {
+  const char *src = "f 1 2 3\nf 1 2 3\nf 1 2 3\n";
+  stopping_handler h;
+  empty_handler e;
+
+  assert(SOP_EINVALID_OPTIONS == sop::parse(src, strlen(src), h));
+  assert(2 == h.faces);
+  ok("hpp: a member returning an error stops the parse");
+
+  assert(SOP_EOK == sop::parse(src, strlen(src), e));
+  assert(SOP_EINVALID_SOURCE == sop::parse("", 0, e));
+  ok("hpp: handlers without members and empty sources");
+}
+
+int
+main(void) {
+  test_teapot();
+  test_directives();
+  test_oversized();
+  test_stop();
+  ok_done();
+  return 0;
+}
@@ -0,0 +1,128 @@
+#include <stdlib.h>
+#include <assert.h>
+#include <string.h>
+#include <stdio.h>
+
+#include <sop/sop.h>
+#include <ok/ok.h>
+
+#include "test.h"
+
+static int
+on_comment(const sop_parser_state_t *state,
+           const sop_parser_line_state_t line);
+
+static int
+on_material_use(const sop_parser_state_t *state,
+                const sop_parser_line_state_t line);
+
+static int
+on_vertex(const sop_parser_state_t *state,
+          const sop_parser_line_state_t line);
+
+static sop_parser_t parser;
+static sop_parser_options_t options = {
+  .callbacks = {
+    .on_material_use = on_material_use,
+    .on_comment = on_comment,
+    .on_vertex = on_vertex,
+  }
+};
+
+static struct {
+  const char *source;
+  size_t length;
+  size_t longest;
+  int comments;
+  int materials;
+  int vertices;
+} TestState;
+
+static void ResetTestState(void) {
+  memset(&TestState, 0, sizeof(TestState));
+}
+
+TEST(lines) {
+  const size_t longsize = 4 * BUFSIZ;
+  char *src = malloc(longsize + 128);
+  size_t n = 0;
+
+  assert(src);
+  src[n++] = '#';
+  memset(src + n, 'x', longsize);
+  n += longsize;
+  n += sprintf(src + n, "\r\n  usemtl shiny\r\n\tv 1 2 3\r\nv 4 5 6");
+
+  ResetTestState();
+  TestState.source = src;
+  TestState.length = n;
+  options.zero_copy = 0;
+  options.data = &TestState;
+
+  assert(SOP_EOK == sop_parser_init(&parser, &options));
+  assert(SOP_EOK == sop_parser_execute(&parser, src, n));
+  assert(1 == TestState.comments);
+  assert(longsize == TestState.longest);
+  ok("lines: long lines are not truncated");
+
+  assert(1 == TestState.materials);
+  assert(2 == TestState.vertices);
+  ok("lines: CRLF and unterminated lines are parsed");
+
+  ResetTestState();
+  TestState.source = src;
+  TestState.length = n;
+  options.zero_copy = 1;
+
+  assert(SOP_EOK == sop_parser_init(&parser, &options));
+  assert(SOP_EOK == sop_parser_execute(&parser, src, n));
+  assert(1 == TestState.comments);
+  assert(1 == TestState.materials);
+  assert(2 == TestState.vertices);
+  ok("lines: zero copy slices point into the source");
+
+  options.zero_copy = 0;
+  options.data = 0;
+  free(src);
+  ok_done();
+  return 0;
+}
+
+static int
+on_comment(const sop_parser_state_t *state,
+           const sop_parser_line_state_t line) {
+  TestState.comments++;
+  TestState.longest = line.length;
+  if (options.zero_copy) {
+    assert((const char *) line.data >= TestState.source);
+    assert((const char *) line.data < TestState.source + TestState.length);
+  } else {
+    assert(line.length == strlen((char *) line.data));
+  }
+  return SOP_EOK;
+}
+
+static int
+on_material_use(const sop_parser_state_t *state,
+                const sop_parser_line_state_t line) {
+  TestState.materials++;
+  assert(5 == line.length);
+  assert(0 == memcmp(line.data, "shiny", 5));
+  if (options.zero_copy) {
+    assert((const char *) line.data > TestState.source);
+  } else {
+    assert(0 == strcmp((char *) line.data, "shiny"));
+  }
+  return SOP_EOK;
+}
+
+static int
+on_vertex(const sop_parser_state_t *state,
+          const sop_parser_line_state_t line) {
+  float *vertex = (float *) line.data;
+  TestState.vertices++;
+  assert(vertex[0] == 1 || vertex[0] == 4);
+  assert(vertex[2] == 3 || vertex[2] == 6);
+  assert(1 == vertex[3]);
+  return SOP_EOK;
+}
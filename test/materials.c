@@ -0,0 +1,155 @@
+#include <stdlib.h>
+#include <assert.h>
+#include <string.h>
+#include <stdio.h>
+
+#include <sop/sop.h>
+#include <ok/ok.h>
+
+#include "test.h"
+
+static int
+on_faces(const sop_parser_state_t *state,
+         const sop_parser_batch_t *batch);
+
+static int
+on_face(const sop_parser_state_t *state,
+        const sop_parser_line_state_t line);
+
+static sop_materials_t materials;
+static sop_parser_t parser;
+static sop_parser_options_t options = {
+  .materials = &materials,
+  .callbacks = {
+    .on_faces = on_faces,
+  }
+};
+
+static const char *library =
+  "newmtl red\n"
+  "Ka 0.1 0 0\n"
+  "Kd 1 0 0\n"
+  "Ks 0.5 0.5 0.5\n"
+  "Ns 96.078431\n"
+  "d 0.75\n"
+  "illum 2\n"
+  "map_Kd -s 2 2 1 red.png\n"
+  "newmtl glass\n"
+  "Tr 0.9\n"
+  "Ni 1.5\n"
+  "bump glass_bump.png\n";
+
+static const char *source =
+  "v 0 0 0\n"
+  "v 1 0 0\n"
+  "v 0 1 0\n"
+  "f 1 2 3\n"
+  "usemtl glass\n"
+  "f 1 2 3\n"
+  "f 1 2 3\n"
+  "usemtl red\n"
+  "f 1 2 3\n"
+  "usemtl blue\n"
+  "f 1 2 3\n";
+
+static struct {
+  int batches;
+  int materials[8];
+  size_t counts[8];
+  int faces[8];
+} TestState;
+
+static void ResetTestState(void) {
+  memset(&TestState, 0, sizeof(TestState));
+}
+
+TEST(materials) {
+  const sop_material_t *material = 0;
+  int red = -1;
+  int glass = -1;
+
+  ResetTestState();
+  assert(SOP_EOK == sop_parser_init(&parser, &options));
+  assert(SOP_EOK == sop_parser_execute(&parser, library, strlen(library)));
+  assert(2 == materials.count);
+
+  red = sop_materials_find(&materials, "red", 3);
+  glass = sop_materials_find(&materials, "glass", 5);
+  assert(0 == red && 1 == glass);
+  assert(-1 == sop_materials_find(&materials, "blue", 4));
+  assert(red == sop_materials_intern(&materials, "red", 3));
+
+  material = &materials.materials[red];
+  assert(0 == strcmp("red", material->name) && 3 == material->length);
+  assert(0.1f == material->ambient[0] && 1 == material->ambient[3]);
+  assert(1 == material->diffuse[0] && 0 == material->diffuse[1]);
+  assert(0.5f == material->specular[2]);
+  assert(96.078431f == material->shininess);
+  assert(0.75f == material->dissolve);
+  assert(2 == material->illum);
+  assert(0 == strcmp("-s 2 2 1 red.png",
+                     material->maps[SOP_MATERIAL_MAP_DIFFUSE]));
+  assert(0 == material->maps[SOP_MATERIAL_MAP_BUMP]);
+
+  material = &materials.materials[glass];
+  assert(1 - 0.9f == material->dissolve);
+  assert(1.5f == material->density);
+  assert(0 == strcmp("glass_bump.png", material->maps[SOP_MATERIAL_MAP_BUMP]));
+  ok("materials: material libraries fill the table");
+
+  assert(SOP_EOK == sop_parser_execute(&parser, source, strlen(source)));
+  assert(3 == materials.count);
+  assert(4 == TestState.batches);
+  assert(-1 == TestState.materials[0] && 1 == TestState.counts[0]);
+  assert(glass == TestState.materials[1] && 2 == TestState.counts[1]);
+  assert(red == TestState.materials[2] && 1 == TestState.counts[2]);
+  assert(2 == TestState.materials[3]);
+  ok("materials: face batches carry material ids");
+
+  ResetTestState();
+  options.callbacks.on_faces = 0;
+  options.callbacks.on_face = on_face;
+  assert(SOP_EOK == sop_parser_init(&parser, &options));
+  assert(SOP_EOK == sop_parser_execute(&parser, source, strlen(source)));
+  assert(-1 == TestState.faces[0]);
+  assert(glass == TestState.faces[1] && glass == TestState.faces[2]);
+  assert(red == TestState.faces[3] && 2 == TestState.faces[4]);
+  options.callbacks.on_face = 0;
+  options.callbacks.on_faces = on_faces;
+  ok("materials: faces carry material ids");
+
+  for (int i = 0; i < 100; ++i) {
+    char name[16];
+    int length = sprintf(name, "m%d", i);
+    assert(3 + i == sop_materials_intern(&materials, name, (size_t) length));
+  }
+  for (int i = 0; i < 100; ++i) {
+    char name[16];
+    int length = sprintf(name, "m%d", i);
+    assert(3 + i == sop_materials_find(&materials, name, (size_t) length));
+  }
+  assert(red == sop_materials_find(&materials, "red", 3));
+  ok("materials: interned names");
+
+  sop_materials_destroy(&materials);
+  assert(0 == materials.count && 0 == materials.materials);
+
+  ok_done();
+  return 0;
+}
+
+static int
+on_faces(const sop_parser_state_t *state,
+         const sop_parser_batch_t *batch) {
+  TestState.materials[TestState.batches] = batch->material;
+  TestState.counts[TestState.batches] = batch->count;
+  TestState.batches++;
+  return SOP_EOK;
+}
+
+static int
+on_face(const sop_parser_state_t *state,
+        const sop_parser_line_state_t line) {
+  TestState.faces[TestState.batches++] = line.material;
+  return SOP_EOK;
+}
@@ -0,0 +1,135 @@
+#include <stdlib.h>
+#include <assert.h>
+#include <string.h>
+#include <stdio.h>
+
+#include <sop/sop.h>
+#include <ok/ok.h>
+#include <fs/fs.h>
+
+#include "test.h"
+
+TEST(mesh) {
+  sop_mesh_t mesh;
+  const char *src = fs_read("fixtures/teapot.obj");
+
+  assert(SOP_EOK == sop_mesh_init(&mesh, 0));
+  ok("mesh: sop_mesh_init");
+  assert(SOP_EOK == sop_mesh_load(src, strlen(src), &mesh));
+  ok("mesh: sop_mesh_load");
+
+  assert(3644 == mesh.position_count);
+  assert(mesh.position_count == mesh.capacity.positions);
+  ok("mesh: positions loaded and shrunk to fit");
+
+  assert(6320 == mesh.face_count);
+  assert(3 * 6320 == mesh.index_count);
+  assert(mesh.index_count == mesh.capacity.indices);
+  for (size_t i = 0; i < mesh.index_count; ++i) {
+    assert(mesh.position_indices[i] >= 0);
+    assert(mesh.position_indices[i] < (int) mesh.position_count);
+    assert(-1 == mesh.texcoord_indices[i]);
+    assert(-1 == mesh.normal_indices[i]);
+  }
+  ok("mesh: face indices resolved");
+
+  sop_mesh_destroy(&mesh);
+  assert(0 == mesh.positions && 0 == mesh.position_count);
+  ok("mesh: sop_mesh_destroy");
+
+  const char *quad = ""
+    "v 0 0 0\n"
+    "v 1 0 0\n"
+    "v 1 1 0\n"
+    "v 0 1 0\n"
+    "vt 0 0\n"
+    "vt 1 1\n"
+    "vn 0 0 1\n"
+    "f 1/1/1 2/1/1 3/2/1\n"
+    "f -4/-2/-1 -2/-1/-1 -1/-1/-1\n"
+    "";
+
+  assert(SOP_EOK == sop_mesh_init(&mesh, 0));
+  assert(SOP_EOK == sop_mesh_load(quad, strlen(quad), &mesh));
+  assert(SOP_EOK == sop_mesh_load(quad, strlen(quad), &mesh));
+  assert(8 == mesh.position_count);
+  assert(4 == mesh.texcoord_count);
+  assert(2 == mesh.normal_count);
+  assert(4 == mesh.face_count);
+  assert(1 == mesh.texcoords[2] && 1 == mesh.texcoords[3]);
+  assert(1 == mesh.normals[2]);
+
+  {
+    const int positions[] = { 0, 1, 2, 0, 2, 3, 4, 5, 6, 4, 6, 7 };
+    const int texcoords[] = { 0, 0, 1, 0, 1, 1, 2, 2, 3, 2, 3, 3 };
+    for (size_t i = 0; i < mesh.index_count; ++i) {
+      assert(positions[i] == mesh.position_indices[i]);
+      assert(texcoords[i] == mesh.texcoord_indices[i]);
+      assert((int) i / 6 == mesh.normal_indices[i]);
+    }
+  }
+  ok("mesh: relative indices and appended sources resolve");
+
+  sop_mesh_destroy(&mesh);
+
+  assert(SOP_EINVALID_SOURCE == sop_mesh_load("v 0 0 0\nf -2 -1 -1\n", 19,
+                                              &mesh));
+  sop_mesh_destroy(&mesh);
+  ok("mesh: out of range relative indices fail");
+
+  {
+    const char *range = "v 0 0 0\nv 1 0 0\nv 1 1 0\nf 1 2 99\n";
+    const char *quad = "v 0 0 0\nv 1 0 0\nv 1 1 0\nf 1 2 3 500000\n";
+    const char *texcoord = "v 0 0 0\nv 1 0 0\nv 1 1 0\nvt 0 0\n"
+                           "f 1/1 2/1 3/2\n";
+    const char *overflow = "v 0 0 0\nf 1 2 2147483647\n";
+    sop_mesh_options_t options = { .triangulate = 1 };
+
+    assert(SOP_EOK == sop_mesh_init(&mesh, 0));
+    assert(SOP_EINVALID_SOURCE == sop_mesh_load(range, strlen(range), &mesh));
+    sop_mesh_destroy(&mesh);
+
+    assert(SOP_EOK == sop_mesh_init(&mesh, &options));
+    assert(SOP_EINVALID_SOURCE == sop_mesh_load(quad, strlen(quad), &mesh));
+    sop_mesh_destroy(&mesh);
+
+    assert(SOP_EOK == sop_mesh_init(&mesh, 0));
+    assert(SOP_EINVALID_SOURCE == sop_mesh_load(texcoord, strlen(texcoord),
+                                                &mesh));
+    sop_mesh_destroy(&mesh);
+
+    // the second source may only reach its own vertices
+    assert(SOP_EOK == sop_mesh_init(&mesh, 0));
+    assert(SOP_EOK == sop_mesh_load(range, 24, &mesh));
+    assert(SOP_EINVALID_SOURCE == sop_mesh_load(overflow, strlen(overflow),
+                                                &mesh));
+    sop_mesh_destroy(&mesh);
+  }
+  ok("mesh: out of range absolute indices fail");
+
+  {
+    // relative indices resolve where the face is, not where its batch
+    // is delivered
+    const size_t vertices = SOP_PARSER_BATCH_SIZE + 100;
+    char *split = (char *) malloc(8 * (3 + vertices) + 16);
+    char *p = split;
+    assert(split);
+    for (size_t i = 0; i < 3; ++i) { p += sprintf(p, "v 0 0 0\n"); }
+    p += sprintf(p, "f -3 -2 -1\n");
+    for (size_t i = 0; i < vertices; ++i) { p += sprintf(p, "v 1 1 1\n"); }
+
+    assert(SOP_EOK == sop_mesh_init(&mesh, 0));
+    assert(SOP_EOK == sop_mesh_load(split, strlen(split), &mesh));
+    assert(3 + vertices == mesh.position_count);
+    assert(1 == mesh.face_count && 3 == mesh.index_count);
+    assert(0 == mesh.position_indices[0]);
+    assert(1 == mesh.position_indices[1]);
+    assert(2 == mesh.position_indices[2]);
+    sop_mesh_destroy(&mesh);
+    free(split);
+  }
+  ok("mesh: relative indices resolve ahead of later vertices");
+
+  ok_done();
+  return 0;
+}
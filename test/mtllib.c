@@ -0,0 +1,115 @@
+#include <stdlib.h>
+#include <assert.h>
+#include <string.h>
+#include <stdio.h>
+
+#include <sop/sop.h>
+#include <ok/ok.h>
+
+#include "test.h"
+
+#define SOURCE "/tmp/sop-mtllib-test.obj"
+#define LIBRARY "/tmp/sop-mtllib-test.mtl"
+
+static int
+on_faces(const sop_parser_state_t *state,
+         const sop_parser_batch_t *batch);
+
+static sop_materials_t materials;
+static sop_parser_t parser;
+static sop_parser_options_t options = {
+  .materials = &materials,
+  .load_materials = 1,
+  .callbacks = {
+    .on_faces = on_faces,
+  }
+};
+
+static struct {
+  int batches;
+  int materials[8];
+} TestState;
+
+static void ResetTestState(void) {
+  memset(&TestState, 0, sizeof(TestState));
+}
+
+static void
+write_file(const char *path, const char *contents) {
+  FILE *file = fopen(path, "wb");
+  assert(file);
+  assert(strlen(contents) == fwrite(contents, 1, strlen(contents), file));
+  fclose(file);
+}
+
+TEST(mtllib) {
+  const char *src =
+    "mtllib fixtures/cube.mtl fixtures/missing.mtl\n"
+    "v 0 0 0\n"
+    "v 1 0 0\n"
+    "v 0 1 0\n"
+    "usemtl MaterialPhongB\n"
+    "f 1 2 3\n"
+    "usemtl MaterialSpecularY\n"
+    "f 1 2 3\n";
+  const sop_material_t *material = 0;
+  int id = -1;
+
+  ResetTestState();
+  assert(SOP_EOK == sop_parser_init(&parser, &options));
+  assert(SOP_EOK == sop_parser_execute(&parser, src, strlen(src)));
+  assert(6 == materials.count);
+  assert(2 == TestState.batches);
+
+  // ids handed out while parsing describe the loaded materials
+  material = &materials.materials[TestState.materials[0]];
+  assert(0 == strcmp("MaterialPhongB", material->name));
+  assert(0.5f == material->diffuse[2] && 2 == material->illum);
+  material = &materials.materials[TestState.materials[1]];
+  assert(0 == strcmp("MaterialSpecularY", material->name));
+  assert(1 == material->specular[1] && 0 == material->specular[2]);
+
+  id = sop_materials_find(&materials, "MaterialDiffuseR", 16);
+  assert(id >= 0 && 1 == materials.materials[id].diffuse[0]);
+  assert(96.078431f == materials.materials[id].shininess);
+  sop_materials_destroy(&materials);
+  ok("mtllib: libraries load while the source is parsed");
+
+  ResetTestState();
+  options.base = "fixtures/";
+  src = "mtllib cube.mtl\nusemtl MaterialDiffuseM\n";
+  assert(SOP_EOK == sop_parser_init(&parser, &options));
+  assert(SOP_EOK == sop_parser_execute(&parser, src, strlen(src)));
+  id = sop_materials_find(&materials, "MaterialDiffuseM", 16);
+  assert(0 == id && 6 == materials.count);
+  assert(1 == materials.materials[id].diffuse[2]);
+  options.base = 0;
+  sop_materials_destroy(&materials);
+  ok("mtllib: base directory");
+
+  ResetTestState();
+  write_file(LIBRARY, "newmtl red\nKd 1 0 0\n");
+  write_file(SOURCE,
+             "mtllib sop-mtllib-test.mtl\n"
+             "v 0 0 0\nv 1 0 0\nv 0 1 0\n"
+             "usemtl red\nf 1 2 3\n");
+  assert(SOP_EOK == sop_parser_init(&parser, &options));
+  assert(SOP_EOK == sop_parser_execute_file(&parser, SOURCE));
+  assert(1 == materials.count && 1 == TestState.batches);
+  assert(0 == TestState.materials[0]);
+  assert(1 == materials.materials[0].diffuse[0]);
+  sop_materials_destroy(&materials);
+  remove(SOURCE);
+  remove(LIBRARY);
+  ok("mtllib: libraries relative to the parsed file");
+
+  ok_done();
+  return 0;
+}
+
+static int
+on_faces(const sop_parser_state_t *state,
+         const sop_parser_batch_t *batch) {
+  TestState.materials[TestState.batches++] = batch->material;
+  return SOP_EOK;
+}
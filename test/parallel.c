@@ -0,0 +1,127 @@
+#include <stdlib.h>
+#include <assert.h>
+#include <string.h>
+#include <stdio.h>
+
+#include <sop/sop.h>
+#include <ok/ok.h>
+
+#include "test.h"
+
+static int
+on_line(const sop_parser_state_t *state,
+        const sop_parser_line_state_t line);
+
+static int
+on_string(const sop_parser_state_t *state,
+          const sop_parser_line_state_t line);
+
+static sop_parser_t parser;
+static sop_parser_options_t options = {
+  .callbacks = {
+    .on_material_use = on_string,
+    .on_comment = on_string,
+    .on_texture = on_line,
+    .on_vertex = on_line,
+    .on_normal = on_line,
+    .on_face = on_line,
+  }
+};
+
+static struct {
+  unsigned long hash;
+  size_t lastlineno;
+  int lines;
+} TestState;
+
+static void ResetTestState(void) {
+  memset(&TestState, 0, sizeof(TestState));
+}
+
+static void
+hash(const void *data, size_t size) {
+  const unsigned char *bytes = (const unsigned char *) data;
+  for (size_t i = 0; i < size; ++i) {
+    TestState.hash = (TestState.hash ^ bytes[i]) * 1099511628211UL;
+  }
+}
+
+static char *
+generate(size_t *length) {
+  const int vertices = 60000;
+  size_t capacity = 128 * (size_t) vertices;
+  char *src = malloc(capacity);
+  size_t n = 0;
+
+  assert(src);
+  for (int i = 0; i < vertices; ++i) {
+    n += sprintf(src + n, "v %d.%03d %d.5 -%d.25\n", i, i % 1000, i % 7, i);
+    n += sprintf(src + n, "vt 0.%d 0.%d\nvn 0 1 0\n", i % 10, i % 3);
+    if (0 == i % 97) {
+      n += sprintf(src + n, "# comment %d\nusemtl m%d\n\n", i, i % 5);
+    }
+    if (i > 2) {
+      n += sprintf(src + n, "f %d/%d/%d -1//-2 %d\n", i, i, i, i - 2);
+    }
+  }
+
+  *length = n;
+  return src;
+}
+
+TEST(parallel) {
+  size_t length = 0;
+  char *src = generate(&length);
+  unsigned long serial = 0;
+  int lines = 0;
+
+  ResetTestState();
+  options.threads = 0;
+  assert(SOP_EOK == sop_parser_init(&parser, &options));
+  assert(SOP_EOK == sop_parser_execute(&parser, src, length));
+  serial = TestState.hash;
+  lines = TestState.lines;
+  ok("parallel: serial parse");
+
+  for (int threads = 2; threads <= 5; ++threads) {
+    ResetTestState();
+    options.threads = threads;
+    assert(SOP_EOK == sop_parser_init(&parser, &options));
+    assert(SOP_EOK == sop_parser_execute(&parser, src, length));
+    assert(lines == TestState.lines);
+    assert(serial == TestState.hash);
+  }
+  ok("parallel: callbacks match a serial parse in source order");
+
+  options.threads = 0;
+  free(src);
+  ok_done();
+  return 0;
+}
+
+static int
+on_line(const sop_parser_state_t *state,
+        const sop_parser_line_state_t line) {
+  assert(line.lineno > TestState.lastlineno);
+  TestState.lastlineno = line.lineno;
+  TestState.lines++;
+  hash(&line.type, sizeof(line.type));
+  hash(&line.lineno, sizeof(line.lineno));
+  if (SOP_DIRECTIVE_FACE == line.type) {
+    hash(line.data, 9 * sizeof(int));
+  } else {
+    hash(line.data, 4 * sizeof(float));
+  }
+  return SOP_EOK;
+}
+
+static int
+on_string(const sop_parser_state_t *state,
+          const sop_parser_line_state_t line) {
+  assert(line.lineno > TestState.lastlineno);
+  TestState.lastlineno = line.lineno;
+  TestState.lines++;
+  hash(&line.lineno, sizeof(line.lineno));
+  hash(line.data, line.length);
+  return SOP_EOK;
+}
@@ -0,0 +1,272 @@
+#include <stdlib.h>
+#include <assert.h>
+#include <string.h>
+#include <stdio.h>
+
+#include <sop/sop.h>
+#include <ok/ok.h>
+#include <fs/fs.h>
+
+#include "test.h"
+
+static int
+on_line(const sop_parser_state_t *state,
+        const sop_parser_line_state_t line);
+
+static sop_parser_t parser;
+static sop_parser_options_t options = {
+  .callbacks = {
+    .on_texture = on_line,
+    .on_vertex = on_line,
+    .on_normal = on_line,
+    .on_face = on_line,
+  }
+};
+
+static struct {
+  unsigned long hash;
+  int lines;
+} TestState;
+
+static void ResetTestState(void) {
+  memset(&TestState, 0, sizeof(TestState));
+}
+
+static void
+hash(unsigned long *h, const void *data, size_t size) {
+  const unsigned char *bytes = (const unsigned char *) data;
+  for (size_t i = 0; i < size; ++i) {
+    *h = (*h ^ bytes[i]) * 1099511628211UL;
+  }
+}
+
+/**
+ * Hashes a line the way on_line does.
+ */
+
+static void
+hash_line(unsigned long *h, const sop_parser_line_state_t *line) {
+  hash(h, &line->type, sizeof(line->type));
+  if (SOP_DIRECTIVE_FACE == line->type) {
+    hash(h, line->data, 3 * line->length * sizeof(int));
+  } else {
+    hash(h, line->data, 4 * sizeof(float));
+  }
+}
+
+static int
+on_line(const sop_parser_state_t *state,
+        const sop_parser_line_state_t line) {
+  TestState.lines++;
+  hash_line(&TestState.hash, &line);
+  return SOP_EOK;
+}
+
+/**
+ * Reads a source to the end hashing its line events.
+ */
+
+static int
+read_all(sop_reader_t *reader, unsigned long *h) {
+  sop_reader_event_t event;
+  int lines = 0;
+  int rc = SOP_EOK;
+
+  while (SOP_EOK == (rc = sop_reader_next(reader, &event))) {
+    assert(!event.batched);
+    assert(event.type == event.line.type);
+    hash_line(h, &event.line);
+    lines++;
+  }
+
+  assert(SOP_NULL == rc);
+  return lines;
+}
+
+static const char *batched = ""
+  "# cube\n"
+  "v 0 0 0\n"
+  "v 1 0 0\n"
+  "v 1 1 0\n"
+  "v 0 1 0\n"
+  "v 0 0 1\n"
+  "vn 0 0 1\n"
+  "usemtl red\n"
+  "f 1//1 2//1 3//1 4//1\n"
+  "f 1 2 5\n"
+  "g  top \n"
+  "f 4 3 5";
+
+TEST(reader) {
+  const char *src = fs_read("fixtures/teapot.obj");
+  const size_t length = strlen(src);
+  sop_reader_options_t readeroptions = {
+    .directives = SOP_DIRECTIVE_MASK(SOP_DIRECTIVE_VERTEX) |
+                  SOP_DIRECTIVE_MASK(SOP_DIRECTIVE_VERTEX_TEXTURE) |
+                  SOP_DIRECTIVE_MASK(SOP_DIRECTIVE_VERTEX_NORMAL) |
+                  SOP_DIRECTIVE_MASK(SOP_DIRECTIVE_FACE),
+  };
+  sop_reader_t reader;
+  sop_reader_t other;
+  sop_reader_event_t event;
+  unsigned long first = 0;
+  unsigned long second = 0;
+  int lines[2] = {0};
+  int rc[2] = { SOP_EOK, SOP_EOK };
+
+  ResetTestState();
+  assert(SOP_EOK == sop_parser_init(&parser, &options));
+  assert(SOP_EOK == sop_parser_execute(&parser, src, length));
+
+  assert(SOP_EOK == sop_reader_init(&reader, src, length, &readeroptions));
+  assert(TestState.lines == read_all(&reader, &first));
+  assert(TestState.hash == first);
+  assert(SOP_NULL == sop_reader_next(&reader, &event));
+  sop_reader_destroy(&reader);
+  ok("reader: yields what callbacks get");
+
+  // two readers driven in turns on one thread
+  first = 0;
+  assert(SOP_EOK == sop_reader_init(&reader, src, length, &readeroptions));
+  assert(SOP_EOK == sop_reader_init_file(&other, "fixtures/teapot.obj",
+                                         &readeroptions));
+  while (SOP_EOK == rc[0] || SOP_EOK == rc[1]) {
+    if (SOP_EOK == rc[0] &&
+        SOP_EOK == (rc[0] = sop_reader_next(&reader, &event))) {
+      hash_line(&first, &event.line);
+      lines[0]++;
+    }
+    if (SOP_EOK == rc[1] &&
+        SOP_EOK == (rc[1] = sop_reader_next(&other, &event))) {
+      hash_line(&second, &event.line);
+      lines[1]++;
+    }
+  }
+  assert(SOP_NULL == rc[0] && SOP_NULL == rc[1]);
+  assert(TestState.lines == lines[0] && TestState.lines == lines[1]);
+  assert(TestState.hash == first && TestState.hash == second);
+  sop_reader_destroy(&reader);
+  sop_reader_destroy(&other);
+  ok("reader: readers interleave on a single thread");
+
+  assert(SOP_EINVALID_SOURCE == sop_reader_init(&reader, src, 0, 0));
+  assert(SOP_EINVALID_SOURCE ==
+         sop_reader_init_file(&reader, "fixtures/missing.obj", 0));
+  sop_reader_destroy(&reader);
+  ok("reader: empty and missing sources");
+  ok_done();
+  return 0;
+}
+
+TEST(reader_events) {
+  sop_reader_options_t readeroptions = { .triangulate = 1 };
+  sop_reader_t reader;
+  sop_reader_event_t event;
+  const int *rows = 0;
+
+  assert(SOP_EOK == sop_reader_init(&reader, batched, strlen(batched),
+                                    &readeroptions));
+
+  assert(SOP_EOK == sop_reader_next(&reader, &event));
+  assert(SOP_COMMENT == event.type);
+  assert(0 == strcmp("cube", (const char *) event.line.data));
+
+  for (int i = 0; i < 6; ++i) {
+    assert(SOP_EOK == sop_reader_next(&reader, &event));
+  }
+  assert(SOP_DIRECTIVE_VERTEX_NORMAL == event.type);
+  assert(1 == ((const float *) event.line.data)[2]);
+  assert(7 == event.line.lineno);
+
+  assert(SOP_EOK == sop_reader_next(&reader, &event));
+  assert(SOP_DIRECTIVE_USE_MTL == event.type);
+  assert(0 == strcmp("red", (const char *) event.line.data));
+  assert(-1 == event.line.material);
+  ok("reader: line events");
+
+  // the quad is yielded as a fan of two triangles
+  assert(SOP_EOK == sop_reader_next(&reader, &event));
+  assert(SOP_DIRECTIVE_FACE == event.type && 3 == event.line.length);
+  rows = (const int *) event.line.data;
+  assert(1 == rows[0] && 2 == rows[1] && 3 == rows[2]);
+  assert(-1 == rows[3] && 1 == rows[6]);
+  assert(SOP_EOK == sop_reader_next(&reader, &event));
+  assert(SOP_DIRECTIVE_FACE == event.type && 3 == event.line.length);
+  rows = (const int *) event.line.data;
+  assert(1 == rows[0] && 3 == rows[1] && 4 == rows[2]);
+  assert(9 == event.line.lineno);
+  assert(SOP_EOK == sop_reader_next(&reader, &event));
+  assert(10 == event.line.lineno);
+  ok("reader: triangulated faces");
+
+  assert(SOP_EOK == sop_reader_next(&reader, &event));
+  assert(SOP_DIRECTIVE_GROUP == event.type);
+  assert(0 == strcmp("top", (const char *) event.line.data));
+  assert(SOP_EOK == sop_reader_next(&reader, &event));
+  assert(12 == event.line.lineno);
+  assert(SOP_NULL == sop_reader_next(&reader, &event));
+  sop_reader_destroy(&reader);
+  ok("reader: unterminated last line");
+  ok_done();
+  return 0;
+}
+
+TEST(reader_batches) {
+  sop_reader_options_t readeroptions = {
+    .batches = SOP_DIRECTIVE_MASK(SOP_DIRECTIVE_VERTEX) |
+               SOP_DIRECTIVE_MASK(SOP_DIRECTIVE_FACE),
+    .batch_size = 3,
+    .zero_copy = 1,
+  };
+  sop_reader_t reader;
+  sop_reader_event_t event;
+  const float (*vertices)[4] = 0;
+  const int (*corners)[3] = 0;
+
+  assert(SOP_EOK == sop_reader_init(&reader, batched, strlen(batched),
+                                    &readeroptions));
+
+  assert(SOP_EOK == sop_reader_next(&reader, &event));
+  assert(SOP_COMMENT == event.type && !event.batched);
+  assert(4 == event.line.length);
+  assert(0 == strncmp("cube", (const char *) event.line.data, 4));
+
+  assert(SOP_EOK == sop_reader_next(&reader, &event));
+  assert(event.batched && SOP_DIRECTIVE_VERTEX == event.batch.type);
+  assert(3 == event.batch.count && 2 == event.batch.lineno);
+  vertices = (const float (*)[4]) event.batch.data;
+  assert(1 == vertices[2][0] && 1 == vertices[2][1] && 1 == vertices[2][3]);
+
+  assert(SOP_EOK == sop_reader_next(&reader, &event));
+  assert(event.batched && 2 == event.batch.count);
+  assert(5 == event.batch.lineno);
+  vertices = (const float (*)[4]) event.batch.data;
+  assert(1 == vertices[1][2]);
+  ok("reader: vertex batches");
+
+  // vn isn't batched, a batch ends before another directive
+  assert(SOP_EOK == sop_reader_next(&reader, &event));
+  assert(SOP_DIRECTIVE_VERTEX_NORMAL == event.type && !event.batched);
+  assert(SOP_EOK == sop_reader_next(&reader, &event));
+  assert(SOP_DIRECTIVE_USE_MTL == event.type);
+
+  assert(SOP_EOK == sop_reader_next(&reader, &event));
+  assert(event.batched && SOP_DIRECTIVE_FACE == event.batch.type);
+  assert(2 == event.batch.count && -1 == event.batch.material);
+  assert(0 == event.batch.offsets[0] && 4 == event.batch.offsets[1]);
+  assert(7 == event.batch.offsets[2]);
+  corners = (const int (*)[3]) event.batch.data;
+  assert(4 == corners[3][0] && 0 == corners[3][1] && 1 == corners[3][2]);
+  assert(5 == corners[6][0] && 0 == corners[6][2]);
+  ok("reader: face batches");
+
+  assert(SOP_EOK == sop_reader_next(&reader, &event));
+  assert(SOP_DIRECTIVE_GROUP == event.type);
+  assert(SOP_EOK == sop_reader_next(&reader, &event));
+  assert(event.batched && 1 == event.batch.count);
+  assert(SOP_NULL == sop_reader_next(&reader, &event));
+  sop_reader_destroy(&reader);
+  ok("reader: lines between batches");
+  ok_done();
+  return 0;
+}
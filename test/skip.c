@@ -0,0 +1,66 @@
+#include <stdlib.h>
+#include <assert.h>
+#include <string.h>
+#include <stdio.h>
+
+#include <sop/sop.h>
+#include <ok/ok.h>
+#include <fs/fs.h>
+
+#include "test.h"
+
+static int
+on_line(const sop_parser_state_t *state,
+        const sop_parser_line_state_t line);
+
+static sop_parser_t parser;
+static sop_parser_options_t options = {
+  .callbacks = {
+    .on_vertex = on_line,
+    .on_face = on_line,
+  }
+};
+
+static struct {
+  int vertices;
+  int faces;
+} TestState;
+
+static void ResetTestState(void) {
+  memset(&TestState, 0, sizeof(TestState));
+}
+
+TEST(skip) {
+  const char *src = fs_read("fixtures/teddy.obj");
+
+  ResetTestState();
+  assert(SOP_EOK == sop_parser_init(&parser, &options));
+  assert((SOP_DIRECTIVE_MASK(SOP_DIRECTIVE_VERTEX) |
+          SOP_DIRECTIVE_MASK(SOP_DIRECTIVE_FACE)) == parser.directives);
+  assert(SOP_EOK == sop_parser_execute(&parser, src, strlen(src)));
+  assert(TestState.vertices > 0 && TestState.faces > 0);
+  ok("skip: directives without callbacks are not decoded");
+
+  ResetTestState();
+  options.directives = SOP_DIRECTIVE_MASK(SOP_DIRECTIVE_VERTEX);
+  assert(SOP_EOK == sop_parser_init(&parser, &options));
+  assert(SOP_EOK == sop_parser_execute(&parser, src, strlen(src)));
+  assert(TestState.vertices > 0 && 0 == TestState.faces);
+  options.directives = 0;
+  ok("skip: explicit directive masks");
+
+  ok_done();
+  return 0;
+}
+
+static int
+on_line(const sop_parser_state_t *state,
+        const sop_parser_line_state_t line) {
+  if (SOP_DIRECTIVE_FACE == line.type) {
+    TestState.faces++;
+  } else {
+    assert(SOP_DIRECTIVE_VERTEX == line.type);
+    TestState.vertices++;
+  }
+  return SOP_EOK;
+}
@@ -0,0 +1,118 @@
+#include <stdlib.h>
+#include <assert.h>
+#include <string.h>
+#include <stdio.h>
+
+#include <sop/sop.h>
+#include <ok/ok.h>
+#include <fs/fs.h>
+
+#include "test.h"
+
+static int
+on_vertex(const sop_parser_state_t *state,
+          const sop_parser_line_state_t line) {
+  return SOP_EOK;
+}
+
+TEST(stats) {
+  sop_parser_stats_t stats;
+  sop_parser_options_t options = {
+    .stats = &stats,
+    .callbacks = { .on_vertex = on_vertex },
+  };
+  sop_parser_t parser;
+  const char *src = ""
+    "# a comment\n"
+    "v 0 0 0\n"
+    "\n"
+    "  \t\n"
+    "v 1.5 0 0 # the longest line\n"
+    "vn 0 0 1\n"
+    "bogus 1 2 3\n"
+    "f 1 2 3";
+
+  memset(&stats, 0, sizeof(stats));
+  assert(SOP_EOK == sop_parser_init(&parser, &options));
+  assert(SOP_EOK == sop_parser_execute(&parser, src, strlen(src)));
+
+  if (!stats.enabled) {
+    // built without SOP_STATS, nothing is collected
+    sop_parser_stats_t empty;
+    memset(&empty, 0, sizeof(empty));
+    assert(0 == memcmp(&empty, &stats, sizeof(stats)));
+    ok("stats: nothing collected without SOP_STATS");
+    ok_done();
+    return 0;
+  }
+
+  assert(8 == stats.lines);
+  assert(strlen("v 1.5 0 0 # the longest line") == stats.longest);
+  assert(5 == stats.longest_lineno);
+  assert(2 == stats.directives[SOP_DIRECTIVE_VERTEX]);
+  assert(strlen("v 0 0 0v 1.5 0 0 # the longest line") ==
+         stats.bytes[SOP_DIRECTIVE_VERTEX]);
+  assert(1 == stats.directives[SOP_DIRECTIVE_VERTEX_NORMAL]);
+  assert(1 == stats.directives[SOP_DIRECTIVE_FACE]);
+  assert(1 == stats.directives[SOP_COMMENT]);
+  assert(2 == stats.blank);
+  assert(1 == stats.unknown);
+
+  // comment, vn and f have no callback
+  assert(3 == stats.skipped);
+  ok("stats: lines counted per directive");
+
+  assert(SOP_EOK == sop_parser_execute(&parser, src, strlen(src)));
+  assert(16 == stats.lines);
+  assert(4 == stats.directives[SOP_DIRECTIVE_VERTEX]);
+  ok("stats: executions add up");
+
+  {
+    const char *teapot = fs_read("fixtures/teapot.obj");
+    sop_parser_stats_t serial;
+    memset(&serial, 0, sizeof(serial));
+    options.stats = &serial;
+    assert(SOP_EOK == sop_parser_init(&parser, &options));
+    assert(SOP_EOK == sop_parser_execute(&parser, teapot, strlen(teapot)));
+    assert(serial.scan_ns > 0 && serial.decode_ns > 0);
+
+    // a source big enough to be split across workers
+    {
+      const size_t copies = 1 + 1024 * 1024 / strlen(teapot);
+      const size_t size = strlen(teapot);
+      char *big = malloc(copies * size);
+      sop_parser_stats_t parallel;
+      assert(big);
+      for (size_t i = 0; i < copies; ++i) {
+        memcpy(big + i * size, teapot, size);
+      }
+
+      memset(&serial, 0, sizeof(serial));
+      memset(&parallel, 0, sizeof(parallel));
+      assert(SOP_EOK == sop_parser_init(&parser, &options));
+      assert(SOP_EOK == sop_parser_execute(&parser, big, copies * size));
+
+      options.stats = &parallel;
+      options.threads = 4;
+      assert(SOP_EOK == sop_parser_init(&parser, &options));
+      assert(SOP_EOK == sop_parser_execute(&parser, big, copies * size));
+
+      assert(serial.lines == parallel.lines);
+      assert(serial.longest == parallel.longest);
+      assert(serial.longest_lineno == parallel.longest_lineno);
+      assert(0 == memcmp(serial.directives, parallel.directives,
+                         sizeof(serial.directives)));
+      assert(0 == memcmp(serial.bytes, parallel.bytes,
+                         sizeof(serial.bytes)));
+      assert(serial.blank == parallel.blank);
+      assert(serial.skipped == parallel.skipped);
+      free(big);
+    }
+
+    free((void *) teapot);
+  }
+  ok("stats: parallel parsing counts like serial parsing");
+
+  ok_done();
+  return 0;
+}
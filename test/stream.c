@@ -0,0 +1,129 @@
+#include <stdlib.h>
+#include <assert.h>
+#include <string.h>
+#include <stdio.h>
+
+#include <sop/sop.h>
+#include <ok/ok.h>
+#include <fs/fs.h>
+
+#include "test.h"
+
+static int
+on_line(const sop_parser_state_t *state,
+        const sop_parser_line_state_t line);
+
+static int
+on_string(const sop_parser_state_t *state,
+          const sop_parser_line_state_t line);
+
+static sop_parser_t parser;
+static sop_parser_options_t options = {
+  .zero_copy = 1,
+  .callbacks = {
+    .on_material_use = on_string,
+    .on_comment = on_string,
+    .on_texture = on_line,
+    .on_vertex = on_line,
+    .on_normal = on_line,
+    .on_face = on_line,
+  }
+};
+
+static struct {
+  unsigned long hash;
+  int lines;
+  int fail;
+} TestState;
+
+static void ResetTestState(void) {
+  memset(&TestState, 0, sizeof(TestState));
+}
+
+static void
+hash(const void *data, size_t size) {
+  const unsigned char *bytes = (const unsigned char *) data;
+  for (size_t i = 0; i < size; ++i) {
+    TestState.hash = (TestState.hash ^ bytes[i]) * 1099511628211UL;
+  }
+}
+
+static int
+feed(const char *src, size_t length, size_t chunk) {
+  for (size_t offset = 0; offset < length; offset += chunk) {
+    size_t size = length - offset < chunk ? length - offset : chunk;
+    int rc = sop_parser_feed(&parser, src + offset, size);
+    if (SOP_EOK != rc) {
+      sop_parser_destroy(&parser);
+      return rc;
+    }
+  }
+  return sop_parser_finish(&parser);
+}
+
+TEST(stream) {
+  const char *src = fs_read("fixtures/teapot.obj");
+  const size_t length = strlen(src);
+  const size_t chunks[] = { 1, 3, 64, 1000, 65536, length };
+  unsigned long expected = 0;
+  int lines = 0;
+
+  ResetTestState();
+  assert(SOP_EOK == sop_parser_init(&parser, &options));
+  assert(SOP_EOK == sop_parser_execute(&parser, src, length));
+  expected = TestState.hash;
+  lines = TestState.lines;
+
+  for (size_t i = 0; i < sizeof(chunks) / sizeof(chunks[0]); ++i) {
+    ResetTestState();
+    assert(SOP_EOK == feed(src, length, chunks[i]));
+    assert(lines == TestState.lines);
+    assert(expected == TestState.hash);
+    assert(0 == parser.stream);
+  }
+  ok("stream: chunked feeds match a single execute");
+
+  ResetTestState();
+  assert(SOP_EOK == sop_parser_feed(&parser, "v 1 2 3\nv 4", 11));
+  assert(1 == TestState.lines);
+  assert(SOP_EOK == sop_parser_feed(&parser, " 5 6", 4));
+  assert(1 == TestState.lines);
+  assert(SOP_EOK == sop_parser_finish(&parser));
+  assert(2 == TestState.lines);
+  ok("stream: final line dispatched on finish");
+
+  ResetTestState();
+  TestState.fail = 1;
+  assert(SOP_EINVALID_SOURCE == sop_parser_feed(&parser, "v 1 2 3\n", 8));
+  assert(SOP_EINVALID_SOURCE == sop_parser_feed(&parser, "v 1 2 3\n", 8));
+  assert(1 == TestState.lines);
+  assert(SOP_EINVALID_SOURCE == sop_parser_finish(&parser));
+  assert(0 == parser.stream);
+  ok("stream: callback errors are sticky");
+
+  ok_done();
+  return 0;
+}
+
+static int
+on_line(const sop_parser_state_t *state,
+        const sop_parser_line_state_t line) {
+  TestState.lines++;
+  hash(&line.type, sizeof(line.type));
+  hash(&line.lineno, sizeof(line.lineno));
+  if (SOP_DIRECTIVE_FACE == line.type) {
+    hash(line.data, 9 * sizeof(int));
+  } else {
+    hash(line.data, 4 * sizeof(float));
+  }
+  return TestState.fail ? SOP_EINVALID_SOURCE : SOP_EOK;
+}
+
+static int
+on_string(const sop_parser_state_t *state,
+          const sop_parser_line_state_t line) {
+  TestState.lines++;
+  hash(&line.lineno, sizeof(line.lineno));
+  hash(line.data, line.length);
+  return SOP_EOK;
+}
@@ -1,16 +1,59 @@
 #include "test.h"
 
+TEST(arena);
+TEST(batch);
+TEST(cache);
+TEST(count);
+TEST(directives);
+TEST(faces);
+TEST(file);
+TEST(float);
+TEST(groups);
+TEST(lines);
 TEST(material);
+TEST(materials);
+TEST(mesh);
+TEST(mtllib);
+TEST(parallel);
+TEST(reader);
+TEST(reader_batches);
+TEST(reader_events);
 TEST(simple);
+TEST(skip);
+TEST(stats);
+TEST(stream);
 TEST(teapot);
 TEST(teddy);
+TEST(trace);
+TEST(weld);
 
 int
 main (void) {
+  RUN(arena);
+  RUN(batch);
+  RUN(cache);
+  RUN(count);
+  RUN(directives);
+  RUN(faces);
+  RUN(file);
+  RUN(float);
+  RUN(groups);
+  RUN(lines);
   RUN(material);
+  RUN(materials);
+  RUN(mesh);
+  RUN(mtllib);
+  RUN(parallel);
+  RUN(reader);
+  RUN(reader_batches);
+  RUN(reader_events);
   RUN(simple);
+  RUN(skip);
+  RUN(stats);
+  RUN(stream);
   RUN(teapot);
   RUN(teddy);
+  RUN(trace);
+  RUN(weld);
   return 0;
 }
-
@@ -0,0 +1,128 @@
+#include <stdlib.h>
+#include <assert.h>
+#include <string.h>
+#include <stdio.h>
+
+#include <sop/sop.h>
+#include <ok/ok.h>
+#include <fs/fs.h>
+
+#include "test.h"
+
+static int
+on_vertices(const sop_parser_state_t *state,
+            const sop_parser_batch_t *batch) {
+  return SOP_EOK;
+}
+
+/**
+ * Number of times `needle` occurs in `haystack`.
+ */
+
+static size_t
+occurrences(const char *haystack, const char *needle) {
+  size_t count = 0;
+  for (const char *p = strstr(haystack, needle); p;
+       p = strstr(p + 1, needle)) {
+    count++;
+  }
+  return count;
+}
+
+TEST(trace) {
+  const char *path = "/tmp/sop-trace-test.json";
+  const char *teapot = fs_read("fixtures/teapot.obj");
+  sop_trace_t trace;
+  sop_parser_options_t options = {
+    .trace = &trace,
+    .callbacks = { .on_vertices = on_vertices },
+  };
+  sop_parser_t parser;
+  char *json = 0;
+
+  assert(SOP_EOK == sop_trace_init(&trace, 0));
+  assert(SOP_EOK == sop_parser_init(&parser, &options));
+  assert(SOP_EOK == sop_parser_execute(&parser, teapot, strlen(teapot)));
+  assert(SOP_EOK == sop_trace_write(&trace, path));
+
+  json = fs_read(path);
+  assert(json);
+  assert(json == strstr(json, "{\"displayTimeUnit\":\"ns\","));
+  assert(1 == occurrences(json, "\"name\":\"thread_name\""));
+  assert(1 == occurrences(json, "\"name\":\"execute\""));
+  assert(1 == occurrences(json, "\"name\":\"parse\""));
+  // 3644 vertices in batches of SOP_PARSER_BATCH_SIZE
+  assert(4 == occurrences(json, "\"name\":\"on_vertices\""));
+  free(json);
+  ok("trace: serial parse phases recorded");
+
+  {
+    const size_t size = strlen(teapot);
+    const size_t copies = 1 + 1024 * 1024 / size;
+    char *big = malloc(copies * size);
+    assert(big);
+    for (size_t i = 0; i < copies; ++i) {
+      memcpy(big + i * size, teapot, size);
+    }
+
+    sop_trace_destroy(&trace);
+    assert(SOP_EOK == sop_trace_init(&trace, 0));
+    options.threads = 4;
+    assert(SOP_EOK == sop_parser_init(&parser, &options));
+    assert(SOP_EOK == sop_parser_execute(&parser, big, copies * size));
+    assert(SOP_EOK == sop_trace_write(&trace, path));
+    free(big);
+
+    json = fs_read(path);
+    assert(json);
+    assert(1 == occurrences(json, "\"name\":\"execute\""));
+    assert(0 == occurrences(json, "\"name\":\"parse\""));
+    assert(occurrences(json, "\"name\":\"decode\"") >= 4);
+    assert(occurrences(json, "\"name\":\"decode\"") ==
+           occurrences(json, "\"name\":\"dispatch\""));
+    assert(occurrences(json, "\"name\":\"wait\"") >= 1);
+    assert(occurrences(json, "\"name\":\"thread_name\"") >= 2);
+    free(json);
+  }
+  ok("trace: workers record into their own buffers");
+
+  {
+    sop_mesh_options_t meshoptions = { .weld = 1, .trace = &trace };
+    sop_mesh_t mesh;
+
+    sop_trace_destroy(&trace);
+    assert(SOP_EOK == sop_trace_init(&trace, 0));
+    assert(SOP_EOK == sop_mesh_init(&mesh, &meshoptions));
+    assert(SOP_EOK == sop_mesh_load(teapot, strlen(teapot), &mesh));
+    assert(SOP_EOK == sop_trace_write(&trace, path));
+    sop_mesh_destroy(&mesh);
+
+    json = fs_read(path);
+    assert(json);
+    assert(1 == occurrences(json, "\"cat\":\"mesh\",\"name\":\"load\""));
+    assert(1 == occurrences(json, "\"cat\":\"mesh\",\"name\":\"weld\""));
+    assert(1 == occurrences(json, "\"cat\":\"mesh\",\"name\":\"shrink\""));
+    assert(occurrences(json, "\"name\":\"on_faces\"") >= 1);
+    free(json);
+  }
+  ok("trace: mesh stages recorded");
+
+  {
+    sop_arena_t arena;
+    assert(SOP_EOK == sop_arena_init(&arena, 0));
+    sop_trace_destroy(&trace);
+    assert(SOP_EOK == sop_trace_init(&trace, &arena.allocator));
+    options.threads = 0;
+    assert(SOP_EOK == sop_parser_init(&parser, &options));
+    assert(SOP_EOK == sop_parser_execute(&parser, teapot, strlen(teapot)));
+    assert(arena.used > 0);
+    sop_trace_destroy(&trace);
+    sop_arena_destroy(&arena);
+    remove(path);
+  }
+  ok("trace: buffers use the trace allocator");
+
+  free((void *) teapot);
+  ok_done();
+  return 0;
+}
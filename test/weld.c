@@ -0,0 +1,109 @@
+#include <stdlib.h>
+#include <assert.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#include <sop/sop.h>
+#include <ok/ok.h>
+#include <fs/fs.h>
+
+#include "test.h"
+
+static uint32_t
+weld_index(const sop_mesh_t *mesh, size_t i) {
+  return 2 == mesh->weld.index_size
+    ? ((const uint16_t *) mesh->weld.indices)[i]
+    : ((const uint32_t *) mesh->weld.indices)[i];
+}
+
+TEST(weld) {
+  sop_mesh_t mesh;
+  sop_mesh_options_t options = { .weld = 1 };
+  const char *src = fs_read("fixtures/teapot.obj");
+
+  assert(SOP_EOK == sop_mesh_init(&mesh, &options));
+  assert(SOP_EOK == sop_mesh_load(src, strlen(src), &mesh));
+  assert(3 == mesh.weld.stride);
+  assert(-1 == mesh.weld.texcoord_offset);
+  assert(-1 == mesh.weld.normal_offset);
+  assert(2 == mesh.weld.index_size);
+  assert(mesh.weld.vertex_count <= mesh.position_count);
+  for (size_t i = 0; i < mesh.index_count; ++i) {
+    const float *vertex = mesh.weld.vertices + 3 * weld_index(&mesh, i);
+    const float *position = mesh.positions + 3 * mesh.position_indices[i];
+    assert(0 == memcmp(vertex, position, 3 * sizeof(float)));
+  }
+  sop_mesh_destroy(&mesh);
+  assert(0 == mesh.weld.vertices && 0 == mesh.weld.table);
+  ok("weld: positions only source");
+
+  const char *quad = ""
+    "v 0 0 0\n"
+    "v 1 0 0\n"
+    "v 1 1 0\n"
+    "v 0 1 0\n"
+    "vt 0 0\n"
+    "vt 1 1\n"
+    "vn 0 0 1\n"
+    "f 1/1/1 2/1/1 3/2/1\n"
+    "f 1/1/1 3/2/1 4/2\n"
+    "";
+
+  assert(SOP_EOK == sop_mesh_init(&mesh, &options));
+  assert(SOP_EOK == sop_mesh_load(quad, strlen(quad), &mesh));
+  assert(4 == mesh.weld.vertex_count);
+  assert(8 == mesh.weld.stride);
+  assert(3 == mesh.weld.texcoord_offset);
+  assert(5 == mesh.weld.normal_offset);
+  {
+    const uint32_t indices[] = { 0, 1, 2, 0, 2, 3 };
+    for (size_t i = 0; i < 6; ++i) {
+      assert(indices[i] == weld_index(&mesh, i));
+    }
+  }
+  {
+    // 4/2 has no normal
+    const float *vertex = mesh.weld.vertices + 3 * 8;
+    const float expected[] = { 0, 1, 0, 1, 1, 0, 0, 0 };
+    assert(0 == memcmp(vertex, expected, sizeof(expected)));
+  }
+  ok("weld: shared corners deduplicated");
+
+  assert(SOP_EOK == sop_mesh_load(quad, strlen(quad), &mesh));
+  assert(8 == mesh.weld.vertex_count);
+  assert(12 == mesh.index_count);
+  assert(2 == mesh.weld.index_size);
+  for (size_t i = 0; i < mesh.index_count; ++i) {
+    assert(weld_index(&mesh, i) == weld_index(&mesh, i % 6) + 4 * (i / 6));
+  }
+  sop_mesh_destroy(&mesh);
+  ok("weld: appended sources");
+
+  {
+    // a 256x256 grid of unique texcoords needs 32 bit indices
+    const size_t n = 256;
+    char *grid = (char *) malloc(n * n * 48 + 64);
+    char *cursor = grid;
+    assert(grid);
+    cursor += sprintf(cursor, "v 0 0 0\nv 1 0 0\nv 0 1 0\n");
+    for (size_t i = 0; i < n * n; ++i) {
+      cursor += sprintf(cursor, "vt %zu 0\n", i);
+    }
+    for (size_t i = 0; i < n * n; ++i) {
+      cursor += sprintf(cursor, "f 1/%zu 2/%zu 3/%zu\n", i + 1, i + 1, i + 1);
+    }
+
+    assert(SOP_EOK == sop_mesh_init(&mesh, &options));
+    assert(SOP_EOK == sop_mesh_load(grid, (size_t) (cursor - grid), &mesh));
+    assert(3 * n * n == mesh.weld.vertex_count);
+    assert(4 == mesh.weld.index_size);
+    assert(3 * n * n - 1 == weld_index(&mesh, mesh.index_count - 1));
+    sop_mesh_destroy(&mesh);
+    free(grid);
+  }
+  ok("weld: 32 bit indices");
+
+  ok_done();
+  return 0;
+}